@@ -16,8 +16,12 @@
 #include "abcgApplication.hpp"
 #include "abcgException.hpp"
 #include "abcgExternal.hpp"
+#include "abcgKTX2.hpp"
+#include "abcgMesh.hpp"
+#include "abcgProfiler.hpp"
 #include "abcgTrackball.hpp"
 #include "abcgUtil.hpp"
+#include "abcgVideoWriter.hpp"
 #include "abcgWindow.hpp"
 
 #endif
\ No newline at end of file
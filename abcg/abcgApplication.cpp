@@ -15,6 +15,7 @@
 #include <span>
 
 #include "abcgException.hpp"
+#include "abcgProfiler.hpp"
 #include "abcgWindow.hpp"
 
 #if defined(__EMSCRIPTEN__)
@@ -70,13 +71,24 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
  * runs the event loop.
  *
  * @param window L-value reference to the window object.
+ * @param maxFrames Number of iterations of the main loop after which the
+ * application exits, or zero to run until the window is closed. This is
+ * typically used with headless windows (see
+ * abcg::OpenGLSettings::headless).
  *
  * @throw abcg::SDLError if `SDL_Init` failed.
  * @throw abcg::SDLImageError if `IMG_Init` failed.
+ *
+ * @remark @a maxFrames is ignored when the application is built for
+ * WebAssembly.
  */
-void abcg::Application::run(Window &window) {
-  if (Uint32 const subsystemMask{SDL_INIT_VIDEO | SDL_INIT_AUDIO |
-                                 SDL_INIT_GAMECONTROLLER};
+void abcg::Application::run(Window &window,
+                             [[maybe_unused]] int maxFrames) {
+  // Headless windows need no display, so only the event subsystem is used
+  if (Uint32 const subsystemMask{window.isHeadless()
+                                     ? Uint32{SDL_INIT_EVENTS}
+                                     : Uint32{SDL_INIT_VIDEO | SDL_INIT_AUDIO |
+                                              SDL_INIT_GAMECONTROLLER}};
       SDL_Init(subsystemMask) != 0) {
     throw abcg::SDLError("SDL_Init failed");
   }
@@ -97,8 +109,10 @@ void abcg::Application::run(Window &window) {
   emscripten_set_main_loop_arg(mainLoopCallback, this, 0, true);
 #else
   auto done{false};
-  while (!done) {
+  for (auto frame{1}; !done; ++frame) {
     mainLoopIterator(done);
+    if (maxFrames > 0 && frame >= maxFrames)
+      done = true;
   }
 #endif
 
@@ -146,13 +160,27 @@ std::string const &abcg::Application::getBasePath() noexcept {
 }
 
 void abcg::Application::mainLoopIterator([[maybe_unused]] bool &done) const {
-  SDL_Event event{};
-  while (SDL_PollEvent(&event) != 0) {
+  {
+    ProfilerZone zone{"Events"};
+    SDL_Event event{};
 #if !defined(__EMSCRIPTEN__)
-    if (event.type == SDL_QUIT)
-      done = true;
+    // Nothing to repaint: block until the next event arrives
+    if (m_window->isIdle() && SDL_WaitEvent(&event) != 0) {
+      if (event.type == SDL_QUIT)
+        done = true;
+      m_window->templateHandleEvent(event, done);
+    }
 #endif
-    m_window->templateHandleEvent(event, done);
+    while (SDL_PollEvent(&event) != 0) {
+#if !defined(__EMSCRIPTEN__)
+      if (event.type == SDL_QUIT)
+        done = true;
+#endif
+      m_window->templateHandleEvent(event, done);
+    }
   }
   m_window->templatePaint();
+#if !defined(__EMSCRIPTEN__)
+  m_window->templateWaitFrame();
+#endif
 }
@@ -38,7 +38,7 @@ class abcg::Application {
 public:
   Application(int argc, char **argv);
 
-  void run(Window &window);
+  void run(Window &window, int maxFrames = 0);
 
   static std::string const &getAssetsPath() noexcept;
   static std::string const &getBasePath() noexcept;
@@ -13,44 +13,285 @@
 #include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 
-#include <span>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
+// SSE2 is part of x86-64. SSSE3 and AVX2 kernels are compiled with target
+// attributes and selected at run time, so no compiler flags are required
+#if defined(__SSE2__) || defined(_M_X64)
+#define ABCG_IMAGE_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define ABCG_IMAGE_DISPATCH
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+enum class InstructionSet { Scalar, SSE2, SSSE3, AVX2 };
+
+InstructionSet getInstructionSet() {
+#if defined(ABCG_IMAGE_DISPATCH)
+  static InstructionSet const instructionSet{[] {
+    if (__builtin_cpu_supports("avx2"))
+      return InstructionSet::AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+      return InstructionSet::SSSE3;
+    return InstructionSet::SSE2;
+  }()};
+  return instructionSet;
+#elif defined(ABCG_IMAGE_SSE2)
+  return InstructionSet::SSE2;
+#else
+  return InstructionSet::Scalar;
+#endif
+}
+
+// Swaps the first `size` bytes of two rows
+void swapRows(unsigned char *first, unsigned char *second, std::size_t size) {
+  std::size_t offset{};
+#if defined(ABCG_IMAGE_SSE2)
+  for (; offset + 16 <= size; offset += 16) {
+    auto *const firstBlock{reinterpret_cast<__m128i *>(first + offset)};
+    auto *const secondBlock{reinterpret_cast<__m128i *>(second + offset)};
+    auto const firstPixels{_mm_loadu_si128(firstBlock)};
+    _mm_storeu_si128(firstBlock, _mm_loadu_si128(secondBlock));
+    _mm_storeu_si128(secondBlock, firstPixels);
+  }
+#endif
+  // Through a small buffer, so that the copies compile to memcpy
+  std::array<unsigned char, 256> buffer{};
+  while (offset < size) {
+    auto const chunk{std::min(buffer.size(), size - offset)};
+    std::memcpy(buffer.data(), first + offset, chunk);
+    std::memcpy(first + offset, second + offset, chunk);
+    std::memcpy(second + offset, buffer.data(), chunk);
+    offset += chunk;
+  }
+}
+
+// Reverses the order of the pixels in [first, last) of a row, in place
+void reversePixels(unsigned char *row, std::size_t bytesPerPixel,
+                   std::size_t first, std::size_t last) {
+  while (last - first > 1) {
+    --last;
+    std::swap_ranges(row + first * bytesPerPixel,
+                     row + (first + 1) * bytesPerPixel,
+                     row + last * bytesPerPixel);
+    ++first;
+  }
+}
+
+#if defined(ABCG_IMAGE_SSE2)
+// Reverses a row of 4-byte pixels. Blocks of 4 pixels are taken from both
+// ends, reversed in registers and stored at the opposite end
+void reverseRGBA(unsigned char *row, std::size_t width) {
+  std::size_t first{};
+  std::size_t last{width};
+  for (; last - first >= 8; first += 4, last -= 4) {
+    auto *const left{reinterpret_cast<__m128i *>(row + first * 4)};
+    auto *const right{reinterpret_cast<__m128i *>(row + (last - 4) * 4)};
+    auto const leftPixels{_mm_loadu_si128(left)};
+    auto const rightPixels{_mm_loadu_si128(right)};
+    _mm_storeu_si128(left, _mm_shuffle_epi32(rightPixels, 0x1B));
+    _mm_storeu_si128(right, _mm_shuffle_epi32(leftPixels, 0x1B));
+  }
+  reversePixels(row, 4, first, last);
+}
+#endif
+
+#if defined(ABCG_IMAGE_DISPATCH)
+[[gnu::target("avx2")]] void reverseRGBAWithAVX2(unsigned char *row,
+                                                 std::size_t width) {
+  auto const reversed{_mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)};
+  std::size_t first{};
+  std::size_t last{width};
+  for (; last - first >= 16; first += 8, last -= 8) {
+    auto *const left{reinterpret_cast<__m256i *>(row + first * 4)};
+    auto *const right{reinterpret_cast<__m256i *>(row + (last - 8) * 4)};
+    auto const leftPixels{_mm256_loadu_si256(left)};
+    auto const rightPixels{_mm256_loadu_si256(right)};
+    _mm256_storeu_si256(left,
+                        _mm256_permutevar8x32_epi32(rightPixels, reversed));
+    _mm256_storeu_si256(right,
+                        _mm256_permutevar8x32_epi32(leftPixels, reversed));
+  }
+  reversePixels(row, 4, first, last);
+}
+
+// Masks of _mm_shuffle_epi8 that reverse 16 RGB pixels held in 3 registers.
+// Output register k takes from input register r the bytes selected by
+// masks[k][r]; indices with the high bit set produce zero
+constexpr auto reverseRGBMasks{[] {
+  std::array<std::array<std::array<std::int8_t, 16>, 3>, 3> masks{};
+  for (std::size_t output{}; output < 48; ++output) {
+    auto const pixel{output / 3};
+    auto const source{(15 - pixel) * 3 + output % 3};
+    for (std::size_t input{}; input < 3; ++input) {
+      masks.at(output / 16).at(input).at(output % 16) =
+          gsl::narrow_cast<std::int8_t>(
+              source / 16 == input ? gsl::narrow_cast<int>(source % 16) : -128);
+    }
+  }
+  return masks;
+}()};
+
+// 16 RGB pixels in 3 registers
+struct RGBBlock {
+  __m128i first;
+  __m128i second;
+  __m128i third;
+};
+
+[[gnu::target("ssse3")]] RGBBlock loadRGBBlock(unsigned char const *pixels) {
+  auto const *const source{reinterpret_cast<__m128i const *>(pixels)};
+  return {.first = _mm_loadu_si128(source),
+          .second = _mm_loadu_si128(source + 1),
+          .third = _mm_loadu_si128(source + 2)};
+}
+
+[[gnu::target("ssse3")]] void storeRGBBlock(unsigned char *pixels,
+                                            RGBBlock const &block) {
+  auto *const destination{reinterpret_cast<__m128i *>(pixels)};
+  _mm_storeu_si128(destination, block.first);
+  _mm_storeu_si128(destination + 1, block.second);
+  _mm_storeu_si128(destination + 2, block.third);
+}
+
+[[gnu::target("ssse3")]] __m128i shuffleRGB(__m128i input,
+                                           std::size_t output,
+                                           std::size_t index) {
+  return _mm_shuffle_epi8(
+      input, _mm_loadu_si128(reinterpret_cast<__m128i const *>(
+                 reverseRGBMasks.at(output).at(index).data())));
+}
+
+[[gnu::target("ssse3")]] __m128i shuffleRGBBlock(RGBBlock const &block,
+                                                 std::size_t output) {
+  return _mm_or_si128(_mm_or_si128(shuffleRGB(block.first, output, 0),
+                                   shuffleRGB(block.second, output, 1)),
+                      shuffleRGB(block.third, output, 2));
+}
+
+[[gnu::target("ssse3")]] RGBBlock reverseRGBBlock(RGBBlock const &block) {
+  return {.first = shuffleRGBBlock(block, 0),
+          .second = shuffleRGBBlock(block, 1),
+          .third = shuffleRGBBlock(block, 2)};
+}
+
+// Same as reverseRGBA, with blocks of 16 pixels in 3 registers
+[[gnu::target("ssse3")]] void reverseRGBWithSSSE3(unsigned char *row,
+                                                  std::size_t width) {
+  std::size_t first{};
+  std::size_t last{width};
+  for (; last - first >= 32; first += 16, last -= 16) {
+    auto *const left{row + first * 3};
+    auto *const right{row + (last - 16) * 3};
+    auto const leftPixels{reverseRGBBlock(loadRGBBlock(left))};
+    auto const rightPixels{reverseRGBBlock(loadRGBBlock(right))};
+    storeRGBBlock(left, rightPixels);
+    storeRGBBlock(right, leftPixels);
+  }
+  reversePixels(row, 3, first, last);
+}
+
+[[gnu::target("avx2")]] void swapRowsWithAVX2(unsigned char *first,
+                                              unsigned char *second,
+                                              std::size_t size) {
+  std::size_t offset{};
+  for (; offset + 32 <= size; offset += 32) {
+    auto *const firstBlock{reinterpret_cast<__m256i *>(first + offset)};
+    auto *const secondBlock{reinterpret_cast<__m256i *>(second + offset)};
+    auto const firstPixels{_mm256_loadu_si256(firstBlock)};
+    _mm256_storeu_si256(firstBlock, _mm256_loadu_si256(secondBlock));
+    _mm256_storeu_si256(secondBlock, firstPixels);
+  }
+  swapRows(first + offset, second + offset, size - offset);
+}
+#endif
+
+void reverseRow(unsigned char *row, std::size_t width,
+                std::size_t bytesPerPixel) {
+  [[maybe_unused]] auto const instructionSet{getInstructionSet()};
+#if defined(ABCG_IMAGE_DISPATCH)
+  if (bytesPerPixel == 4 && instructionSet == InstructionSet::AVX2) {
+    reverseRGBAWithAVX2(row, width);
+    return;
+  }
+  if (bytesPerPixel == 3 && instructionSet >= InstructionSet::SSSE3) {
+    reverseRGBWithSSSE3(row, width);
+    return;
+  }
+#endif
+#if defined(ABCG_IMAGE_SSE2)
+  if (bytesPerPixel == 4) {
+    reverseRGBA(row, width);
+    return;
+  }
+#endif
+  reversePixels(row, bytesPerPixel, 0, width);
+}
+
+void swapRowsWithBestInstructionSet(unsigned char *first,
+                                    unsigned char *second, std::size_t size) {
+#if defined(ABCG_IMAGE_DISPATCH)
+  if (getInstructionSet() == InstructionSet::AVX2) {
+    swapRowsWithAVX2(first, second, size);
+    return;
+  }
+#endif
+  swapRows(first, second, size);
+}
+
+// Source pixels covered by a pixel of the resized image, and their weights
+struct Footprint {
+  int first{};
+  std::vector<float> weights;
+};
+
+std::vector<Footprint> computeFootprints(int sourceSize, int size) {
+  auto const scale{gsl::narrow<float>(sourceSize) / gsl::narrow<float>(size)};
+  std::vector<Footprint> footprints(gsl::narrow<std::size_t>(size));
+  for (auto &&[index, footprint] : iter::enumerate(footprints)) {
+    auto const begin{gsl::narrow<float>(index) * scale};
+    auto const end{begin + scale};
+    footprint.first = gsl::narrow_cast<int>(begin);
+    auto const last{std::min(gsl::narrow_cast<int>(std::ceil(end)), sourceSize)};
+    for (auto const source : iter::range(footprint.first, last)) {
+      auto const coverage{
+          std::min(end, gsl::narrow<float>(source + 1)) -
+          std::max(begin, gsl::narrow<float>(source))};
+      footprint.weights.push_back(coverage / scale);
+    }
+  }
+  return footprints;
+}
+} // namespace
+
 /**
  * @brief Flips an image horizontally.
  *
- * Reverses each row of the image, in place.
+ * Reverses each row of the image, in place. RGBA images are processed with
+ * SSE2 or AVX2, and RGB images with SSSE3, when the CPU supports them.
  *
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipHorizontally(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         widthInBytes * height};
-
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(gsl::narrow<std::size_t>(widthInBytes), {});
+  auto const bytesPerPixel{
+      gsl::narrow<std::size_t>(surface.format->BytesPerPixel)};
+  auto const width{gsl::narrow<std::size_t>(surface.w)};
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
 
   SDL_LockSurface(&surface);
 
-  // For each row
-  for (auto const rowIndex : iter::range(height)) {
-    auto const rowStart{widthInBytes * rowIndex};
-    auto const rowEnd{rowStart + widthInBytes};
-    // For each pixel (RGB/RGA) of current row
-    auto srcBegin{pixels.begin() + gsl::narrow<long>(rowEnd)};
-    auto dstBegin{pixelRow.begin()};
-    for ([[maybe_unused]] auto const pixelIndex : iter::range(surface.w)) {
-      srcBegin -= bytesPerPixel;
-      std::copy(srcBegin, srcBegin + bytesPerPixel, dstBegin);
-      dstBegin += bytesPerPixel;
-    }
-    // std::ranges::copy(pixelRow, pixels.subspan(rowStart).begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              pixels.subspan(rowStart).begin());
+  auto *const pixels{static_cast<unsigned char *>(surface.pixels)};
+  for (auto const rowIndex : iter::range(surface.h)) {
+    reverseRow(pixels + gsl::narrow<std::size_t>(rowIndex) * pitch, width,
+               bytesPerPixel);
   }
 
   SDL_UnlockSurface(&surface);
@@ -59,44 +300,99 @@ void abcg::flipHorizontally(SDL_Surface &surface) {
 /**
  * @brief Flips an image vertically.
  *
- * Reverses each column of the image, in place.
+ * Reverses each column of the image, in place, by swapping rows with SSE2 or
+ * AVX2 when the CPU supports them.
  *
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipVertically(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
+  auto const widthInBytes{
+      gsl::narrow<std::size_t>(surface.w * surface.format->BytesPerPixel)};
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
   auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         gsl::narrow<std::size_t>(widthInBytes * height)};
-
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(widthInBytes, std::byte{});
 
   SDL_LockSurface(&surface);
 
   // If height is odd, won't swap the middle row
-  for (auto const halfHeight{height / 2};
-       auto const rowIndex : iter::range(halfHeight)) {
-    auto const rowStartFromTop{widthInBytes * rowIndex};
-    auto const rowStartFromBottom{widthInBytes * (height - rowIndex - 1)};
-
-    auto const &topSpan{pixels.subspan(rowStartFromTop)};
-    auto const &bottomSpan{pixels.subspan(rowStartFromBottom)};
-
-    // std::ranges::copy(topSpan.subspan(0, widthInBytes), pixelRow.begin());
-    // std::ranges::copy(bottomSpan.subspan(0, widthInBytes), topSpan.begin());
-    // std::ranges::copy(pixelRow, bottomSpan.begin());
-    std::copy(topSpan.begin(),
-              topSpan.begin() + gsl::narrow<long>(widthInBytes),
-              pixelRow.begin());
-    std::copy(bottomSpan.begin(),
-              bottomSpan.begin() + gsl::narrow<long>(widthInBytes),
-              topSpan.begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              bottomSpan.begin());
+  auto *const pixels{static_cast<unsigned char *>(surface.pixels)};
+  for (auto const rowIndex : iter::range(height / 2)) {
+    swapRowsWithBestInstructionSet(pixels + pitch * rowIndex,
+                                   pixels + pitch * (height - rowIndex - 1),
+                                   widthInBytes);
   }
 
   SDL_UnlockSurface(&surface);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Creates a resized copy of an image.
+ *
+ * Each pixel of the new image is the average of the pixels it covers in the
+ * original image, weighted by the covered area. This avoids the aliasing of
+ * nearest-neighbor sampling when the image is reduced.
+ *
+ * @param surface SDL surface of a RGB or RGBA image.
+ * @param width Width of the new image.
+ * @param height Height of the new image.
+ *
+ * @return SDL surface with the same pixel format, or `nullptr` if it could not
+ * be created. It must be released with `SDL_FreeSurface`.
+ */
+SDL_Surface *abcg::resize(SDL_Surface &surface, int width, int height) {
+  auto *const resized{SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, surface.format->BitsPerPixel, surface.format->format)};
+  if (resized == nullptr)
+    return nullptr;
+
+  auto const channels{gsl::narrow<std::size_t>(surface.format->BytesPerPixel)};
+  auto const sourceHeight{gsl::narrow<std::size_t>(surface.h)};
+  auto const rowSize{gsl::narrow<std::size_t>(width) * channels};
+  auto const columns{computeFootprints(surface.w, width)};
+  auto const rows{computeFootprints(surface.h, height)};
+
+  SDL_LockSurface(&surface);
+
+  // Resize the rows first, keeping the intermediate image in floating point
+  std::vector<float> scaledRows(rowSize * sourceHeight);
+  for (auto const row : iter::range(sourceHeight)) {
+    auto const *const source{static_cast<unsigned char const *>(surface.pixels) +
+                             row * gsl::narrow<std::size_t>(surface.pitch)};
+    auto *const target{scaledRows.data() + row * rowSize};
+    for (auto &&[column, footprint] : iter::enumerate(columns)) {
+      for (auto &&[offset, weight] : iter::enumerate(footprint.weights)) {
+        auto const *const pixel{
+            source + (gsl::narrow<std::size_t>(footprint.first) + offset) *
+                         channels};
+        for (auto const channel : iter::range(channels)) {
+          target[column * channels + channel] +=
+              weight * gsl::narrow<float>(pixel[channel]);
+        }
+      }
+    }
+  }
+
+  SDL_UnlockSurface(&surface);
+
+  // Then the columns
+  std::vector<float> accumulator(rowSize);
+  for (auto &&[row, footprint] : iter::enumerate(rows)) {
+    std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+    for (auto &&[offset, weight] : iter::enumerate(footprint.weights)) {
+      auto const *const source{
+          scaledRows.data() +
+          (gsl::narrow<std::size_t>(footprint.first) + offset) * rowSize};
+      for (auto const index : iter::range(rowSize)) {
+        accumulator[index] += weight * source[index];
+      }
+    }
+    auto *const target{static_cast<unsigned char *>(resized->pixels) +
+                       row * gsl::narrow<std::size_t>(resized->pitch)};
+    std::transform(accumulator.begin(), accumulator.end(), target,
+                   [](float value) {
+                     return gsl::narrow_cast<unsigned char>(
+                         std::clamp(value + 0.5f, 0.0f, 255.0f));
+                   });
+  }
+
+  return resized;
+}
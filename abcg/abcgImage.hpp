@@ -16,6 +16,8 @@
 namespace abcg {
 void flipHorizontally(SDL_Surface &surface);
 void flipVertically(SDL_Surface &surface);
+[[nodiscard]] SDL_Surface *resize(SDL_Surface &surface, int width,
+                                  int height);
 } // namespace abcg
 
 #endif
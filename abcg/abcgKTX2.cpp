@@ -0,0 +1,919 @@
+/**
+ * @file abcgKTX2.cpp
+ * @brief Definition of KTX2 texture container helper functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgKTX2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include "abcgException.hpp"
+
+namespace {
+constexpr std::array<unsigned char, 12> identifier{
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr std::size_t headerSize{80};
+constexpr std::size_t levelIndexEntrySize{24};
+constexpr std::string_view orientationKey{"KTXorientation"};
+
+// Values of VkFormat
+constexpr std::uint32_t vkFormatRGBA8Unorm{37};
+constexpr std::uint32_t vkFormatRGBA8SRGB{43};
+constexpr std::uint32_t vkFormatBC1RGBUnorm{131};
+constexpr std::uint32_t vkFormatBC1RGBSRGB{132};
+constexpr std::uint32_t vkFormatETC2RGB8Unorm{147};
+constexpr std::uint32_t vkFormatETC2RGB8SRGB{148};
+
+constexpr std::size_t channels{4};
+constexpr std::size_t blockBytes{8};
+constexpr int blockSize{4};
+
+// 4x4 texels of a block, in row-major order
+using Block = std::array<glm::ivec3, 16>;
+
+// ETC1 intensity modifiers, indexed by codeword; the pixel index selects +a,
+// +b, -a or -b
+constexpr std::array<std::array<int, 2>, 8> etcModifiers{{{2, 8},
+                                                           {5, 17},
+                                                           {9, 29},
+                                                           {13, 42},
+                                                           {18, 60},
+                                                           {24, 80},
+                                                           {33, 106},
+                                                           {47, 183}}};
+constexpr std::array<int, 8> etcDistances{3, 6, 11, 16, 23, 32, 41, 64};
+
+int getModifier(std::size_t codeword, std::size_t index) {
+  auto const value{etcModifiers.at(codeword).at(index % 2)};
+  return index < 2 ? value : -value;
+}
+
+bool isCompressed(abcg::KTX2Format format) {
+  return format != abcg::KTX2Format::RGBA8;
+}
+
+std::uint32_t toVkFormat(abcg::KTX2Format format, bool sRGB) {
+  switch (format) {
+  case abcg::KTX2Format::BC1:
+    return sRGB ? vkFormatBC1RGBSRGB : vkFormatBC1RGBUnorm;
+  case abcg::KTX2Format::ETC2:
+    return sRGB ? vkFormatETC2RGB8SRGB : vkFormatETC2RGB8Unorm;
+  default:
+    return sRGB ? vkFormatRGBA8SRGB : vkFormatRGBA8Unorm;
+  }
+}
+
+glm::ivec2 getLevelExtent(glm::ivec2 const &size, std::size_t level) {
+  auto const shift{gsl::narrow<int>(level)};
+  return {std::max(size.x >> shift, 1), std::max(size.y >> shift, 1)};
+}
+
+glm::ivec2 getBlockCount(glm::ivec2 const &extent) {
+  return (extent + (blockSize - 1)) / blockSize;
+}
+
+std::size_t getLevelSize(abcg::KTX2Format format, glm::ivec2 const &extent) {
+  if (!isCompressed(format)) {
+    return gsl::narrow<std::size_t>(extent.x) *
+           gsl::narrow<std::size_t>(extent.y) * channels;
+  }
+  auto const blocks{getBlockCount(extent)};
+  return gsl::narrow<std::size_t>(blocks.x) *
+         gsl::narrow<std::size_t>(blocks.y) * blockBytes;
+}
+
+template <typename T>
+T readLE(std::span<unsigned char const> data, std::size_t offset) {
+  if (offset + sizeof(T) > data.size()) {
+    throw abcg::RuntimeError("Truncated KTX2 file");
+  }
+  T value{};
+  for (auto const byte : iter::range(sizeof(T))) {
+    value |= static_cast<T>(static_cast<T>(data[offset + byte]) << (byte * 8));
+  }
+  return value;
+}
+
+template <typename T>
+void writeLE(std::vector<unsigned char> &data, std::size_t offset, T value) {
+  for (auto const byte : iter::range(sizeof(T))) {
+    data.at(offset + byte) = static_cast<unsigned char>(value >> (byte * 8));
+  }
+}
+
+// Fetches a block of RGB texels, replicating the last row and column on
+// partial blocks
+Block fetchBlock(std::span<unsigned char const> pixels,
+                 glm::ivec2 const &extent, glm::ivec2 const &block) {
+  Block texels{};
+  for (auto const y : iter::range(blockSize)) {
+    auto const row{std::min(block.y * blockSize + y, extent.y - 1)};
+    for (auto const x : iter::range(blockSize)) {
+      auto const column{std::min(block.x * blockSize + x, extent.x - 1)};
+      auto const offset{gsl::narrow<std::size_t>(row * extent.x + column) *
+                        channels};
+      texels.at(gsl::narrow<std::size_t>(y * blockSize + x)) = {
+          pixels[offset], pixels[offset + 1], pixels[offset + 2]};
+    }
+  }
+  return texels;
+}
+
+void storeBlock(Block const &texels, glm::ivec2 const &extent,
+                glm::ivec2 const &block, std::span<unsigned char> pixels) {
+  for (auto const y : iter::range(blockSize)) {
+    auto const row{block.y * blockSize + y};
+    for (auto const x : iter::range(blockSize)) {
+      auto const column{block.x * blockSize + x};
+      if (row >= extent.y || column >= extent.x)
+        continue;
+      auto const offset{gsl::narrow<std::size_t>(row * extent.x + column) *
+                        channels};
+      auto const &texel{texels.at(gsl::narrow<std::size_t>(y * blockSize + x))};
+      pixels[offset] = static_cast<unsigned char>(texel.r);
+      pixels[offset + 1] = static_cast<unsigned char>(texel.g);
+      pixels[offset + 2] = static_cast<unsigned char>(texel.b);
+      pixels[offset + 3] = 255;
+    }
+  }
+}
+
+int distance2(glm::ivec3 const &lhs, glm::ivec3 const &rhs) {
+  auto const difference{lhs - rhs};
+  return difference.x * difference.x + difference.y * difference.y +
+         difference.z * difference.z;
+}
+
+// BC1
+
+glm::ivec3 unpack565(std::uint16_t color) {
+  auto const red{(color >> 11) & 0x1F};
+  auto const green{(color >> 5) & 0x3F};
+  auto const blue{color & 0x1F};
+  return {(red << 3) | (red >> 2), (green << 2) | (green >> 4),
+          (blue << 3) | (blue >> 2)};
+}
+
+std::uint16_t pack565(glm::vec3 const &color) {
+  auto const quantize{[](float value, int max) {
+    return std::clamp(static_cast<int>(std::lround(value / 255.0f *
+                                                   static_cast<float>(max))),
+                      0, max);
+  }};
+  return static_cast<std::uint16_t>((quantize(color.r, 31) << 11) |
+                                    (quantize(color.g, 63) << 5) |
+                                    quantize(color.b, 31));
+}
+
+std::array<glm::ivec3, 4> getBC1Palette(std::uint16_t color0,
+                                        std::uint16_t color1) {
+  auto const endpoint0{unpack565(color0)};
+  auto const endpoint1{unpack565(color1)};
+  if (color0 > color1) {
+    return {endpoint0, endpoint1, (2 * endpoint0 + endpoint1) / 3,
+            (endpoint0 + 2 * endpoint1) / 3};
+  }
+  return {endpoint0, endpoint1, (endpoint0 + endpoint1) / 2, glm::ivec3{0}};
+}
+
+// Endpoints are the extremes of the texels along the principal axis of the
+// block
+void encodeBC1(Block const &texels, std::span<unsigned char> output) {
+  glm::vec3 mean{};
+  for (auto const &texel : texels) {
+    mean += glm::vec3{texel};
+  }
+  mean /= static_cast<float>(texels.size());
+
+  glm::mat3 covariance{0.0f};
+  for (auto const &texel : texels) {
+    auto const difference{glm::vec3{texel} - mean};
+    covariance += glm::outerProduct(difference, difference);
+  }
+
+  // Power iteration
+  glm::vec3 axis{1.0f};
+  for ([[maybe_unused]] auto const _ : iter::range(4)) {
+    axis = covariance * axis;
+    if (auto const length{glm::length(axis)}; length > 1e-4f) {
+      axis /= length;
+    } else {
+      axis = glm::vec3{0.0f};
+      break;
+    }
+  }
+
+  auto minProjection{std::numeric_limits<float>::max()};
+  auto maxProjection{std::numeric_limits<float>::lowest()};
+  for (auto const &texel : texels) {
+    auto const projection{glm::dot(glm::vec3{texel} - mean, axis)};
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  auto color0{pack565(glm::clamp(mean + axis * maxProjection, 0.0f, 255.0f))};
+  auto color1{pack565(glm::clamp(mean + axis * minProjection, 0.0f, 255.0f))};
+  // color0 > color1 selects the mode with four colors
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+  auto const palette{getBC1Palette(color0, color1)};
+  auto const numColors{color0 == color1 ? std::size_t{1} : std::size_t{4}};
+
+  std::uint32_t indices{};
+  for (auto const texelIndex : iter::range(texels.size())) {
+    std::size_t best{};
+    auto bestError{std::numeric_limits<int>::max()};
+    for (auto const index : iter::range(numColors)) {
+      if (auto const error{distance2(texels.at(texelIndex), palette.at(index))};
+          error < bestError) {
+        bestError = error;
+        best = index;
+      }
+    }
+    indices |= gsl::narrow<std::uint32_t>(best) << (texelIndex * 2);
+  }
+
+  for (auto const byte : iter::range(std::size_t{2})) {
+    output[byte] = static_cast<unsigned char>(color0 >> (byte * 8));
+    output[2 + byte] = static_cast<unsigned char>(color1 >> (byte * 8));
+  }
+  for (auto const byte : iter::range(std::size_t{4})) {
+    output[4 + byte] = static_cast<unsigned char>(indices >> (byte * 8));
+  }
+}
+
+Block decodeBC1(std::span<unsigned char const> input) {
+  auto const color0{readLE<std::uint16_t>(input, 0)};
+  auto const color1{readLE<std::uint16_t>(input, 2)};
+  auto const indices{readLE<std::uint32_t>(input, 4)};
+  auto const palette{getBC1Palette(color0, color1)};
+
+  Block texels{};
+  for (auto const texelIndex : iter::range(texels.size())) {
+    texels.at(texelIndex) = palette.at((indices >> (texelIndex * 2)) & 0x3);
+  }
+  return texels;
+}
+
+// ETC2
+
+std::uint64_t getBits(std::uint64_t bits, int first, int count) {
+  return (bits >> first) & ((std::uint64_t{1} << count) - 1);
+}
+
+int extend4(std::uint64_t value) {
+  return static_cast<int>((value << 4) | value);
+}
+
+glm::ivec3 extend5(glm::ivec3 const &value) {
+  return (value << 3) | (value >> 2);
+}
+
+// Pixel indices are stored column by column
+int getPixelBit(int x, int y) { return x * blockSize + y; }
+
+bool isInSecondSubblock(int x, int y, bool flip) {
+  return flip ? y >= 2 : x >= 2;
+}
+
+struct SubblockFit {
+  int error{std::numeric_limits<int>::max()};
+  std::size_t codeword{};
+  std::array<std::size_t, 16> indices{};
+};
+
+SubblockFit fitSubblock(Block const &texels, bool flip, bool second,
+                        glm::ivec3 const &base) {
+  SubblockFit best;
+  for (auto const codeword : iter::range(etcModifiers.size())) {
+    SubblockFit fit{.error = 0, .codeword = codeword, .indices = {}};
+    for (auto const texelIndex : iter::range(texels.size())) {
+      auto const x{gsl::narrow<int>(texelIndex) % blockSize};
+      auto const y{gsl::narrow<int>(texelIndex) / blockSize};
+      if (isInSecondSubblock(x, y, flip) != second)
+        continue;
+      auto bestError{std::numeric_limits<int>::max()};
+      for (auto const index : iter::range(std::size_t{4})) {
+        auto const color{
+            glm::clamp(base + getModifier(codeword, index), 0, 255)};
+        if (auto const error{distance2(texels.at(texelIndex), color)};
+            error < bestError) {
+          bestError = error;
+          fit.indices.at(texelIndex) = index;
+        }
+      }
+      fit.error += bestError;
+    }
+    if (fit.error < best.error) {
+      best = fit;
+    }
+  }
+  return best;
+}
+
+// Encodes in the individual or differential modes of ETC1, which are a subset
+// of ETC2. The base colors are the quantized averages of the subblocks
+void encodeETC2(Block const &texels, std::span<unsigned char> output) {
+  auto bestError{std::numeric_limits<int>::max()};
+  std::uint64_t bestBits{};
+
+  for (auto const flip : {false, true}) {
+    std::array<glm::vec3, 2> averages{};
+    for (auto const texelIndex : iter::range(texels.size())) {
+      auto const x{gsl::narrow<int>(texelIndex) % blockSize};
+      auto const y{gsl::narrow<int>(texelIndex) / blockSize};
+      averages.at(isInSecondSubblock(x, y, flip) ? 1 : 0) +=
+          glm::vec3{texels.at(texelIndex)} / 8.0f;
+    }
+
+    for (auto const differential : {true, false}) {
+      auto const maxValue{differential ? 31.0f : 15.0f};
+      std::array<glm::ivec3, 2> quantized{};
+      for (auto const subblock : iter::range(std::size_t{2})) {
+        quantized.at(subblock) =
+            glm::clamp(glm::ivec3{glm::round(averages.at(subblock) / 255.0f *
+                                             maxValue)},
+                       0, static_cast<int>(maxValue));
+      }
+      auto const delta{quantized[1] - quantized[0]};
+      if (differential && (glm::any(glm::lessThan(delta, glm::ivec3{-4})) ||
+                           glm::any(glm::greaterThan(delta, glm::ivec3{3})))) {
+        continue;
+      }
+
+      std::array<SubblockFit, 2> fits{};
+      for (auto const subblock : iter::range(std::size_t{2})) {
+        auto const &color{quantized.at(subblock)};
+        glm::ivec3 const base{differential ? extend5(color)
+                                           : glm::ivec3{(color << 4) | color}};
+        fits.at(subblock) = fitSubblock(texels, flip, subblock == 1, base);
+      }
+      auto const error{fits[0].error + fits[1].error};
+      if (error >= bestError)
+        continue;
+
+      std::uint64_t bits{};
+      for (auto const channel : iter::range(3)) {
+        auto const shift{56 - channel * 8};
+        if (differential) {
+          bits |= std::uint64_t(quantized[0][channel]) << (shift + 3);
+          bits |= std::uint64_t(delta[channel] & 0x7) << shift;
+        } else {
+          bits |= std::uint64_t(quantized[0][channel]) << (shift + 4);
+          bits |= std::uint64_t(quantized[1][channel]) << shift;
+        }
+      }
+      bits |= std::uint64_t{fits[0].codeword} << 37;
+      bits |= std::uint64_t{fits[1].codeword} << 34;
+      bits |= std::uint64_t(differential ? 1 : 0) << 33;
+      bits |= std::uint64_t(flip ? 1 : 0) << 32;
+      for (auto const texelIndex : iter::range(texels.size())) {
+        auto const x{gsl::narrow<int>(texelIndex) % blockSize};
+        auto const y{gsl::narrow<int>(texelIndex) / blockSize};
+        auto const &fit{fits.at(isInSecondSubblock(x, y, flip) ? 1 : 0)};
+        auto const index{fit.indices.at(texelIndex)};
+        bits |= std::uint64_t{index >> 1} << (16 + getPixelBit(x, y));
+        bits |= std::uint64_t{index & 1} << getPixelBit(x, y);
+      }
+
+      bestError = error;
+      bestBits = bits;
+    }
+  }
+
+  // Blocks are big-endian
+  for (auto const byte : iter::range(std::size_t{8})) {
+    output[byte] = static_cast<unsigned char>(bestBits >> (56 - byte * 8));
+  }
+}
+
+Block decodeETC2(std::span<unsigned char const> input) {
+  std::uint64_t bits{};
+  for (auto const byte : iter::range(std::size_t{8})) {
+    bits = (bits << 8) | input[byte];
+  }
+
+  auto const getIndex{[bits](int x, int y) {
+    auto const bit{getPixelBit(x, y)};
+    return gsl::narrow<std::size_t>((getBits(bits, 16 + bit, 1) << 1) |
+                                    getBits(bits, bit, 1));
+  }};
+  auto const forEachTexel{[](auto const &function) {
+    Block texels{};
+    for (auto const y : iter::range(blockSize)) {
+      for (auto const x : iter::range(blockSize)) {
+        texels.at(gsl::narrow<std::size_t>(y * blockSize + x)) =
+            glm::clamp(function(x, y), 0, 255);
+      }
+    }
+    return texels;
+  }};
+
+  auto const flip{getBits(bits, 32, 1) != 0};
+  std::array<glm::ivec3, 2> bases{};
+  if (getBits(bits, 33, 1) == 0) {
+    for (auto const channel : iter::range(3)) {
+      auto const shift{56 - channel * 8};
+      bases[0][channel] = extend4(getBits(bits, shift + 4, 4));
+      bases[1][channel] = extend4(getBits(bits, shift, 4));
+    }
+  } else {
+    glm::ivec3 base{};
+    glm::ivec3 delta{};
+    for (auto const channel : iter::range(3)) {
+      auto const shift{56 - channel * 8};
+      base[channel] = static_cast<int>(getBits(bits, shift + 3, 5));
+      delta[channel] = static_cast<int>(getBits(bits, shift, 3));
+      delta[channel] -= delta[channel] >= 4 ? 8 : 0;
+    }
+    auto const sum{base + delta};
+
+    if (sum.r < 0 || sum.r > 31) {
+      // T mode
+      auto const red1{(getBits(bits, 59, 2) << 2) | getBits(bits, 56, 2)};
+      glm::ivec3 const color1{extend4(red1), extend4(getBits(bits, 52, 4)),
+                              extend4(getBits(bits, 48, 4))};
+      glm::ivec3 const color2{extend4(getBits(bits, 44, 4)),
+                              extend4(getBits(bits, 40, 4)),
+                              extend4(getBits(bits, 36, 4))};
+      auto const distance{etcDistances.at(
+          (getBits(bits, 34, 2) << 1) | getBits(bits, 32, 1))};
+      std::array const paint{color1, color2 + distance, color2,
+                             color2 - distance};
+      return forEachTexel(
+          [&](int x, int y) { return paint.at(getIndex(x, y)); });
+    }
+
+    if (sum.g < 0 || sum.g > 31) {
+      // H mode
+      std::array const raw1{getBits(bits, 59, 4),
+                            (getBits(bits, 56, 3) << 1) | getBits(bits, 52, 1),
+                            (getBits(bits, 51, 1) << 3) |
+                                getBits(bits, 47, 3)};
+      std::array const raw2{getBits(bits, 43, 4), getBits(bits, 39, 4),
+                            getBits(bits, 35, 4)};
+      auto const value1{(raw1[0] << 8) | (raw1[1] << 4) | raw1[2]};
+      auto const value2{(raw2[0] << 8) | (raw2[1] << 4) | raw2[2]};
+      auto const distance{etcDistances.at((getBits(bits, 34, 1) << 2) |
+                                          (getBits(bits, 32, 1) << 1) |
+                                          (value1 >= value2 ? 1 : 0))};
+      glm::ivec3 const color1{extend4(raw1[0]), extend4(raw1[1]),
+                              extend4(raw1[2])};
+      glm::ivec3 const color2{extend4(raw2[0]), extend4(raw2[1]),
+                              extend4(raw2[2])};
+      std::array const paint{color1 + distance, color1 - distance,
+                             color2 + distance, color2 - distance};
+      return forEachTexel(
+          [&](int x, int y) { return paint.at(getIndex(x, y)); });
+    }
+
+    if (sum.b < 0 || sum.b > 31) {
+      // Planar mode
+      auto const extend6{[](std::uint64_t value) {
+        return static_cast<int>((value << 2) | (value >> 4));
+      }};
+      auto const extend7{[](std::uint64_t value) {
+        return static_cast<int>((value << 1) | (value >> 6));
+      }};
+      glm::ivec3 const origin{
+          extend6(getBits(bits, 57, 6)),
+          extend7((getBits(bits, 56, 1) << 6) | getBits(bits, 49, 6)),
+          extend6((getBits(bits, 48, 1) << 5) | (getBits(bits, 43, 2) << 3) |
+                  getBits(bits, 39, 3))};
+      glm::ivec3 const horizontal{
+          extend6((getBits(bits, 34, 5) << 1) | getBits(bits, 32, 1)),
+          extend7(getBits(bits, 25, 7)), extend6(getBits(bits, 19, 6))};
+      glm::ivec3 const vertical{extend6(getBits(bits, 13, 6)),
+                                extend7(getBits(bits, 6, 7)),
+                                extend6(getBits(bits, 0, 6))};
+      return forEachTexel([&](int x, int y) {
+        return (x * (horizontal - origin) + y * (vertical - origin) +
+                4 * origin + 2) >>
+               2;
+      });
+    }
+
+    bases[0] = extend5(base);
+    bases[1] = extend5(sum);
+  }
+
+  std::array const codewords{getBits(bits, 37, 3), getBits(bits, 34, 3)};
+  return forEachTexel([&](int x, int y) {
+    auto const subblock{isInSecondSubblock(x, y, flip) ? 1U : 0U};
+    return bases.at(subblock) +
+           getModifier(codewords.at(subblock), getIndex(x, y));
+  });
+}
+
+// Box filter, averaged in linear space if the pixels are in sRGB space
+std::vector<unsigned char> downsample(std::span<unsigned char const> pixels,
+                                      glm::ivec2 const &size, bool sRGB) {
+  static auto const toLinear{[] {
+    std::array<float, 256> table{};
+    for (auto const value : iter::range(table.size())) {
+      auto const normalized{static_cast<float>(value) / 255.0f};
+      table.at(value) = normalized <= 0.04045f
+                            ? normalized / 12.92f
+                            : std::pow((normalized + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }()};
+  auto const fromLinear{[](float value) {
+    return value <= 0.0031308f ? value * 12.92f
+                               : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+  }};
+
+  auto const extent{getLevelExtent(size, 1)};
+  std::vector<unsigned char> result(getLevelSize(abcg::KTX2Format::RGBA8,
+                                                 extent));
+  for (auto const y : iter::range(extent.y)) {
+    for (auto const x : iter::range(extent.x)) {
+      for (auto const channel : iter::range(channels)) {
+        auto sum{0.0f};
+        for (auto const offset :
+             {glm::ivec2{0, 0}, glm::ivec2{1, 0}, glm::ivec2{0, 1},
+              glm::ivec2{1, 1}}) {
+          auto const source{
+              glm::min(glm::ivec2{x, y} * 2 + offset, size - 1)};
+          auto const value{pixels[gsl::narrow<std::size_t>(
+                                      source.y * size.x + source.x) *
+                                      channels +
+                                  channel]};
+          sum += sRGB && channel < 3 ? toLinear.at(value)
+                                     : static_cast<float>(value) / 255.0f;
+        }
+        auto const average{sRGB && channel < 3 ? fromLinear(sum / 4.0f)
+                                               : sum / 4.0f};
+        result[gsl::narrow<std::size_t>(y * extent.x + x) * channels +
+               channel] = static_cast<unsigned char>(
+            std::lround(std::clamp(average, 0.0f, 1.0f) * 255.0f));
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<unsigned char>
+encodeLevel(abcg::KTX2Format format, std::span<unsigned char const> pixels,
+            glm::ivec2 const &extent) {
+  if (!isCompressed(format)) {
+    return {pixels.begin(), pixels.end()};
+  }
+
+  std::vector<unsigned char> data(getLevelSize(format, extent));
+  std::span output{data};
+  auto const blocks{getBlockCount(extent)};
+  for (auto const blockY : iter::range(blocks.y)) {
+    for (auto const blockX : iter::range(blocks.x)) {
+      auto const texels{fetchBlock(pixels, extent, {blockX, blockY})};
+      auto const block{output.subspan(
+          gsl::narrow<std::size_t>(blockY * blocks.x + blockX) * blockBytes,
+          blockBytes)};
+      if (format == abcg::KTX2Format::BC1) {
+        encodeBC1(texels, block);
+      } else {
+        encodeETC2(texels, block);
+      }
+    }
+  }
+  return data;
+}
+} // namespace
+
+/**
+ * @brief Reads a KTX2 file.
+ *
+ * @param path Path to the KTX2 file.
+ *
+ * @throw abcg::RuntimeError if the file could not be read, or if it is not a
+ * 2D texture in one of the formats of abcg::KTX2Format, without
+ * supercompression.
+ *
+ * @return Image with all mipmap levels stored in the file.
+ */
+abcg::KTX2Image abcg::readKTX2(std::string_view path) {
+  std::ifstream stream(std::string{path}, std::ios::binary);
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to open KTX2 file {}", path));
+  }
+  std::vector<unsigned char> const file{std::istreambuf_iterator<char>(stream),
+                                        std::istreambuf_iterator<char>()};
+  std::span const data{file};
+
+  if (data.size() < headerSize ||
+      !std::equal(identifier.begin(), identifier.end(), data.begin())) {
+    throw abcg::RuntimeError(fmt::format("{} is not a KTX2 file", path));
+  }
+
+  KTX2Image image;
+  switch (readLE<std::uint32_t>(data, 12)) {
+  case vkFormatRGBA8SRGB:
+    image.sRGB = true;
+    [[fallthrough]];
+  case vkFormatRGBA8Unorm:
+    image.format = KTX2Format::RGBA8;
+    break;
+  case vkFormatBC1RGBSRGB:
+    image.sRGB = true;
+    [[fallthrough]];
+  case vkFormatBC1RGBUnorm:
+    image.format = KTX2Format::BC1;
+    break;
+  case vkFormatETC2RGB8SRGB:
+    image.sRGB = true;
+    [[fallthrough]];
+  case vkFormatETC2RGB8Unorm:
+    image.format = KTX2Format::ETC2;
+    break;
+  default:
+    throw abcg::RuntimeError(
+        fmt::format("Unsupported pixel format in KTX2 file {}", path));
+  }
+
+  image.size = {gsl::narrow<int>(readLE<std::uint32_t>(data, 20)),
+                gsl::narrow<int>(readLE<std::uint32_t>(data, 24))};
+  auto const depth{readLE<std::uint32_t>(data, 28)};
+  auto const layers{readLE<std::uint32_t>(data, 32)};
+  auto const faces{readLE<std::uint32_t>(data, 36)};
+  auto const numLevels{std::max(readLE<std::uint32_t>(data, 40), 1U)};
+  auto const supercompression{readLE<std::uint32_t>(data, 44)};
+  if (image.size.x <= 0 || image.size.y <= 0 || depth != 0 || layers > 1 ||
+      faces != 1 || supercompression != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Unsupported texture type in KTX2 file {}", path));
+  }
+
+  // Key/value data
+  auto const kvdOffset{std::size_t{readLE<std::uint32_t>(data, 56)}};
+  auto const kvdEnd{kvdOffset + readLE<std::uint32_t>(data, 60)};
+  for (auto offset{kvdOffset}; offset + 4 <= kvdEnd;) {
+    auto const length{std::size_t{readLE<std::uint32_t>(data, offset)}};
+    if (offset + 4 + length > data.size())
+      break;
+    std::string_view const entry{
+        reinterpret_cast<char const *>( // NOLINT
+            data.subspan(offset + 4, length).data()),
+        length};
+    if (auto const separator{entry.find('\0')};
+        entry.substr(0, separator) == orientationKey &&
+        separator + 2 < entry.size()) {
+      image.bottomUp = entry[separator + 2] == 'u';
+    }
+    offset += 4 + (length + 3) / 4 * 4;
+  }
+
+  for (auto const level : iter::range(std::size_t{numLevels})) {
+    auto const entry{headerSize + level * levelIndexEntrySize};
+    auto const offset{readLE<std::uint64_t>(data, entry)};
+    auto const length{readLE<std::uint64_t>(data, entry + 8)};
+    if (length != getLevelSize(image.format,
+                               getLevelExtent(image.size, level)) ||
+        offset + length > data.size()) {
+      throw abcg::RuntimeError(
+          fmt::format("Invalid mipmap level in KTX2 file {}", path));
+    }
+    auto const first{data.begin() + gsl::narrow<std::ptrdiff_t>(offset)};
+    image.levels.emplace_back(first,
+                              first + gsl::narrow<std::ptrdiff_t>(length));
+  }
+
+  return image;
+}
+
+/**
+ * @brief Writes a KTX2 file.
+ *
+ * The file contains a basic data format descriptor and the `KTXorientation`
+ * key, so that it can be inspected with the tools of the KTX-Software
+ * distribution.
+ *
+ * @param image Image to write.
+ * @param path Path to the output file.
+ *
+ * @throw abcg::RuntimeError if the image is empty, if the size of a level does
+ * not match the format, or if the file could not be written.
+ */
+void abcg::writeKTX2(KTX2Image const &image, std::string_view path) {
+  if (image.levels.empty()) {
+    throw abcg::RuntimeError(fmt::format("No data to write to {}", path));
+  }
+  for (auto &&[level, data] : iter::enumerate(image.levels)) {
+    if (data.size() !=
+        getLevelSize(image.format, getLevelExtent(image.size, level))) {
+      throw abcg::RuntimeError(
+          fmt::format("Invalid size of mipmap level {} for {}", level, path));
+    }
+  }
+
+  auto const numLevels{image.levels.size()};
+  auto const compressed{isCompressed(image.format)};
+  auto const numSamples{compressed ? std::size_t{1} : channels};
+  auto const dfdOffset{headerSize + numLevels * levelIndexEntrySize};
+  auto const dfdLength{4 + 24 + numSamples * 16};
+  std::string const orientation{image.bottomUp ? "ru" : "rd"};
+  auto const kvdOffset{dfdOffset + dfdLength};
+  auto const keyValueLength{orientationKey.size() + orientation.size() + 2};
+  auto const kvdLength{4 + (keyValueLength + 3) / 4 * 4};
+  auto const alignment{compressed ? blockBytes : channels};
+
+  // Levels are stored from the smallest one up
+  std::vector<std::size_t> levelOffsets(numLevels);
+  auto fileSize{kvdOffset + kvdLength};
+  for (auto level{numLevels}; level-- > 0;) {
+    fileSize = (fileSize + alignment - 1) / alignment * alignment;
+    levelOffsets.at(level) = fileSize;
+    fileSize += image.levels.at(level).size();
+  }
+
+  std::vector<unsigned char> file(fileSize);
+  std::copy(identifier.begin(), identifier.end(), file.begin());
+  writeLE(file, 12, toVkFormat(image.format, image.sRGB));
+  writeLE(file, 16, std::uint32_t{1}); // typeSize
+  writeLE(file, 20, gsl::narrow<std::uint32_t>(image.size.x));
+  writeLE(file, 24, gsl::narrow<std::uint32_t>(image.size.y));
+  writeLE(file, 36, std::uint32_t{1}); // faceCount
+  writeLE(file, 40, gsl::narrow<std::uint32_t>(numLevels));
+  writeLE(file, 48, gsl::narrow<std::uint32_t>(dfdOffset));
+  writeLE(file, 52, gsl::narrow<std::uint32_t>(dfdLength));
+  writeLE(file, 56, gsl::narrow<std::uint32_t>(kvdOffset));
+  writeLE(file, 60, gsl::narrow<std::uint32_t>(kvdLength));
+
+  for (auto &&[level, data] : iter::enumerate(image.levels)) {
+    auto const entry{headerSize + level * levelIndexEntrySize};
+    writeLE(file, entry, std::uint64_t{levelOffsets.at(level)});
+    writeLE(file, entry + 8, std::uint64_t{data.size()});
+    writeLE(file, entry + 16, std::uint64_t{data.size()});
+    std::copy(data.begin(), data.end(),
+              file.begin() +
+                  gsl::narrow<std::ptrdiff_t>(levelOffsets.at(level)));
+  }
+
+  // Basic data format descriptor block
+  auto const colorModel{image.format == KTX2Format::BC1    ? 128U
+                        : image.format == KTX2Format::ETC2 ? 161U
+                                                           : 1U};
+  auto const transferFunction{image.sRGB ? 2U : 1U};
+  writeLE(file, dfdOffset, gsl::narrow<std::uint32_t>(dfdLength));
+  writeLE(file, dfdOffset + 8,
+          gsl::narrow<std::uint32_t>(2 | ((dfdLength - 4) << 16)));
+  writeLE(file, dfdOffset + 12,
+          colorModel | (1U << 8) | (transferFunction << 16));
+  writeLE(file, dfdOffset + 16, compressed ? 0x0303U : 0U);
+  writeLE(file, dfdOffset + 20, compressed ? 8U : 4U);
+  for (auto const sample : iter::range(numSamples)) {
+    auto const offset{dfdOffset + 28 + sample * 16};
+    if (compressed) {
+      writeLE(file, offset, 63U << 16);
+    } else {
+      // Channels R, G, B and A, the latter always linear
+      auto const channelType{sample < 3 ? sample
+                                        : (image.sRGB ? 0x1FU : 0x0FU)};
+      writeLE(file, offset,
+              gsl::narrow<std::uint32_t>(sample * 8 | (7U << 16) |
+                                         (channelType << 24)));
+    }
+    writeLE(file, offset + 12, compressed ? 0xFFFFFFFFU : 0xFFU);
+  }
+
+  // Key/value data
+  writeLE(file, kvdOffset, gsl::narrow<std::uint32_t>(keyValueLength));
+  auto const keyValue{fmt::format("{}{}{}{}", orientationKey, '\0',
+                                  orientation, '\0')};
+  std::copy(keyValue.begin(), keyValue.end(),
+            file.begin() + gsl::narrow<std::ptrdiff_t>(kvdOffset + 4));
+
+  std::ofstream stream(std::string{path}, std::ios::binary | std::ios::trunc);
+  stream.write(reinterpret_cast<char const *>(file.data()), // NOLINT
+               gsl::narrow<std::streamsize>(file.size()));
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+
+/**
+ * @brief Creates an image from RGBA pixels, with optional mipmap levels.
+ *
+ * Mipmap levels are generated with a box filter, in linear space if the
+ * pixels are in sRGB space. The BC1 and ETC2 encoders aim at offline use:
+ * they are simple and deterministic rather than fast or optimal. The alpha
+ * channel is discarded by both formats.
+ *
+ * @param pixels RGBA pixels with 8 bits per channel.
+ * @param size Width and height of the image.
+ * @param format Format of the output levels.
+ * @param sRGB Whether the pixels are encoded in sRGB space.
+ * @param generateMipmaps Whether to generate the full chain of mipmap levels.
+ *
+ * @throw abcg::RuntimeError if the number of pixels does not match the size.
+ *
+ * @return Image with the pixels in the requested format. The orientation is
+ * that of the input pixels, which is assumed to be top-down.
+ */
+abcg::KTX2Image abcg::compressKTX2(std::span<unsigned char const> pixels,
+                                   glm::ivec2 const &size, KTX2Format format,
+                                   bool sRGB, bool generateMipmaps) {
+  if (size.x <= 0 || size.y <= 0 ||
+      pixels.size() != getLevelSize(KTX2Format::RGBA8, size)) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid image size {}x{}", size.x, size.y));
+  }
+
+  KTX2Image image{.format = format,
+                  .sRGB = sRGB,
+                  .bottomUp = false,
+                  .size = size,
+                  .levels = {}};
+  auto const numLevels{
+      generateMipmaps
+          ? gsl::narrow<std::size_t>(std::bit_width(
+                gsl::narrow<unsigned>(std::max(size.x, size.y))))
+          : std::size_t{1}};
+
+  std::vector<unsigned char> level{pixels.begin(), pixels.end()};
+  for (auto const index : iter::range(numLevels)) {
+    auto const extent{getLevelExtent(size, index)};
+    if (index > 0) {
+      level = downsample(level, getLevelExtent(size, index - 1), sRGB);
+    }
+    image.levels.push_back(encodeLevel(format, level, extent));
+  }
+  return image;
+}
+
+/**
+ * @brief Decompresses an image to RGBA with 8 bits per channel.
+ *
+ * @param image Image in any of the formats of abcg::KTX2Format.
+ *
+ * @return Copy of the image in abcg::KTX2Format::RGBA8, with the same
+ * orientation and mipmap levels.
+ */
+abcg::KTX2Image abcg::decompressKTX2(KTX2Image const &image) {
+  if (!isCompressed(image.format)) {
+    return image;
+  }
+
+  KTX2Image result{.format = KTX2Format::RGBA8,
+                   .sRGB = image.sRGB,
+                   .bottomUp = image.bottomUp,
+                   .size = image.size,
+                   .levels = {}};
+  for (auto &&[level, data] : iter::enumerate(image.levels)) {
+    auto const extent{getLevelExtent(image.size, level)};
+    auto &pixels{result.levels.emplace_back(
+        getLevelSize(KTX2Format::RGBA8, extent))};
+    std::span const input{data};
+    auto const blocks{getBlockCount(extent)};
+    for (auto const blockY : iter::range(blocks.y)) {
+      for (auto const blockX : iter::range(blocks.x)) {
+        auto const block{input.subspan(
+            gsl::narrow<std::size_t>(blockY * blocks.x + blockX) * blockBytes,
+            blockBytes)};
+        auto const texels{image.format == KTX2Format::BC1 ? decodeBC1(block)
+                                                          : decodeETC2(block)};
+        storeBlock(texels, extent, {blockX, blockY}, pixels);
+      }
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Flips an image upside down, in place, and toggles
+ * abcg::KTX2Image::bottomUp.
+ *
+ * Compressed images are decompressed first.
+ *
+ * @param image Image to flip.
+ */
+void abcg::flipVertically(KTX2Image &image) {
+  if (isCompressed(image.format)) {
+    image = decompressKTX2(image);
+  }
+
+  for (auto &&[level, data] : iter::enumerate(image.levels)) {
+    auto const extent{getLevelExtent(image.size, level)};
+    auto const pitch{gsl::narrow<std::ptrdiff_t>(
+        gsl::narrow<std::size_t>(extent.x) * channels)};
+    for (auto const row : iter::range(extent.y / 2)) {
+      std::swap_ranges(data.begin() + pitch * row,
+                       data.begin() + pitch * (row + 1),
+                       data.begin() + pitch * (extent.y - row - 1));
+    }
+  }
+  image.bottomUp = !image.bottomUp;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file abcgKTX2.hpp
+ * @brief Declaration of KTX2 texture container helper functions.
+ *
+ * Declaration of abcg::KTX2Image and abcg::KTX2Format, and of the functions
+ * that read, write, compress and decompress them.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_KTX2_HPP_
+#define ABCG_KTX2_HPP_
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "abcgExternal.hpp"
+
+namespace abcg {
+enum class KTX2Format;
+struct KTX2Image;
+
+[[nodiscard]] KTX2Image readKTX2(std::string_view path);
+void writeKTX2(KTX2Image const &image, std::string_view path);
+
+[[nodiscard]] KTX2Image compressKTX2(std::span<unsigned char const> pixels,
+                                     glm::ivec2 const &size, KTX2Format format,
+                                     bool sRGB, bool generateMipmaps);
+[[nodiscard]] KTX2Image decompressKTX2(KTX2Image const &image);
+void flipVertically(KTX2Image &image);
+} // namespace abcg
+
+/**
+ * @brief Enumeration of pixel formats supported by abcg::KTX2Image.
+ */
+enum class abcg::KTX2Format {
+  /** @brief Uncompressed RGBA with 8 bits per channel. */
+  RGBA8,
+  /** @brief BC1 (S3TC DXT1) RGB blocks of 4x4 texels in 64 bits.
+   *
+   * Supported by virtually all desktop GPUs.
+   */
+  BC1,
+  /** @brief ETC2 RGB blocks of 4x4 texels in 64 bits.
+   *
+   * Mandatory in OpenGL ES 3.0 and OpenGL 4.3, and commonly available in
+   * WebGL 2.0 on mobile devices.
+   */
+  ETC2
+};
+
+/**
+ * @brief 2D image stored in a KTX2 container, with its mipmap levels.
+ *
+ * Only 2D textures without array layers, cube faces and supercompression are
+ * supported.
+ */
+struct abcg::KTX2Image {
+  /** @brief Pixel format of the levels. */
+  KTX2Format format{KTX2Format::RGBA8};
+  /** @brief Whether the pixels are encoded in sRGB space. */
+  bool sRGB{};
+  /** @brief Whether the first row of each level is the bottom row, as
+   * expected by OpenGL (`KTXorientation` is `ru`). */
+  bool bottomUp{};
+  /** @brief Width and height of level 0. */
+  glm::ivec2 size{};
+  /** @brief Data of each mipmap level, from level 0 down. */
+  std::vector<std::vector<unsigned char>> levels;
+};
+
+#endif
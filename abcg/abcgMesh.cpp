@@ -0,0 +1,182 @@
+/**
+ * @file abcgMesh.cpp
+ * @brief Definition of mesh processing helper functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMesh.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "abcgUtil.hpp"
+
+namespace {
+// Below this number of vertices per thread, threads are not worth creating
+constexpr std::size_t minVerticesPerThread{std::size_t{1} << 18U};
+
+unsigned int getNumThreads(std::size_t numVertices, unsigned int numThreads) {
+#if defined(__EMSCRIPTEN__)
+  (void)numVertices;
+  (void)numThreads;
+  return 1;
+#else
+  if (numThreads == 0) {
+    numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  auto const maxThreads{std::max(numVertices / minVerticesPerThread,
+                                 std::size_t{1})};
+  return static_cast<unsigned int>(
+      std::min(std::size_t{numThreads}, maxThreads));
+#endif
+}
+
+// Calls function(0), ..., function(numThreads - 1), each one on its own
+// thread. The calling thread runs function(0)
+template <typename T> void runOnThreads(unsigned int numThreads, T function) {
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (auto const thread : iter::range(1U, numThreads)) {
+    threads.emplace_back(function, thread);
+  }
+  function(0U);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// Vertices are split across threads by the upper bits of their hashes, so
+// that equal vertices always fall on the same thread
+std::size_t getPartition(std::uint64_t hash, std::size_t numPartitions) {
+  return gsl::narrow_cast<std::size_t>((hash >> 32U) % numPartitions);
+}
+
+// Finds the first occurrence of each vertex of a partition with an
+// open-addressing hash table. Each slot holds the upper 32 bits of the hash,
+// which rejects most mismatches without reading the vertex, and the position
+// of the vertex plus one (zero marks an empty slot)
+void weldPartition(std::span<std::byte const> vertices, std::size_t stride,
+                   std::span<std::uint64_t const> hashes,
+                   std::size_t partition, std::size_t numPartitions,
+                   std::span<std::uint32_t> firstOccurrences) {
+  std::size_t count{};
+  for (auto const hash : hashes) {
+    if (getPartition(hash, numPartitions) == partition) {
+      ++count;
+    }
+  }
+
+  // Load factor of at most 1/2 keeps probe sequences short
+  auto const tableSize{std::bit_ceil(std::max(count * 2, std::size_t{16}))};
+  auto const mask{tableSize - 1};
+  std::vector<std::uint64_t> table(tableSize);
+
+  for (auto const position : iter::range(hashes.size())) {
+    auto const hash{hashes[position]};
+    if (getPartition(hash, numPartitions) != partition) {
+      continue;
+    }
+
+    auto const tag{hash & 0xFFFFFFFF00000000};
+    auto const *const vertex{vertices.data() + position * stride};
+    for (auto slot{static_cast<std::size_t>(hash) & mask};;
+         slot = (slot + 1) & mask) {
+      auto &entry{table[slot]};
+      if (entry == 0) {
+        entry = tag | (position + 1);
+        firstOccurrences[position] = static_cast<std::uint32_t>(position);
+        break;
+      }
+      if ((entry & 0xFFFFFFFF00000000) == tag) {
+        auto const other{gsl::narrow_cast<std::size_t>(entry & 0xFFFFFFFF) - 1};
+        if (std::memcmp(vertex, vertices.data() + other * stride, stride) ==
+            0) {
+          firstOccurrences[position] = static_cast<std::uint32_t>(other);
+          break;
+        }
+      }
+    }
+  }
+}
+} // namespace
+
+/**
+ * @brief Merges equal vertices of a vertex stream into an indexed mesh.
+ *
+ * Vertices are hashed with abcg::hashBytes and inserted into a flat
+ * open-addressing table sized from the number of vertices, so no memory is
+ * allocated per vertex. Vertices are equal only if all their bytes are equal;
+ * for instance, coordinates 0.0f and -0.0f are not merged.
+ *
+ * Large inputs are split across threads by hash, and the result does not
+ * depend on the number of threads. In WebAssembly builds, a single thread is
+ * used.
+ *
+ * @param vertices Bytes of the vertices to weld.
+ * @param stride Size of each vertex, in bytes.
+ * @param numThreads Maximum number of threads, or 0 to choose from the number
+ * of hardware threads and the number of vertices.
+ *
+ * @throw abcg::RuntimeError if the stride is zero, if the size of the input is
+ * not a multiple of the stride, or if there are more than 2^32 - 1 vertices.
+ *
+ * @return Index of the unique vertex of each input vertex, and the first
+ * occurrence of each unique vertex.
+ */
+abcg::WeldResult abcg::weldVertices(std::span<std::byte const> vertices,
+                                    std::size_t stride,
+                                    unsigned int numThreads) {
+  if (stride == 0 || vertices.size() % stride != 0) {
+    throw abcg::RuntimeError("Invalid vertex stride");
+  }
+  auto const numVertices{vertices.size() / stride};
+  if (numVertices >= std::numeric_limits<std::uint32_t>::max()) {
+    throw abcg::RuntimeError("Too many vertices to weld");
+  }
+
+  numThreads = getNumThreads(numVertices, numThreads);
+
+  // Hashes are computed once, in contiguous ranges of vertices
+  std::vector<std::uint64_t> hashes(numVertices);
+  runOnThreads(numThreads, [&](unsigned int thread) {
+    auto const first{numVertices * thread / numThreads};
+    auto const last{numVertices * (thread + 1) / numThreads};
+    for (auto const position : iter::range(first, last)) {
+      hashes[position] = hashBytes(vertices.subspan(position * stride, stride));
+    }
+  });
+
+  std::vector<std::uint32_t> firstOccurrences(numVertices);
+  runOnThreads(numThreads, [&](unsigned int thread) {
+    weldPartition(vertices, stride, hashes, thread, numThreads,
+                  firstOccurrences);
+  });
+
+  // Numbers unique vertices in order of first occurrence, in place. A first
+  // occurrence always precedes the other occurrences, so its index is already
+  // known
+  WeldResult result;
+  result.indices = std::move(firstOccurrences);
+  for (auto const position : iter::range(numVertices)) {
+    auto const first{result.indices[position]};
+    if (first == position) {
+      result.indices[position] =
+          static_cast<std::uint32_t>(result.firstOccurrences.size());
+      result.firstOccurrences.push_back(first);
+    } else {
+      result.indices[position] = result.indices[first];
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file abcgMesh.hpp
+ * @brief Declaration of mesh processing helper functions.
+ *
+ * Declaration of abcg::WeldResult and abcg::weldVertices.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESH_HPP_
+#define ABCG_MESH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace abcg {
+struct WeldResult;
+
+[[nodiscard]] WeldResult weldVertices(std::span<std::byte const> vertices,
+                                      std::size_t stride,
+                                      unsigned int numThreads = 0);
+template <typename T>
+[[nodiscard]] WeldResult weldVertices(std::span<T> vertices,
+                                      unsigned int numThreads = 0);
+} // namespace abcg
+
+/**
+ * @brief Result of abcg::weldVertices.
+ *
+ * Unique vertices are numbered in the order of their first occurrence.
+ */
+struct abcg::WeldResult {
+  /** @brief Index of the unique vertex of each input vertex. */
+  std::vector<std::uint32_t> indices;
+  /** @brief Position in the input of the first occurrence of each unique
+   * vertex. */
+  std::vector<std::uint32_t> firstOccurrences;
+};
+
+/**
+ * @brief Merges equal vertices of a vertex stream into an indexed mesh.
+ *
+ * Typical usage is to create one vertex for each corner of the triangles of
+ * a model, and then weld them:
+ * @code
+ * auto const weld{abcg::weldVertices(std::span{corners})};
+ * std::vector<Vertex> vertices;
+ * for (auto const index : weld.firstOccurrences) {
+ *   vertices.push_back(corners[index]);
+ * }
+ * // weld.indices can be used as the index buffer
+ * @endcode
+ *
+ * @tparam T Vertex type. It must be trivially copyable and have no padding
+ * bytes, as vertices are compared and hashed byte by byte.
+ *
+ * @param vertices Vertices to weld.
+ * @param numThreads Maximum number of threads, or 0 to choose from the number
+ * of hardware threads and the number of vertices.
+ *
+ * @return Index of the unique vertex of each input vertex, and the first
+ * occurrence of each unique vertex.
+ */
+template <typename T>
+abcg::WeldResult abcg::weldVertices(std::span<T> vertices,
+                                    unsigned int numThreads) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Vertices are compared byte by byte");
+  return weldVertices(std::as_bytes(vertices), sizeof(T), numThreads);
+}
+
+#endif
@@ -14,8 +14,11 @@
 #define ABCG_OPENGL_HPP_
 
 #include "abcg.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLImage.hpp"
+#include "abcgOpenGLProfiler.hpp"
 #include "abcgOpenGLShader.hpp"
+#include "abcgOpenGLTextureLoader.hpp"
 #include "abcgOpenGLWindow.hpp"
 
 #endif
@@ -0,0 +1,325 @@
+/**
+ * @file abcgOpenGLFrameCapture.cpp
+ * @brief Definition of abcg::OpenGLFrameCapture members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLFrameCapture.hpp"
+
+#include <SDL_image.h>
+
+#include <algorithm>
+
+#include "abcgException.hpp"
+#include "abcgProfiler.hpp"
+#include "abcgUtil.hpp"
+
+namespace {
+constexpr auto channels{4};
+}
+
+/**
+ * @brief Stops the worker threads after they consume the queued frames.
+ */
+abcg::OpenGLFrameCapture::~OpenGLFrameCapture() { stopWorkers(); }
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * If the capture is not created, or in WebAssembly builds, the consumers are
+ * called on the thread that reads the pixels.
+ */
+void abcg::OpenGLFrameCapture::create() {
+#if !defined(__EMSCRIPTEN__)
+  stopWorkers();
+  m_stopping = false;
+  auto const numWorkers{
+      std::clamp(std::thread::hardware_concurrency() / 2, 1U, 4U)};
+  for ([[maybe_unused]] auto const _ : iter::range(numWorkers)) {
+    m_workers.emplace_back(&OpenGLFrameCapture::workerLoop, this);
+  }
+#endif
+}
+
+/**
+ * @brief Waits for all pending frames to be consumed, stops the worker
+ * threads and releases the pixel buffer objects.
+ *
+ * Must be called while the OpenGL context is current.
+ */
+void abcg::OpenGLFrameCapture::destroy() {
+  flush();
+  stopWorkers();
+  for (auto &slot : m_slots) {
+    if (slot.buffer != 0) {
+      glDeleteBuffers(1, &slot.buffer);
+    }
+    slot = {};
+  }
+  m_nextSlot = 0;
+  m_freePixels.clear();
+}
+
+/**
+ * @brief Issues an asynchronous read of the pixels of the current read
+ * framebuffer.
+ *
+ * The pixels are read from the lower left corner of the read buffer of the
+ * framebuffer bound to `GL_READ_FRAMEBUFFER`. The consumer is called later,
+ * from a worker thread, after abcg::OpenGLFrameCapture::poll or
+ * abcg::OpenGLFrameCapture::flush finds that the transfer has completed.
+ *
+ * @param size Width and height of the region to read.
+ * @param consumer Function that will receive the captured frame.
+ */
+void abcg::OpenGLFrameCapture::readPixels(glm::ivec2 const &size,
+                                          Consumer consumer) {
+  if (size.x <= 0 || size.y <= 0)
+    return;
+
+  ProfilerZone zone{"Frame capture"};
+  auto const index{m_nextIndex++};
+  auto const numBytes{
+      gsl::narrow<std::size_t>(size.x) * gsl::narrow<std::size_t>(size.y) *
+      channels};
+
+#if defined(__EMSCRIPTEN__)
+  // WebGL 2.0 cannot map buffers for reading
+  Job job{.frame = {.index = index,
+                    .size = size,
+                    .pixels = acquirePixels(numBytes)},
+          .consumer = std::move(consumer)};
+  auto &pixels{job.frame.pixels};
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  auto const pitch{gsl::narrow<std::ptrdiff_t>(size.x * channels)};
+  for (auto const line : iter::range(size.y / 2)) {
+    std::swap_ranges(pixels.begin() + pitch * line,
+                     pixels.begin() + pitch * (line + 1),
+                     pixels.begin() + pitch * (size.y - line - 1));
+  }
+  process(job);
+#else
+  // Slots are used in ring order, so this is the oldest one. If it is still
+  // in flight, the ring is full and we must wait for it
+  auto &slot{m_slots.at(m_nextSlot)};
+  m_nextSlot = (m_nextSlot + 1) % framesInFlight;
+  if (slot.fence != nullptr) {
+    resolve(slot);
+  }
+
+  if (slot.buffer == 0) {
+    glGenBuffers(1, &slot.buffer);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (auto const bufferSize{gsl::narrow<GLsizeiptr>(numBytes)};
+      slot.bufferSize != bufferSize) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+    slot.bufferSize = bufferSize;
+  }
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.index = index;
+  slot.size = size;
+  slot.consumer = std::move(consumer);
+#endif
+}
+
+/**
+ * @brief Hands over to the worker threads the frames whose transfer has
+ * completed, without waiting for the others.
+ *
+ * Call this once per frame.
+ */
+void abcg::OpenGLFrameCapture::poll() {
+#if !defined(__EMSCRIPTEN__)
+  // Fences are signaled in order, so stop at the first one that is not
+  for (auto const offset : iter::range(framesInFlight)) {
+    auto &slot{m_slots.at((m_nextSlot + offset) % framesInFlight)};
+    if (slot.fence == nullptr)
+      continue;
+    if (abcg::glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      break;
+    resolve(slot);
+  }
+#endif
+}
+
+/**
+ * @brief Waits for all pending transfers and hands the frames over to the
+ * worker threads.
+ *
+ * This does not wait for the consumers to finish.
+ */
+void abcg::OpenGLFrameCapture::flush() {
+#if !defined(__EMSCRIPTEN__)
+  for (auto const offset : iter::range(framesInFlight)) {
+    if (auto &slot{m_slots.at((m_nextSlot + offset) % framesInFlight)};
+        slot.fence != nullptr) {
+      resolve(slot);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Saves a captured frame to a PNG file.
+ *
+ * This can be called from a worker thread.
+ *
+ * @param frame Captured frame.
+ * @param filename Path to the output file.
+ *
+ * @throw abcg::RuntimeError if the frame has no pixels.
+ * @throw abcg::SDLError if the SDL surface could not be created.
+ * @throw abcg::SDLImageError if the file could not be written.
+ */
+void abcg::OpenGLFrameCapture::savePNG(Frame const &frame,
+                                       std::string const &filename) {
+  if (frame.pixels.empty()) {
+    throw abcg::RuntimeError(fmt::format("Failed to capture {}", filename));
+  }
+
+  auto const bitsPerPixel{8};
+  // SDL does not modify the pixels of a surface it is only asked to read
+  auto *const surface{SDL_CreateRGBSurfaceFrom(
+      const_cast<unsigned char *>(frame.pixels.data()), // NOLINT
+      frame.size.x, frame.size.y, channels * bitsPerPixel,
+      frame.size.x * channels, 0x000000FF, 0x0000FF00, 0x00FF0000,
+      0xFF000000)};
+  if (surface == nullptr) {
+    throw abcg::SDLError("SDL_CreateRGBSurfaceFrom failed");
+  }
+  auto const result{IMG_SavePNG(surface, filename.c_str())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::SDLImageError(fmt::format("Failed to save {}", filename));
+  }
+}
+
+void abcg::OpenGLFrameCapture::resolve(Slot &slot) {
+#if !defined(__EMSCRIPTEN__)
+  ProfilerZone zone{"Frame capture readback"};
+  GLenum status{GL_TIMEOUT_EXPIRED};
+  while (status == GL_TIMEOUT_EXPIRED) {
+    status = abcg::glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                    GLuint64{1'000'000'000});
+  }
+  abcg::glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  Job job{.frame = {.index = slot.index, .size = slot.size, .pixels = {}},
+          .consumer = std::move(slot.consumer)};
+  slot.consumer = nullptr;
+
+  // A failed readback is still handed over, with no pixels
+  if (status != GL_WAIT_FAILED) {
+    auto const pitch{gsl::narrow<std::size_t>(slot.size.x * channels)};
+    auto const height{gsl::narrow<std::size_t>(slot.size.y)};
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (auto const *const mapped{static_cast<unsigned char const *>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                             gsl::narrow<GLsizeiptr>(pitch * height),
+                             GL_MAP_READ_BIT))};
+        mapped != nullptr) {
+      // Flip upside down while copying out of the mapped buffer
+      job.frame.pixels = acquirePixels(pitch * height);
+      for (auto const line : iter::range(height)) {
+        std::copy_n(
+            std::next(mapped, gsl::narrow<std::ptrdiff_t>(line * pitch)),
+            pitch,
+            std::next(job.frame.pixels.begin(),
+                      gsl::narrow<std::ptrdiff_t>((height - line - 1) *
+                                                  pitch)));
+      }
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  submit(std::move(job));
+#else
+  static_cast<void>(slot);
+#endif
+}
+
+void abcg::OpenGLFrameCapture::submit(Job job) {
+  if (m_workers.empty()) {
+    process(job);
+    return;
+  }
+
+  {
+    // Limit the memory held by frames waiting for a worker thread
+    std::unique_lock lock{m_mutex};
+    m_jobTaken.wait(lock, [this] { return m_jobs.size() < maxQueuedFrames; });
+    m_jobs.push_back(std::move(job));
+  }
+  m_jobAdded.notify_one();
+}
+
+void abcg::OpenGLFrameCapture::process(Job &job) {
+  if (job.consumer) {
+    ProfilerZone zone{"Frame capture consumer"};
+    try {
+      job.consumer(job.frame);
+    } catch (std::exception const &exception) {
+      fmt::print(stderr, "{}\n", toRedString(exception.what()));
+    }
+  }
+
+  // Recycle the pixel storage
+  std::scoped_lock lock{m_mutex};
+  if (m_freePixels.size() < maxQueuedFrames + framesInFlight) {
+    m_freePixels.push_back(std::move(job.frame.pixels));
+  }
+}
+
+std::vector<unsigned char>
+abcg::OpenGLFrameCapture::acquirePixels(std::size_t size) {
+  std::vector<unsigned char> pixels;
+  {
+    std::scoped_lock lock{m_mutex};
+    if (!m_freePixels.empty()) {
+      pixels = std::move(m_freePixels.back());
+      m_freePixels.pop_back();
+    }
+  }
+  pixels.resize(size);
+  return pixels;
+}
+
+void abcg::OpenGLFrameCapture::workerLoop() {
+  Profiler::setThreadName("Frame capture");
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock{m_mutex};
+      m_jobAdded.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+      if (m_jobs.empty())
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    m_jobTaken.notify_one();
+    process(job);
+  }
+}
+
+void abcg::OpenGLFrameCapture::stopWorkers() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_jobAdded.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
@@ -0,0 +1,129 @@
+/**
+ * @file abcgOpenGLFrameCapture.hpp
+ * @brief Header file of abcg::OpenGLFrameCapture.
+ *
+ * Declaration of abcg::OpenGLFrameCapture.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_FRAME_CAPTURE_HPP_
+#define ABCG_OPENGL_FRAME_CAPTURE_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLFunction.hpp"
+
+namespace abcg {
+class OpenGLFrameCapture;
+} // namespace abcg
+
+/**
+ * @brief Asynchronous readback of the framebuffer.
+ *
+ * Each call to abcg::OpenGLFrameCapture::readPixels issues a `glReadPixels`
+ * into one of a ring of abcg::OpenGLFrameCapture::framesInFlight pixel buffer
+ * objects, followed by a fence. The call returns immediately. The pixels are
+ * copied out of the buffer object only after its fence is signaled, and are
+ * flipped vertically during that copy. The captured frame is then handed to
+ * a pool of worker threads that run the consumer given to
+ * abcg::OpenGLFrameCapture::readPixels (e.g., to encode a PNG file).
+ *
+ * The render thread waits only if all buffer objects of the ring are still in
+ * use, or if abcg::OpenGLFrameCapture::maxQueuedFrames frames are waiting for
+ * a worker thread. Consumers of different frames may run concurrently and
+ * complete out of order; use abcg::OpenGLFrameCapture::Frame::index to
+ * restore the order if needed.
+ *
+ * In WebAssembly builds, the pixels are read synchronously and the consumer is
+ * called on the calling thread.
+ *
+ * @remark Objects of this type cannot be copied or moved.
+ */
+class abcg::OpenGLFrameCapture {
+public:
+  /** @brief Number of pixel buffer objects in the ring. */
+  static constexpr std::size_t framesInFlight{3};
+  /** @brief Maximum number of frames waiting for a worker thread. */
+  static constexpr std::size_t maxQueuedFrames{16};
+
+  /** @brief Captured frame. */
+  struct Frame {
+    /** @brief Frame index, in the order of the calls to readPixels. */
+    std::uint64_t index{};
+    /** @brief Width and height of the frame, in pixels. */
+    glm::ivec2 size{};
+    /** @brief RGBA pixels with 8 bits per channel, from the top row down.
+     * Empty if the readback failed. */
+    std::vector<unsigned char> pixels;
+  };
+
+  /** @brief Function called from a worker thread for each captured frame. */
+  using Consumer = std::function<void(Frame const &)>;
+
+  OpenGLFrameCapture() = default;
+  ~OpenGLFrameCapture();
+
+  OpenGLFrameCapture(OpenGLFrameCapture const &) = delete;
+  OpenGLFrameCapture(OpenGLFrameCapture &&) = delete;
+  OpenGLFrameCapture &operator=(OpenGLFrameCapture const &) = delete;
+  OpenGLFrameCapture &operator=(OpenGLFrameCapture &&) = delete;
+
+  void create();
+  void destroy();
+
+  void readPixels(glm::ivec2 const &size, Consumer consumer);
+  void poll();
+  void flush();
+
+  static void savePNG(Frame const &frame, std::string const &filename);
+
+private:
+  struct Slot {
+    GLuint buffer{};
+    GLsizeiptr bufferSize{};
+    GLsync fence{};
+    std::uint64_t index{};
+    glm::ivec2 size{};
+    Consumer consumer;
+  };
+
+  struct Job {
+    Frame frame;
+    Consumer consumer;
+  };
+
+  void resolve(Slot &slot);
+  void submit(Job job);
+  void process(Job &job);
+  [[nodiscard]] std::vector<unsigned char> acquirePixels(std::size_t size);
+  void workerLoop();
+  void stopWorkers();
+
+  std::array<Slot, framesInFlight> m_slots{};
+  std::size_t m_nextSlot{};
+  std::uint64_t m_nextIndex{};
+
+  // Shared with the worker threads
+  std::mutex m_mutex;
+  std::condition_variable m_jobAdded;
+  std::condition_variable m_jobTaken;
+  std::deque<Job> m_jobs;
+  std::vector<std::vector<unsigned char>> m_freePixels;
+  bool m_stopping{};
+  std::vector<std::thread> m_workers;
+};
+
+#endif
@@ -1471,6 +1471,19 @@ inline void glTexImage2DMultisample(
          internalformat, width, height, fixedsamplelocations);
 }
 
+// OpenGL 3.3+ function definitions
+
+inline void glQueryCounter(
+    GLuint id, GLenum target,
+    source_location const &sourceLocation = source_location::current()) {
+  callGL(sourceLocation, ::glQueryCounter, id, target);
+}
+inline void glGetQueryObjectui64v(
+    GLuint id, GLenum pname, GLuint64 *params,
+    source_location const &sourceLocation = source_location::current()) {
+  callGL(sourceLocation, ::glGetQueryObjectui64v, id, pname, params);
+}
+
 // OpenGL 2.0+ function definitions
 
 inline void glGetDoublev(
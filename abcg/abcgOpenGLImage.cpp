@@ -11,90 +11,329 @@
 #include "abcgOpenGLImage.hpp"
 #include "abcgImage.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <vector>
+
 #include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
 #include "abcgException.hpp"
 
-/**
- * @brief Creates an OpenGL 2D texture from an image loaded from a filesystem
- * path.
- *
- * @param createInfo Texture creation settings.
- *
- * @throw abcg::RuntimeError if the image could not be loaded.
- *
- * @return ID of the texture, as generated by glGenTextures.
- */
-GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
-  GLuint textureID{};
+namespace {
+// Not defined by the OpenGL ES headers
+constexpr GLenum compressedRGBS3TCDXT1{0x83F0};
+constexpr GLenum compressedSRGBS3TCDXT1{0x8C4C};
+constexpr GLenum compressedRGB8ETC2{0x9274};
+constexpr GLenum compressedSRGB8ETC2{0x9275};
+constexpr GLenum textureMaxAnisotropy{0x84FE};
+constexpr GLenum maxTextureMaxAnisotropy{0x84FF};
 
-  if (SDL_Surface *const surface{IMG_Load(createInfo.path.data())}) {
-    // Enforce RGB/RGBA
-    GLenum internalFormat{};
-    GLenum format{};
-    SDL_Surface *formattedSurface{};
-    if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
-      internalFormat = createInfo.sRGBToLinear ? GL_SRGB8 : GL_RGB;
-      format = GL_RGB;
-    } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
-      internalFormat = createInfo.sRGBToLinear ? GL_SRGB8_ALPHA8 : GL_RGBA;
-      format = GL_RGBA;
-    }
-    SDL_FreeSurface(surface);
+struct SharedSampler {
+  abcg::OpenGLSamplerCreateInfo createInfo;
+  GLuint sampler{};
+};
 
-    // Flip upside down
-    if (createInfo.flipUpsideDown) {
-      flipVertically(*formattedSurface);
-    }
+// Samplers created by abcg::getOpenGLSampler. There are only a handful of
+// them, so they are searched linearly
+std::vector<SharedSampler> sharedSamplers; // NOLINT
+
+bool hasExtension(std::initializer_list<std::string_view> names) {
+  GLint numExtensions{};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (auto const index : iter::range(numExtensions)) {
+    std::string_view const extension{reinterpret_cast<char const *>(
+        glGetStringi(GL_EXTENSIONS, gsl::narrow<GLuint>(index)))};
+    if (std::find(names.begin(), names.end(), extension) != names.end())
+      return true;
+  }
+  return false;
+}
+
+#if !defined(__EMSCRIPTEN__)
+bool isVersionAtLeast(GLint major, GLint minor) {
+  GLint majorVersion{};
+  GLint minorVersion{};
+  glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+  glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+  return majorVersion > major ||
+         (majorVersion == major && minorVersion >= minor);
+}
+
+// Whether the current context is an OpenGL ES context
+bool isOpenGLES() {
+  auto const *version{reinterpret_cast<char const *>(glGetString(GL_VERSION))};
+  return version != nullptr &&
+         std::string_view{version}.starts_with("OpenGL ES");
+}
+#endif
+
+bool supportsTextureStorage() {
+#if defined(__EMSCRIPTEN__)
+  return true;
+#else
+  if (isOpenGLES()) {
+    return isVersionAtLeast(3, 0);
+  }
+  return isVersionAtLeast(4, 2) || hasExtension({"GL_ARB_texture_storage"});
+#endif
+}
+
+// Returns 1 if anisotropic filtering is not available
+float getMaxAnisotropy() {
+#if defined(__EMSCRIPTEN__)
+  auto const isCore{false};
+#else
+  auto const isCore{isVersionAtLeast(4, 6)};
+#endif
+  if (!isCore && !hasExtension({"GL_EXT_texture_filter_anisotropic",
+                                "GL_ARB_texture_filter_anisotropic"})) {
+    return 1.0f;
+  }
+  GLfloat maxAnisotropy{1.0f};
+  glGetFloatv(maxTextureMaxAnisotropy, &maxAnisotropy);
+  return maxAnisotropy;
+}
+
+GLsizei getNumLevels(glm::ivec2 const &size) {
+  return gsl::narrow<GLsizei>(
+      std::bit_width(gsl::narrow<unsigned>(std::max(size.x, size.y))));
+}
 
-    // Generate the texture
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, gsl::narrow<GLint>(internalFormat),
-                 formattedSurface->w, formattedSurface->h, 0, format,
-                 GL_UNSIGNED_BYTE, formattedSurface->pixels);
+// Allocates the levels of the texture bound to the target. Returns whether
+// the storage is immutable, in which case the levels must be specified with
+// glTexSubImage2D
+bool allocateStorage(GLenum target, GLenum internalFormat,
+                     glm::ivec2 const &size, GLsizei numLevels,
+                     bool immutable) {
+  if (immutable && supportsTextureStorage()) {
+    glTexStorage2D(target, numLevels, internalFormat, size.x, size.y);
+    return true;
+  }
+  // Makes mutable textures complete with any minifying filter
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+  return false;
+}
+
+void setTextureParameters(GLenum target,
+                          abcg::OpenGLSamplerCreateInfo const &createInfo) {
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER,
+                  gsl::narrow<GLint>(createInfo.minFilter));
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER,
+                  gsl::narrow<GLint>(createInfo.magFilter));
+  glTexParameteri(target, GL_TEXTURE_WRAP_S,
+                  gsl::narrow<GLint>(createInfo.wrapS));
+  glTexParameteri(target, GL_TEXTURE_WRAP_T,
+                  gsl::narrow<GLint>(createInfo.wrapT));
+  glTexParameteri(target, GL_TEXTURE_WRAP_R,
+                  gsl::narrow<GLint>(createInfo.wrapR));
+  if (createInfo.maxAnisotropy > 1.0f) {
+    glTexParameterf(target, textureMaxAnisotropy,
+                    std::min(createInfo.maxAnisotropy, getMaxAnisotropy()));
+  }
+}
+
+// Internal format of the levels of a KTX2 image
+GLenum getInternalFormat(abcg::KTX2Format format, bool sRGB) {
+  switch (format) {
+  case abcg::KTX2Format::RGBA8:
+    break;
+  case abcg::KTX2Format::BC1:
+    return sRGB ? compressedSRGBS3TCDXT1 : compressedRGBS3TCDXT1;
+  case abcg::KTX2Format::ETC2:
+    return sRGB ? compressedSRGB8ETC2 : compressedRGB8ETC2;
+  }
+  return gsl::narrow<GLenum>(sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+}
 
-    SDL_FreeSurface(formattedSurface);
+// Uploads a level of a texture allocated by allocateStorage
+void uploadLevel(GLenum target, GLint level, GLenum internalFormat,
+                 glm::ivec2 const &size, GLenum format, void const *pixels,
+                 bool immutable) {
+  if (immutable) {
+    glTexSubImage2D(target, level, 0, 0, size.x, size.y, format,
+                    GL_UNSIGNED_BYTE, pixels);
+  } else {
+    glTexImage2D(target, level, gsl::narrow<GLint>(internalFormat), size.x,
+                 size.y, 0, format, GL_UNSIGNED_BYTE, pixels);
+  }
+}
 
-    // Set texture filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// WebGL 2.0 cannot map buffers, so images are flipped in place there
+#if defined(__EMSCRIPTEN__)
+constexpr auto canFlipDuringUpload{false};
+#else
+constexpr auto canFlipDuringUpload{true};
+#endif
 
-    // Generate the mipmap levels
-    if (createInfo.generateMipmaps) {
-      glGenerateMipmap(GL_TEXTURE_2D);
+// Uploads level 0 of a texture allocated by allocateStorage. If
+// flipUpsideDown is true, the rows are written in reverse order to a pixel
+// buffer object, so the surface is not flipped beforehand
+void uploadSurface(GLenum target, GLenum internalFormat,
+                   SDL_Surface const &surface, bool flipUpsideDown,
+                   bool immutable) {
+  glm::ivec2 const size{surface.w, surface.h};
+  auto const format{gsl::narrow<GLenum>(
+      surface.format->BytesPerPixel == 4 ? GL_RGBA : GL_RGB)};
+  if (!flipUpsideDown) {
+    uploadLevel(target, 0, internalFormat, size, format, surface.pixels,
+                immutable);
+    return;
+  }
 
-      // Override minifying filtering
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                      GL_LINEAR_MIPMAP_LINEAR);
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
+  auto const height{gsl::narrow<std::size_t>(surface.h)};
+  auto const copyFlipped{[&](unsigned char *destination) {
+    auto const *const pixels{
+        static_cast<unsigned char const *>(surface.pixels)};
+    for (auto const row : iter::range(height)) {
+      std::memcpy(destination + (height - row - 1) * pitch,
+                  pixels + row * pitch, pitch);
     }
+  }};
+
+#if !defined(__EMSCRIPTEN__)
+  auto const bufferSize{gsl::narrow<GLsizeiptr>(pitch * height)};
+  GLuint buffer{};
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+  auto *const mapped{static_cast<unsigned char *>(
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize,
+                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))};
+  if (mapped != nullptr) {
+    copyFlipped(mapped);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    uploadLevel(target, 0, internalFormat, size, format, nullptr, immutable);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glDeleteBuffers(1, &buffer);
+  if (mapped != nullptr)
+    return;
+#endif
+
+  // The buffer could not be mapped
+  std::vector<unsigned char> flipped(pitch * height);
+  copyFlipped(flipped.data());
+  uploadLevel(target, 0, internalFormat, size, format, flipped.data(),
+              immutable);
+}
 
-    // Set texture wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+// Same as abcg::createOpenGLTexture, optionally flipping the image while it
+// is uploaded
+GLuint createTexture(SDL_Surface const &surface,
+                     abcg::OpenGLTextureCreateInfo const &createInfo,
+                     bool flipUpsideDown) {
+  auto const hasAlpha{surface.format->BytesPerPixel == 4};
+  GLenum internalFormat{};
+  if (createInfo.sRGBToLinear) {
+    internalFormat = hasAlpha ? GL_SRGB8_ALPHA8 : GL_SRGB8;
   } else {
-    throw abcg::RuntimeError(
-        fmt::format("Failed to load texture file {}", createInfo.path));
+    internalFormat = hasAlpha ? GL_RGBA8 : GL_RGB8;
+  }
+  glm::ivec2 const size{surface.w, surface.h};
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  auto const immutable{allocateStorage(
+      GL_TEXTURE_2D, internalFormat, size,
+      createInfo.generateMipmaps ? getNumLevels(size) : 1,
+      createInfo.immutableStorage)};
+  uploadSurface(GL_TEXTURE_2D, internalFormat, surface, flipUpsideDown,
+                immutable);
+
+  // Generate the mipmap levels
+  if (createInfo.generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
   }
 
+  setTextureParameters(GL_TEXTURE_2D, createInfo.sampler);
+
   glBindTexture(GL_TEXTURE_2D, 0);
 
   return textureID;
 }
 
+// Loads an image as RGB or RGBA
+SDL_Surface *loadSurface(std::string_view path, bool flipUpsideDown) {
+  SDL_Surface *surface{IMG_Load(path.data())};
+  if (surface == nullptr) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to load texture file {}", path));
+  }
+
+  // Enforce RGB/RGBA, without copying if the image already is
+  if (auto const pixelFormat{surface->format->format};
+      pixelFormat != SDL_PIXELFORMAT_RGB24 &&
+      pixelFormat != SDL_PIXELFORMAT_RGBA32) {
+    auto *const formattedSurface{
+        SDL_ConvertSurfaceFormat(surface,
+                                 surface->format->BytesPerPixel == 3
+                                     ? SDL_PIXELFORMAT_RGB24
+                                     : SDL_PIXELFORMAT_RGBA32,
+                                 0)};
+    SDL_FreeSurface(surface);
+    surface = formattedSurface;
+    if (surface == nullptr) {
+      throw abcg::RuntimeError(
+          fmt::format("Failed to convert texture file {}", path));
+    }
+  }
+
+  // Flip upside down
+  if (flipUpsideDown) {
+    abcg::flipVertically(*surface);
+  }
+
+  return surface;
+}
+} // namespace
+
+/**
+ * @brief Creates an OpenGL 2D texture from an image loaded from a filesystem
+ * path.
+ *
+ * Files with the `.ktx2` extension are loaded with abcg::readKTX2 and
+ * abcg::createOpenGLTexture.
+ *
+ * @param createInfo Texture creation settings.
+ *
+ * @throw abcg::RuntimeError if the image could not be loaded.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
+  if (createInfo.path.ends_with(".ktx2")) {
+    return createOpenGLTexture(readKTX2(createInfo.path), createInfo);
+  }
+
+  auto const flipDuringUpload{createInfo.flipUpsideDown &&
+                              createInfo.flipDuringUpload &&
+                              canFlipDuringUpload};
+  auto *const surface{loadSurface(
+      createInfo.path, createInfo.flipUpsideDown && !flipDuringUpload)};
+  auto const textureID{createTexture(*surface, createInfo, flipDuringUpload)};
+  SDL_FreeSurface(surface);
+
+  return textureID;
+}
+
 /**
  * @brief Creates an OpenGL cubemap texture from a set of images loaded from
  * filesystem paths.
  *
  * @param createInfo Texture creation settings.
  *
- * @throw abcg::RuntimeError if any image could not be loaded.
+ * @throw abcg::RuntimeError if any image could not be loaded, or if the images
+ * do not have the same size.
  *
  * @return ID of the texture, as generated by glGenTextures.
  */
@@ -103,6 +342,8 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
   glGenTextures(1, &textureID);
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
+  glm::ivec2 size{};
+  auto immutable{false};
   for (auto &&[index, path] : iter::enumerate(createInfo.paths)) {
     // Load the bitmap
     if (SDL_Surface *const surface{IMG_Load(path.data())}) {
@@ -112,13 +353,18 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
       SDL_FreeSurface(surface);
 
       auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+      auto flipDuringUpload{false};
 
       // LHS to RHS
       if (createInfo.rightHandedSystem) {
         if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
             target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y) {
           // Flip upside down
-          flipVertically(*formattedSurface);
+          flipDuringUpload =
+              createInfo.flipDuringUpload && canFlipDuringUpload;
+          if (!flipDuringUpload) {
+            flipVertically(*formattedSurface);
+          }
         } else {
           flipHorizontally(*formattedSurface);
         }
@@ -130,34 +376,533 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
           target = GL_TEXTURE_CUBE_MAP_POSITIVE_Z;
       }
 
+      // All faces share the storage allocated for the first one
+      glm::ivec2 const faceSize{formattedSurface->w, formattedSurface->h};
+      if (index == 0) {
+        size = faceSize;
+        immutable = allocateStorage(
+            GL_TEXTURE_CUBE_MAP, GL_RGB8, size,
+            createInfo.generateMipmaps ? getNumLevels(size) : 1,
+            createInfo.immutableStorage);
+      }
+      if (faceSize != size) {
+        SDL_FreeSurface(formattedSurface);
+        glDeleteTextures(1, &textureID);
+        throw abcg::RuntimeError(
+            fmt::format("Cubemap face {} has a different size", path));
+      }
+
       // Create texture
-      glTexImage2D(target, 0, GL_RGB, formattedSurface->w, formattedSurface->h,
-                   0, GL_RGB, GL_UNSIGNED_BYTE, formattedSurface->pixels);
+      uploadSurface(target, GL_RGB8, *formattedSurface, flipDuringUpload,
+                    immutable);
 
       SDL_FreeSurface(formattedSurface);
     } else {
+      glDeleteTextures(1, &textureID);
       throw abcg::RuntimeError(
           fmt::format("Failed to load texture file {}", path));
     }
   }
 
-  // Set texture wrapping
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  // Generate the mipmap levels
+  if (createInfo.generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+  }
+
+  setTextureParameters(GL_TEXTURE_CUBE_MAP, createInfo.sampler);
 
-  // Set texture filtering
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  return textureID;
+}
+
+/**
+ * @brief Creates an OpenGL 2D texture from an SDL surface.
+ *
+ * @param surface Surface with pixel format `SDL_PIXELFORMAT_RGB24` or
+ * `SDL_PIXELFORMAT_RGBA32`, already in the orientation of the texture.
+ * @param createInfo Texture creation settings. The path and
+ * abcg::OpenGLTextureCreateInfo::flipUpsideDown are ignored.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::createOpenGLTexture(SDL_Surface const &surface,
+                                 OpenGLTextureCreateInfo const &createInfo) {
+  return createTexture(surface, createInfo, false);
+}
+
+/**
+ * @brief Creates an OpenGL 2D texture from a KTX2 image.
+ *
+ * Block-compressed levels are uploaded as they are if the format is supported
+ * by the context. Otherwise, or if the orientation of the image does not match
+ * abcg::OpenGLTextureCreateInfo::flipUpsideDown, the image is decompressed to
+ * RGBA first.
+ *
+ * @param image Image with at least one level.
+ * @param createInfo Texture creation settings. The path is ignored. The
+ * texture is in sRGB space if either abcg::KTX2Image::sRGB or
+ * abcg::OpenGLTextureCreateInfo::sRGBToLinear is `true`.
+ *
+ * @throw abcg::RuntimeError if the image has no levels.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::createOpenGLTexture(KTX2Image const &image,
+                                 OpenGLTextureCreateInfo const &createInfo) {
+  if (image.levels.empty()) {
+    throw abcg::RuntimeError("Failed to create texture from empty image");
+  }
+
+  auto const sRGB{image.sRGB || createInfo.sRGBToLinear};
+  KTX2Image converted;
+  auto const *source{&image};
+  if (image.bottomUp != createInfo.flipUpsideDown) {
+    converted = image;
+    flipVertically(converted);
+    source = &converted;
+  } else if (image.format != KTX2Format::RGBA8 &&
+             !isOpenGLTextureFormatSupported(image.format, sRGB)) {
+    converted = decompressKTX2(image);
+    source = &converted;
+  }
+
+  auto const internalFormat{getInternalFormat(source->format, sRGB)};
+
+  // Uncompressed images without stored levels can still have them generated
+  auto const storedLevels{createInfo.generateMipmaps ? source->levels.size()
+                                                     : std::size_t{1}};
+  auto const generateMipmaps{createInfo.generateMipmaps && storedLevels == 1 &&
+                             source->format == KTX2Format::RGBA8};
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  auto const immutable{allocateStorage(
+      GL_TEXTURE_2D, internalFormat, source->size,
+      generateMipmaps ? getNumLevels(source->size)
+                      : gsl::narrow<GLsizei>(storedLevels),
+      createInfo.immutableStorage)};
+  for (auto const level : iter::range(storedLevels)) {
+    auto const &data{source->levels.at(level)};
+    glm::ivec2 const size{std::max(source->size.x >> level, 1),
+                          std::max(source->size.y >> level, 1)};
+    if (source->format == KTX2Format::RGBA8) {
+      uploadLevel(GL_TEXTURE_2D, gsl::narrow<GLint>(level), internalFormat,
+                  size, GL_RGBA, data.data(), immutable);
+    } else if (immutable) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, gsl::narrow<GLint>(level), 0, 0,
+                                size.x, size.y, internalFormat,
+                                gsl::narrow<GLsizei>(data.size()),
+                                data.data());
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, gsl::narrow<GLint>(level),
+                             internalFormat, size.x, size.y, 0,
+                             gsl::narrow<GLsizei>(data.size()), data.data());
+    }
+  }
+
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+
+  setTextureParameters(GL_TEXTURE_2D, createInfo.sampler);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return textureID;
+}
+
+/**
+ * @brief Creates an OpenGL 2D array texture from images loaded from
+ * filesystem paths.
+ *
+ * Each image becomes a layer of a `GL_TEXTURE_2D_ARRAY`, in the order of
+ * abcg::OpenGLTextureArrayCreateInfo::paths, so that objects with different
+ * materials can be drawn without binding other textures. Images are converted
+ * to the pixel format of the first one and resized to
+ * abcg::OpenGLTextureArrayCreateInfo::size.
+ *
+ * If all paths have the `.ktx2` extension, the files are read with
+ * abcg::readKTX2 and the layers are created with the KTX2 overload of
+ * abcg::createOpenGLTextureArray. KTX2 images are not resized.
+ *
+ * @param createInfo Texture creation settings.
+ *
+ * @throw abcg::RuntimeError if there are no paths, if any image could not be
+ * loaded, if only some of the paths are KTX2 files, or if the size of a KTX2
+ * image differs from abcg::OpenGLTextureArrayCreateInfo::size.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint
+abcg::loadOpenGLTextureArray(OpenGLTextureArrayCreateInfo const &createInfo) {
+  if (createInfo.paths.empty()) {
+    throw abcg::RuntimeError("Failed to create texture array without layers");
+  }
+
+  auto const isKTX2{[](auto const &path) { return path.ends_with(".ktx2"); }};
+  if (std::ranges::all_of(createInfo.paths, isKTX2)) {
+    std::vector<KTX2Image> images;
+    images.reserve(createInfo.paths.size());
+    for (auto const &path : createInfo.paths) {
+      auto const &image{images.emplace_back(readKTX2(path))};
+      if (createInfo.size != glm::ivec2{} && image.size != createInfo.size) {
+        throw abcg::RuntimeError(
+            fmt::format("KTX2 texture file {} has a different size", path));
+      }
+    }
+    return createOpenGLTextureArray(images, createInfo);
+  }
+  if (std::ranges::any_of(createInfo.paths, isKTX2)) {
+    throw abcg::RuntimeError(
+        "Texture array layers must be either all KTX2 or all PNG/JPEG files");
+  }
+
+  std::vector<SDL_Surface *> layers;
+  auto const freeLayers{gsl::finally([&layers] {
+    for (auto *const layer : layers) {
+      SDL_FreeSurface(layer);
+    }
+  })};
+
+  for (auto const &path : createInfo.paths) {
+    auto *&layer{
+        layers.emplace_back(loadSurface(path, createInfo.flipUpsideDown))};
+    auto const &first{*layers.front()};
+    auto const size{createInfo.size == glm::ivec2{}
+                        ? glm::ivec2{first.w, first.h}
+                        : createInfo.size};
+
+    if (auto const pixelFormat{first.format->format};
+        layer->format->format != pixelFormat) {
+      auto *const formattedLayer{
+          SDL_ConvertSurfaceFormat(layer, pixelFormat, 0)};
+      SDL_FreeSurface(layer);
+      layer = formattedLayer;
+      if (layer == nullptr) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to convert texture file {}", path));
+      }
+    }
+
+    if (layer->w != size.x || layer->h != size.y) {
+      auto *const resizedLayer{resize(*layer, size.x, size.y)};
+      SDL_FreeSurface(layer);
+      layer = resizedLayer;
+      if (layer == nullptr) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to resize texture file {}", path));
+      }
+    }
+  }
+
+  return createOpenGLTextureArray(layers, createInfo);
+}
+
+/**
+ * @brief Creates an OpenGL 2D array texture from SDL surfaces.
+ *
+ * @param layers Surfaces of the layers, in order. They must have the same size
+ * and the same pixel format, either `SDL_PIXELFORMAT_RGB24` or
+ * `SDL_PIXELFORMAT_RGBA32`, and be already in the orientation of the texture.
+ * @param createInfo Texture creation settings. The paths, the size and
+ * abcg::OpenGLTextureArrayCreateInfo::flipUpsideDown are ignored.
+ *
+ * @throw abcg::RuntimeError if there are no layers or if their sizes or pixel
+ * formats differ.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::createOpenGLTextureArray(
+    std::span<SDL_Surface *const> layers,
+    OpenGLTextureArrayCreateInfo const &createInfo) {
+  if (layers.empty()) {
+    throw abcg::RuntimeError("Failed to create texture array without layers");
+  }
+  auto const &first{*layers.front()};
+  if (std::any_of(layers.begin(), layers.end(), [&first](auto const *layer) {
+        return layer->w != first.w || layer->h != first.h ||
+               layer->format->format != first.format->format;
+      })) {
+    throw abcg::RuntimeError(
+        "Texture array layers must have the same size and pixel format");
+  }
+
+  auto const hasAlpha{first.format->BytesPerPixel == 4};
+  GLenum internalFormat{};
+  if (createInfo.sRGBToLinear) {
+    internalFormat = hasAlpha ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+  } else {
+    internalFormat = hasAlpha ? GL_RGBA8 : GL_RGB8;
+  }
+  auto const format{gsl::narrow<GLenum>(hasAlpha ? GL_RGBA : GL_RGB)};
+  glm::ivec2 const size{first.w, first.h};
+  auto const numLayers{gsl::narrow<GLsizei>(layers.size())};
+  auto const numLevels{createInfo.generateMipmaps ? getNumLevels(size) : 1};
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+  if (createInfo.immutableStorage && supportsTextureStorage()) {
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, internalFormat, size.x,
+                   size.y, numLayers);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, gsl::narrow<GLint>(internalFormat),
+                 size.x, size.y, numLayers, 0, format, GL_UNSIGNED_BYTE,
+                 nullptr);
+  }
+  for (auto &&[index, layer] : iter::enumerate(layers)) {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, gsl::narrow<GLint>(index),
+                    size.x, size.y, 1, format, GL_UNSIGNED_BYTE,
+                    layer->pixels);
+  }
 
   // Generate the mipmap levels
   if (createInfo.generateMipmaps) {
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  }
+
+  setTextureParameters(GL_TEXTURE_2D_ARRAY, createInfo.sampler);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-    // Override minifying filtering
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
+  return textureID;
+}
+
+/**
+ * @brief Creates an OpenGL 2D array texture from KTX2 images.
+ *
+ * Block-compressed levels are uploaded as they are if all layers have the same
+ * format and it is supported by the context. Otherwise, or if the orientation
+ * of any layer does not match
+ * abcg::OpenGLTextureArrayCreateInfo::flipUpsideDown, all layers are
+ * decompressed to RGBA first.
+ *
+ * @param layers Images of the layers, in order. They must have the same size
+ * and color space, and at least one level. Only the levels stored in all
+ * layers are used.
+ * @param createInfo Texture creation settings. The paths and the size are
+ * ignored. The texture is in sRGB space if either abcg::KTX2Image::sRGB or
+ * abcg::OpenGLTextureArrayCreateInfo::sRGBToLinear is `true`.
+ *
+ * @throw abcg::RuntimeError if there are no layers, if any layer has no
+ * levels, or if their sizes or color spaces differ.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::createOpenGLTextureArray(
+    std::span<KTX2Image const> layers,
+    OpenGLTextureArrayCreateInfo const &createInfo) {
+  if (layers.empty()) {
+    throw abcg::RuntimeError("Failed to create texture array without layers");
+  }
+  auto const &first{layers.front()};
+  if (std::ranges::any_of(layers, [&first](auto const &layer) {
+        return layer.levels.empty() || layer.size != first.size ||
+               layer.sRGB != first.sRGB;
+      })) {
+    throw abcg::RuntimeError("Texture array layers must have the same size and "
+                             "color space, and at least one level");
+  }
+
+  auto const sRGB{first.sRGB || createInfo.sRGBToLinear};
+  std::vector<KTX2Image> converted;
+  auto sources{layers};
+  if (std::ranges::any_of(layers, [&](auto const &layer) {
+        return layer.format != first.format ||
+               layer.bottomUp != createInfo.flipUpsideDown ||
+               (layer.format != KTX2Format::RGBA8 &&
+                !isOpenGLTextureFormatSupported(layer.format, sRGB));
+      })) {
+    converted.reserve(layers.size());
+    for (auto const &layer : layers) {
+      auto &image{converted.emplace_back(decompressKTX2(layer))};
+      if (image.bottomUp != createInfo.flipUpsideDown) {
+        flipVertically(image);
+      }
+    }
+    sources = converted;
+  }
+
+  auto const format{sources.front().format};
+  auto const internalFormat{getInternalFormat(format, sRGB)};
+  auto const size{sources.front().size};
+  auto const numLayers{gsl::narrow<GLsizei>(sources.size())};
+
+  // Uncompressed images without stored levels can still have them generated
+  auto storedLevels{std::size_t{1}};
+  if (createInfo.generateMipmaps) {
+    storedLevels = std::ranges::min(
+        sources | std::views::transform(
+                      [](auto const &layer) { return layer.levels.size(); }));
+  }
+  auto const generateMipmaps{createInfo.generateMipmaps && storedLevels == 1 &&
+                             format == KTX2Format::RGBA8};
+  auto const numLevels{generateMipmaps ? getNumLevels(size)
+                                       : gsl::narrow<GLsizei>(storedLevels)};
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+  auto const immutable{createInfo.immutableStorage &&
+                       supportsTextureStorage()};
+  if (immutable) {
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, internalFormat, size.x,
+                   size.y, numLayers);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+  }
+
+  // Mutable levels are specified at once, with the data of all layers
+  std::vector<unsigned char> levelData;
+  for (auto const level : iter::range(storedLevels)) {
+    auto const glLevel{gsl::narrow<GLint>(level)};
+    glm::ivec2 const extent{std::max(size.x >> level, 1),
+                            std::max(size.y >> level, 1)};
+    if (immutable) {
+      for (auto &&[index, layer] : iter::enumerate(sources)) {
+        auto const &data{layer.levels.at(level)};
+        auto const zOffset{gsl::narrow<GLint>(index)};
+        if (format == KTX2Format::RGBA8) {
+          glTexSubImage3D(GL_TEXTURE_2D_ARRAY, glLevel, 0, 0, zOffset,
+                          extent.x, extent.y, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                          data.data());
+        } else {
+          glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, glLevel, 0, 0,
+                                    zOffset, extent.x, extent.y, 1,
+                                    internalFormat,
+                                    gsl::narrow<GLsizei>(data.size()),
+                                    data.data());
+        }
+      }
+      continue;
+    }
+
+    levelData.clear();
+    for (auto const &layer : sources) {
+      auto const &data{layer.levels.at(level)};
+      levelData.insert(levelData.end(), data.begin(), data.end());
+    }
+    if (format == KTX2Format::RGBA8) {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, glLevel,
+                   gsl::narrow<GLint>(internalFormat), extent.x, extent.y,
+                   numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, levelData.data());
+    } else {
+      glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, glLevel, internalFormat,
+                             extent.x, extent.y, numLayers, 0,
+                             gsl::narrow<GLsizei>(levelData.size()),
+                             levelData.data());
+    }
   }
 
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  }
+
+  setTextureParameters(GL_TEXTURE_2D_ARRAY, createInfo.sampler);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
   return textureID;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Returns whether textures of a KTX2 format can be uploaded without
+ * decompression in the current OpenGL context.
+ *
+ * BC1 requires S3TC support, and ETC2 requires OpenGL 4.3, OpenGL ES 3.0 or
+ * the `WEBGL_compressed_texture_etc` extension. Note that desktop drivers
+ * commonly decompress ETC2 textures themselves, so BC1 is the better choice on
+ * desktop.
+ *
+ * @param format Format of the texture.
+ * @param sRGB Whether the texture is in sRGB space.
+ */
+bool abcg::isOpenGLTextureFormatSupported(KTX2Format format, bool sRGB) {
+  switch (format) {
+  case KTX2Format::RGBA8:
+    return true;
+  case KTX2Format::BC1:
+    return hasExtension({"GL_EXT_texture_compression_s3tc",
+                         "GL_WEBGL_compressed_texture_s3tc"}) &&
+           (!sRGB || hasExtension({"GL_EXT_texture_sRGB",
+                                   "GL_EXT_texture_compression_s3tc_srgb",
+                                   "GL_WEBGL_compressed_texture_s3tc_srgb"}));
+  case KTX2Format::ETC2: {
+#if defined(__EMSCRIPTEN__)
+    return hasExtension({"GL_WEBGL_compressed_texture_etc"});
+#else
+    if (isOpenGLES()) {
+      return isVersionAtLeast(3, 0);
+    }
+    return isVersionAtLeast(4, 3) || hasExtension({"GL_ARB_ES3_compatibility"});
+#endif
+  }
+  }
+  return false;
+}
+
+/**
+ * @brief Returns a sampler object with the given parameters.
+ *
+ * Samplers are shared: the first call with a given set of parameters creates
+ * the sampler, and subsequent calls return the same object. Binding a shared
+ * sampler with `glBindSampler` overrides the sampling parameters of the
+ * textures bound to the same unit, so that many textures can be drawn with a
+ * single sampler state.
+ *
+ * Must be called while the OpenGL context is current. The samplers are
+ * deleted by abcg::destroyOpenGLSamplers, which abcg::OpenGLWindow calls
+ * after abcg::OpenGLWindow::onDestroy.
+ *
+ * @param createInfo Sampling parameters.
+ *
+ * @return ID of the sampler, as generated by glGenSamplers.
+ */
+GLuint abcg::getOpenGLSampler(OpenGLSamplerCreateInfo const &createInfo) {
+  if (auto const iter{std::find_if(sharedSamplers.begin(),
+                                   sharedSamplers.end(),
+                                   [&createInfo](auto const &shared) {
+                                     return shared.createInfo == createInfo;
+                                   })};
+      iter != sharedSamplers.end()) {
+    return iter->sampler;
+  }
+
+  GLuint sampler{};
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER,
+                      gsl::narrow<GLint>(createInfo.minFilter));
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER,
+                      gsl::narrow<GLint>(createInfo.magFilter));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S,
+                      gsl::narrow<GLint>(createInfo.wrapS));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T,
+                      gsl::narrow<GLint>(createInfo.wrapT));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R,
+                      gsl::narrow<GLint>(createInfo.wrapR));
+  if (createInfo.maxAnisotropy > 1.0f) {
+    glSamplerParameterf(sampler, textureMaxAnisotropy,
+                        std::min(createInfo.maxAnisotropy, getMaxAnisotropy()));
+  }
+
+  sharedSamplers.push_back({.createInfo = createInfo, .sampler = sampler});
+  return sampler;
+}
+
+/**
+ * @brief Deletes the sampler objects created by abcg::getOpenGLSampler.
+ *
+ * Must be called while the OpenGL context is current.
+ */
+void abcg::destroyOpenGLSamplers() {
+  for (auto const &shared : sharedSamplers) {
+    glDeleteSamplers(1, &shared.sampler);
+  }
+  sharedSamplers.clear();
+}
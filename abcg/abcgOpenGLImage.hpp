@@ -11,34 +11,114 @@
 #ifndef ABCG_OPENGL_IMAGE_HPP_
 #define ABCG_OPENGL_IMAGE_HPP_
 
+#include "abcgKTX2.hpp"
 #include "abcgOpenGLExternal.hpp"
 
 #include <array>
+#include <span>
 #include <string_view>
+#include <vector>
 
 namespace abcg {
+struct OpenGLSamplerCreateInfo;
 struct OpenGLTextureCreateInfo;
 struct OpenGLCubemapCreateInfo;
+struct OpenGLTextureArrayCreateInfo;
 
 [[nodiscard]] GLuint
 loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo);
 [[nodiscard]] GLuint
 loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo);
+[[nodiscard]] GLuint
+createOpenGLTexture(SDL_Surface const &surface,
+                    OpenGLTextureCreateInfo const &createInfo);
+[[nodiscard]] GLuint
+createOpenGLTexture(KTX2Image const &image,
+                    OpenGLTextureCreateInfo const &createInfo);
+[[nodiscard]] GLuint
+loadOpenGLTextureArray(OpenGLTextureArrayCreateInfo const &createInfo);
+[[nodiscard]] GLuint
+createOpenGLTextureArray(std::span<SDL_Surface *const> layers,
+                         OpenGLTextureArrayCreateInfo const &createInfo);
+[[nodiscard]] GLuint
+createOpenGLTextureArray(std::span<KTX2Image const> layers,
+                         OpenGLTextureArrayCreateInfo const &createInfo);
+[[nodiscard]] bool isOpenGLTextureFormatSupported(KTX2Format format,
+                                                  bool sRGB);
+
+[[nodiscard]] GLuint
+getOpenGLSampler(OpenGLSamplerCreateInfo const &createInfo);
+void destroyOpenGLSamplers();
 } // namespace abcg
 
+/**
+ * @brief Configuration settings of texture sampling.
+ *
+ * Used both for the parameters of a texture and for shared sampler objects
+ * returned by abcg::getOpenGLSampler.
+ */
+struct abcg::OpenGLSamplerCreateInfo {
+  /** @brief Minifying filter.
+   *
+   * Mipmap filters are valid for textures without mipmap levels, as their
+   * maximum level is set to 0.
+   */
+  GLenum minFilter{GL_LINEAR_MIPMAP_LINEAR};
+  /** @brief Magnification filter. */
+  GLenum magFilter{GL_LINEAR};
+  /** @brief Wrap mode of the s coordinate. */
+  GLenum wrapS{GL_REPEAT};
+  /** @brief Wrap mode of the t coordinate. */
+  GLenum wrapT{GL_REPEAT};
+  /** @brief Wrap mode of the r coordinate. */
+  GLenum wrapR{GL_REPEAT};
+  /** @brief Maximum degree of anisotropic filtering.
+   *
+   * Values greater than 1 are clamped to the maximum supported by the
+   * context, and ignored if anisotropic filtering is not available.
+   */
+  float maxAnisotropy{1.0f};
+
+  bool operator==(OpenGLSamplerCreateInfo const &) const = default;
+};
+
 /**
  * @brief Configuration settings for creating a 2D texture for OpenGL.
  */
 struct abcg::OpenGLTextureCreateInfo {
-  /** @brief Path to the image file (PNG or JPEG). */
+  /** @brief Path to the image file (PNG, JPEG or KTX2). */
   std::string_view path{};
-  /** @brief Whether to generate mipmap levels. */
+  /** @brief Whether to generate mipmap levels.
+   *
+   * For KTX2 files, whether to use the mipmap levels stored in the file.
+   */
   bool generateMipmaps{true};
-  /** @brief Whether to flip the image upside down. */
+  /** @brief Whether to flip the image upside down.
+   *
+   * For KTX2 files, whether the texture must be bottom-up. Files whose
+   * orientation does not match are decompressed and flipped at load time.
+   */
   bool flipUpsideDown{true};
+  /** @brief Whether to flip the image while it is copied to a pixel buffer
+   * object for the upload, instead of flipping it in place beforehand.
+   *
+   * Ignored for KTX2 files, and in WebAssembly builds, where buffers cannot be
+   * mapped.
+   */
+  bool flipDuringUpload{true};
   /** @brief Whether to apply gamma decoding (expansion) to convert an image in
    * sRGB space to linear space. */
   bool sRGBToLinear{false};
+  /** @brief Whether to allocate the texture with immutable storage
+   * (`glTexStorage2D`), if supported by the context.
+   *
+   * The size, format and number of levels of an immutable texture cannot
+   * change, so the driver does not need to check its completeness at each
+   * draw call.
+   */
+  bool immutableStorage{true};
+  /** @brief Sampling parameters of the texture. */
+  OpenGLSamplerCreateInfo sampler{};
 };
 
 /**
@@ -53,6 +133,58 @@ struct abcg::OpenGLCubemapCreateInfo {
   /** @brief Whether to convert the cubemap from a left-handed system to a
    * right-handed system. */
   bool rightHandedSystem{true};
+  /** @brief Whether to flip the +y and -y faces while they are copied to a
+   * pixel buffer object for the upload, when converting to a right-handed
+   * system. The other faces are flipped horizontally in place.
+   *
+   * Ignored in WebAssembly builds, where buffers cannot be mapped.
+   */
+  bool flipDuringUpload{true};
+  /** @brief Whether to allocate the texture with immutable storage
+   * (`glTexStorage2D`), if supported by the context. */
+  bool immutableStorage{true};
+  /** @brief Sampling parameters of the texture. */
+  OpenGLSamplerCreateInfo sampler{.wrapS = GL_CLAMP_TO_EDGE,
+                                  .wrapT = GL_CLAMP_TO_EDGE,
+                                  .wrapR = GL_CLAMP_TO_EDGE};
+};
+
+/**
+ * @brief Configuration settings for creating a 2D array texture for OpenGL.
+ *
+ * In GLSL, the texture is sampled with a `sampler2DArray` and a third texture
+ * coordinate with the index of the layer.
+ */
+struct abcg::OpenGLTextureArrayCreateInfo {
+  /** @brief Paths to the image files (PNG, JPEG or KTX2) of the layers, in
+   * order. KTX2 files cannot be mixed with other formats. */
+  std::vector<std::string_view> paths{};
+  /** @brief Width and height of the layers.
+   *
+   * Images of other sizes are resized. If zero, the size of the first image
+   * is used. KTX2 images are not resized, so they must already have this
+   * size.
+   */
+  glm::ivec2 size{};
+  /** @brief Whether to generate mipmap levels.
+   *
+   * For KTX2 files, whether to use the mipmap levels stored in the files.
+   */
+  bool generateMipmaps{true};
+  /** @brief Whether to flip the images upside down.
+   *
+   * For KTX2 files, whether the texture must be bottom-up. Files whose
+   * orientation does not match are decompressed and flipped at load time.
+   */
+  bool flipUpsideDown{true};
+  /** @brief Whether to apply gamma decoding (expansion) to convert images in
+   * sRGB space to linear space. */
+  bool sRGBToLinear{false};
+  /** @brief Whether to allocate the texture with immutable storage
+   * (`glTexStorage3D`), if supported by the context. */
+  bool immutableStorage{true};
+  /** @brief Sampling parameters of the texture. */
+  OpenGLSamplerCreateInfo sampler{};
 };
 
 #endif
@@ -0,0 +1,198 @@
+/**
+ * @file abcgOpenGLProfiler.cpp
+ * @brief Definition of abcg::OpenGLProfiler members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProfiler.hpp"
+
+#include <algorithm>
+
+#include "abcgExternal.hpp"
+
+/**
+ * @brief Creates the profiler.
+ *
+ * Must be called after the OpenGL context is created. If timer queries are not
+ * supported by the context, the profiler remains disabled.
+ */
+void abcg::OpenGLProfiler::create() {
+#if defined(__EMSCRIPTEN__)
+  m_supported = false;
+#else
+  m_supported = GLEW_ARB_timer_query != 0;
+#endif
+  m_currentFrame = 0;
+  m_openScopes.clear();
+  m_timings.clear();
+}
+
+/**
+ * @brief Releases the query objects.
+ */
+void abcg::OpenGLProfiler::destroy() {
+  for (auto &frame : m_frames) {
+    if (!frame.queries.empty()) {
+      glDeleteQueries(gsl::narrow<GLsizei>(frame.queries.size()),
+                      frame.queries.data());
+    }
+    frame = {};
+  }
+  m_openScopes.clear();
+  m_supported = false;
+}
+
+/**
+ * @brief Starts a new frame.
+ *
+ * Closes any scope left open in the previous frame, reads back the results of
+ * the oldest frame in the ring if they are available, and recycles its query
+ * objects for the new frame.
+ */
+void abcg::OpenGLProfiler::beginFrame() {
+  if (!m_supported)
+    return;
+
+  while (!m_openScopes.empty()) {
+    endScope();
+  }
+
+  m_currentFrame = (m_currentFrame + 1) % framesInFlight;
+  auto &frame{m_frames.at(m_currentFrame)};
+  if (!frame.scopes.empty()) {
+    resolve(frame);
+  }
+  frame.scopes.clear();
+  frame.usedQueries = 0;
+}
+
+/**
+ * @brief Begins a named GPU scope.
+ *
+ * @param name Name of the scope, as shown in the profiler overlay.
+ */
+void abcg::OpenGLProfiler::beginScope(std::string_view name) {
+  if (!m_supported)
+    return;
+
+#if !defined(__EMSCRIPTEN__)
+  auto &frame{m_frames.at(m_currentFrame)};
+  auto const query{acquireQuery(frame)};
+  glQueryCounter(query, GL_TIMESTAMP);
+  m_openScopes.push_back(frame.scopes.size());
+  frame.scopes.push_back({.name = std::string{name},
+                          .depth = gsl::narrow<int>(m_openScopes.size() - 1),
+                          .beginQuery = query});
+#endif
+}
+
+/**
+ * @brief Ends the innermost open GPU scope.
+ */
+void abcg::OpenGLProfiler::endScope() {
+  if (!m_supported || m_openScopes.empty())
+    return;
+
+#if !defined(__EMSCRIPTEN__)
+  auto &frame{m_frames.at(m_currentFrame)};
+  auto const query{acquireQuery(frame)};
+  glQueryCounter(query, GL_TIMESTAMP);
+  frame.scopes.at(m_openScopes.back()).endQuery = query;
+  m_openScopes.pop_back();
+#endif
+}
+
+/**
+ * @brief Returns whether the profiler was created and timer queries are
+ * supported.
+ */
+bool abcg::OpenGLProfiler::isSupported() const noexcept { return m_supported; }
+
+/**
+ * @brief Returns the timings of the most recently resolved frame.
+ *
+ * @returns Reference to the list of scope timings, in the order the scopes
+ * were begun.
+ */
+std::vector<abcg::OpenGLProfiler::Timing> const &
+abcg::OpenGLProfiler::getTimings() const noexcept {
+  return m_timings;
+}
+
+GLuint abcg::OpenGLProfiler::acquireQuery(Frame &frame) {
+  if (frame.usedQueries == frame.queries.size()) {
+    // Grow the pool; query objects are reused in later frames
+    auto const newSize{std::max<std::size_t>(frame.queries.size() * 2, 8)};
+    auto const oldSize{frame.queries.size()};
+    frame.queries.resize(newSize);
+    glGenQueries(gsl::narrow<GLsizei>(newSize - oldSize),
+                 frame.queries.data() + oldSize);
+  }
+  return frame.queries.at(frame.usedQueries++);
+}
+
+void abcg::OpenGLProfiler::resolve(Frame const &frame) {
+#if !defined(__EMSCRIPTEN__)
+  // The last query issued is the last to complete. If it is not ready yet,
+  // drop this frame instead of waiting for it
+  auto const lastQuery{frame.queries.at(frame.usedQueries - 1)};
+  GLuint available{};
+  glGetQueryObjectuiv(lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE)
+    return;
+
+  // Blend with the previous results if the scope layout did not change
+  auto const sameLayout{
+      m_timings.size() == frame.scopes.size() &&
+      std::equal(m_timings.begin(), m_timings.end(), frame.scopes.begin(),
+                 [](auto const &timing, auto const &scope) {
+                   return timing.name == scope.name &&
+                          timing.depth == scope.depth;
+                 })};
+  if (!sameLayout) {
+    m_timings.clear();
+    for (auto const &scope : frame.scopes) {
+      m_timings.push_back({.name = scope.name, .depth = scope.depth});
+    }
+  }
+
+  for (auto const index : iter::range(frame.scopes.size())) {
+    auto const &scope{frame.scopes.at(index)};
+    if (scope.endQuery == 0)
+      continue;
+
+    GLuint64 begin{};
+    GLuint64 end{};
+    glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+    auto const milliseconds{end > begin ? static_cast<double>(end - begin) / 1e6
+                                        : 0.0};
+
+    auto &timing{m_timings.at(index)};
+    timing.milliseconds = sameLayout ? timing.milliseconds * 0.9 +
+                                           milliseconds * 0.1
+                                     : milliseconds;
+  }
+#endif
+}
+
+/**
+ * @brief Begins a named scope in the given profiler.
+ *
+ * @param profiler Profiler that will record the scope.
+ * @param name Name of the scope.
+ */
+abcg::OpenGLProfilerScope::OpenGLProfilerScope(OpenGLProfiler &profiler,
+                                               std::string_view name)
+    : m_profiler(profiler) {
+  m_profiler.beginScope(name);
+}
+
+/**
+ * @brief Ends the scope.
+ */
+abcg::OpenGLProfilerScope::~OpenGLProfilerScope() { m_profiler.endScope(); }
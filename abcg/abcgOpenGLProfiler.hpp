@@ -0,0 +1,119 @@
+/**
+ * @file abcgOpenGLProfiler.hpp
+ * @brief Header file of abcg::OpenGLProfiler.
+ *
+ * Declaration of abcg::OpenGLProfiler and abcg::OpenGLProfilerScope.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROFILER_HPP_
+#define ABCG_OPENGL_PROFILER_HPP_
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcgOpenGLFunction.hpp"
+
+namespace abcg {
+class OpenGLProfiler;
+class OpenGLProfilerScope;
+} // namespace abcg
+
+/**
+ * @brief GPU profiler based on OpenGL timestamp queries.
+ *
+ * Named scopes are delimited by calls to abcg::OpenGLProfiler::beginScope and
+ * abcg::OpenGLProfiler::endScope, and may be nested. Each scope issues two
+ * `GL_TIMESTAMP` queries. The queries of a frame are read back only after
+ * abcg::OpenGLProfiler::framesInFlight frames, and only if their results are
+ * already available, so the profiler never stalls the pipeline.
+ *
+ * Timer queries are not available in WebGL 2.0. In that case, or if the
+ * profiler has not been created, all functions are no-ops.
+ *
+ * @sa abcg::OpenGLProfilerScope for a scope guard.
+ * @sa abcg::OpenGLSettings::showGPUProfiler.
+ */
+class abcg::OpenGLProfiler {
+public:
+  /** @brief Number of frames kept in the ring of query objects. */
+  static constexpr std::size_t framesInFlight{4};
+
+  /** @brief GPU time of a named scope. */
+  struct Timing {
+    /** @brief Scope name. */
+    std::string name;
+    /** @brief Nesting level of the scope (0 for top-level scopes). */
+    int depth{};
+    /** @brief Smoothed GPU time, in milliseconds. */
+    double milliseconds{};
+  };
+
+  void create();
+  void destroy();
+
+  void beginFrame();
+  void beginScope(std::string_view name);
+  void endScope();
+
+  [[nodiscard]] bool isSupported() const noexcept;
+  [[nodiscard]] std::vector<Timing> const &getTimings() const noexcept;
+
+private:
+  struct Scope {
+    std::string name;
+    int depth{};
+    GLuint beginQuery{};
+    GLuint endQuery{};
+  };
+
+  struct Frame {
+    std::vector<Scope> scopes;
+    std::vector<GLuint> queries; // Pool of query objects owned by the frame
+    std::size_t usedQueries{};
+  };
+
+  GLuint acquireQuery(Frame &frame);
+  void resolve(Frame const &frame);
+
+  std::array<Frame, framesInFlight> m_frames{};
+  std::size_t m_currentFrame{};
+  std::vector<std::size_t> m_openScopes;
+  std::vector<Timing> m_timings;
+  bool m_supported{};
+};
+
+/**
+ * @brief Scope guard for abcg::OpenGLProfiler.
+ *
+ * Begins a named GPU scope on construction and ends it on destruction:
+ * @code
+ * {
+ *   abcg::OpenGLProfilerScope scope{getGPUProfiler(), "Ground"};
+ *   // Draw calls...
+ * }
+ * @endcode
+ *
+ * @remark Objects of this type cannot be copied or moved.
+ */
+class abcg::OpenGLProfilerScope {
+public:
+  OpenGLProfilerScope(OpenGLProfiler &profiler, std::string_view name);
+  ~OpenGLProfilerScope();
+
+  OpenGLProfilerScope(OpenGLProfilerScope const &) = delete;
+  OpenGLProfilerScope(OpenGLProfilerScope &&) = delete;
+  OpenGLProfilerScope &operator=(OpenGLProfilerScope const &) = delete;
+  OpenGLProfilerScope &operator=(OpenGLProfilerScope &&) = delete;
+
+private:
+  OpenGLProfiler &m_profiler;
+};
+
+#endif
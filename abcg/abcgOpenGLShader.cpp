@@ -14,15 +14,36 @@
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <regex>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #include "abcgException.hpp"
+#include "abcgUtil.hpp"
 
 namespace {
+// Directory of the program binary cache, or empty if disabled
+std::string
+    programCacheDirectory; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// Header of the files of the program binary cache
+struct ProgramBinaryHeader {
+  static constexpr std::array<char, 4> expectedMagic{'A', 'B', 'P', 'B'};
+  static constexpr std::uint32_t currentVersion{1};
+
+  std::array<char, 4> magic{expectedMagic};
+  std::uint32_t version{currentVersion};
+  std::uint64_t key{};
+  std::uint32_t format{}; // As returned by glGetProgramBinary
+  std::uint32_t size{};   // Size of the binary that follows the header
+};
+
 void printShaderInfoLog(GLuint const shader, std::string_view prefix) {
   GLint infoLogLength{};
   glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
@@ -96,10 +117,20 @@ void printProgramInfoLog(GLuint const program) {
   return source.str();
 }
 
-// Compiles a shader and returns immediately (i.e. don't wait until completion).
-// Returns the shader ID of the compiled shader.
-[[nodiscard]] abcg::OpenGLShader compileHelper(std::string_view shaderSource,
-                                               GLuint shaderStage) {
+[[nodiscard]] std::vector<abcg::ShaderSource>
+toSources(std::vector<abcg::ShaderSource> const &pathsOrSources) {
+  std::vector<abcg::ShaderSource> sources;
+  sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    sources.push_back({.source = abcg::addShaderDefines(
+                           toSource(pathOrSource.source), pathOrSource.defines),
+                       .stage = pathOrSource.stage});
+  }
+  return sources;
+}
+
+// Returns the source code actually passed to the driver
+[[nodiscard]] std::string prepareSource(std::string_view shaderSource) {
   std::string source{shaderSource};
 #if !defined(__EMSCRIPTEN__) && defined(__APPLE__)
   // Remove version header, if any
@@ -110,6 +141,14 @@ void printProgramInfoLog(GLuint const program) {
     source = "#version 410\n" + source;
   }
 #endif
+  return source;
+}
+
+// Compiles a shader and returns immediately (i.e. don't wait until completion).
+// Returns the shader ID of the compiled shader.
+[[nodiscard]] abcg::OpenGLShader compileHelper(std::string_view shaderSource,
+                                               GLuint shaderStage) {
+  auto const source{prepareSource(shaderSource)};
 
   auto shaderID{glCreateShader(shaderStage)};
   auto const *sourceCStr{source.c_str()};
@@ -125,6 +164,58 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
   }
 }
 
+// Creates a program with the shaders attached, triggers the linking and
+// returns immediately. The shaders are deleted. Returns 0 if the program
+// could not be created
+[[nodiscard]] GLuint linkHelper(std::vector<abcg::OpenGLShader> const &shaders,
+                                [[maybe_unused]] bool retrievable) {
+  auto const shaderProgram{glCreateProgram()};
+  if (shaderProgram == 0) {
+    deleteShaders(shaders);
+    return 0;
+  }
+
+  for (auto const &shader : shaders) {
+    glAttachShader(shaderProgram, shader.shader);
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  if (retrievable) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+  glLinkProgram(shaderProgram);
+
+  for (auto const &shader : shaders) {
+    glDetachShader(shaderProgram, shader.shader);
+  }
+  deleteShaders(shaders);
+
+  return shaderProgram;
+}
+
+// Whether GL_COMPLETION_STATUS_KHR can be queried, i.e., whether the driver
+// compiles and links in the background
+[[nodiscard]] bool isParallelShaderCompileSupported() {
+#if defined(__EMSCRIPTEN__)
+  GLint numExtensions{};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (auto const index : iter::range(numExtensions)) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    std::string_view const extension{reinterpret_cast<char const *>(
+        glGetStringi(GL_EXTENSIONS, gsl::narrow<GLuint>(index)))};
+    if (extension == "GL_KHR_parallel_shader_compile") {
+      return true;
+    }
+  }
+  return false;
+#else
+  return GLEW_KHR_parallel_shader_compile != 0 ||
+         GLEW_ARB_parallel_shader_compile != 0;
+#endif
+}
+
 [[nodiscard]] GLuint abcgStageToOpenGLStage(abcg::ShaderStage stage) {
   switch (stage) {
   case abcg::ShaderStage::Vertex:
@@ -153,11 +244,143 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
     throw abcg::RuntimeError("Unknown shader stage");
   }
 }
+
+// Whether programs are cached. Requires at least one binary format, which
+// WebGL 2.0 does not provide
+[[nodiscard]] bool isProgramCacheEnabled() {
+#if defined(__EMSCRIPTEN__)
+  return false;
+#else
+  if (programCacheDirectory.empty()) {
+    return false;
+  }
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  return numFormats > 0;
+#endif
+}
+
+// Hash of everything a program binary depends on: the driver, and the stage
+// and source code of each shader
+[[nodiscard]] std::uint64_t
+getProgramKey(std::vector<abcg::ShaderSource> const &sources) {
+  std::string key;
+  for (auto const name : std::array<GLenum, 4>{GL_VENDOR, GL_RENDERER,
+                                                GL_VERSION,
+                                                GL_SHADING_LANGUAGE_VERSION}) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto const *text{reinterpret_cast<char const *>(glGetString(name))};
+    key += text != nullptr ? text : "";
+    key += '\n';
+  }
+  for (auto const &source : sources) {
+    auto const prepared{prepareSource(source.source)};
+    key += fmt::format("{}:{}:", static_cast<int>(source.stage),
+                       prepared.size());
+    key += prepared;
+  }
+  return abcg::hashBytes(std::as_bytes(std::span{key}));
+}
+
+[[nodiscard]] std::filesystem::path getProgramBinaryPath(std::uint64_t key) {
+  return std::filesystem::path{programCacheDirectory} /
+         fmt::format("{:016x}.bin", key);
+}
+
+// Creates a program from a cached binary. Returns 0 if there is no binary for
+// the key or if the driver rejects it (e.g., after a driver update)
+[[nodiscard]] GLuint loadProgramBinary(std::uint64_t key) {
+  std::ifstream stream(getProgramBinaryPath(key), std::ios::binary);
+  if (!stream) {
+    return 0;
+  }
+
+  ProgramBinaryHeader header{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!stream || header.magic != ProgramBinaryHeader::expectedMagic ||
+      header.version != ProgramBinaryHeader::currentVersion ||
+      header.key != key) {
+    return 0;
+  }
+  std::vector<char> binary(header.size);
+  stream.read(binary.data(), gsl::narrow<std::streamsize>(binary.size()));
+  if (!stream) {
+    return 0;
+  }
+
+  auto const program{glCreateProgram()};
+  if (program == 0) {
+    return 0;
+  }
+  glProgramBinary(program, header.format, binary.data(),
+                  gsl::narrow<GLsizei>(binary.size()));
+  GLint linkStatus{};
+  glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == GL_FALSE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+// Stores the binary of a linked program. The cache is only an optimization,
+// so failures are reported but not thrown
+void saveProgramBinary(GLuint program, std::uint64_t key) {
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(gsl::narrow<std::size_t>(length));
+  GLsizei written{};
+  GLenum format{};
+  glGetProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return;
+  }
+
+  ProgramBinaryHeader const header{.key = key,
+                                   .format = format,
+                                   .size = gsl::narrow<std::uint32_t>(written)};
+
+  // Writes to a temporary file that is then renamed, so that other processes
+  // never read a partial binary
+  auto const path{getProgramBinaryPath(key)};
+  auto temporary{path};
+  temporary += ".tmp";
+  std::error_code error;
+  std::filesystem::create_directories(programCacheDirectory, error);
+  {
+    std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    stream.write(binary.data(), written);
+    if (!stream.flush()) {
+      error = std::make_error_code(std::errc::io_error);
+    }
+  }
+  if (!error) {
+    std::filesystem::rename(temporary, path, error);
+  }
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    fmt::print("Warning: failed to write program binary {}\n", path.string());
+  }
+}
 } // namespace
 
 /**
  * @brief Creates a program object from a group of shader paths or source codes.
  *
+ * If a program cache directory was set with
+ * abcg::setOpenGLProgramCacheDirectory, the program is first looked up in the
+ * cache by a hash of the source codes, the shader stages and the vendor,
+ * renderer and version strings of the driver. A cached binary is restored
+ * with `glProgramBinary`. If there is none, or if the driver rejects it, the
+ * shaders are compiled and linked, and the binary of the new program is
+ * stored in the cache.
+ *
  * @param pathsOrSources Paths or source codes of the shaders to be compiled and
  * linked to the program.
  * @param throwOnError Whether to throw exceptions on compile/link errors.
@@ -171,11 +394,15 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
 GLuint
 abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
                           bool throwOnError) {
-  std::vector<ShaderSource> sources;
-  sources.reserve(pathsOrSources.size());
-  for (auto const &pathOrSource : pathsOrSources) {
-    sources.push_back(
-        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  auto const sources{toSources(pathsOrSources)};
+
+  auto const useCache{isProgramCacheEnabled()};
+  std::uint64_t key{};
+  if (useCache) {
+    key = getProgramKey(sources);
+    if (auto const program{loadProgramBinary(key)}; program != 0) {
+      return program;
+    }
   }
 
   std::vector<OpenGLShader> compiledShaders;
@@ -188,26 +415,14 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
   if (!checkOpenGLShaderCompile(compiledShaders, throwOnError))
     return 0U;
 
-  auto const shaderProgram{glCreateProgram()};
+  auto const shaderProgram{linkHelper(compiledShaders, useCache)};
   if (shaderProgram == 0) {
-    deleteShaders(compiledShaders);
     if (throwOnError) {
       throw abcg::RuntimeError("Failed to create program");
     }
     return 0;
   }
 
-  for (auto const &shader : compiledShaders) {
-    glAttachShader(shaderProgram, shader.shader);
-  }
-
-  glLinkProgram(shaderProgram);
-
-  for (auto const &shader : compiledShaders) {
-    glDetachShader(shaderProgram, shader.shader);
-    glDeleteShader(shader.shader);
-  }
-
   GLint linkStatus{};
   glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkStatus);
   if (linkStatus == GL_FALSE) {
@@ -221,6 +436,10 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     return 0U;
   }
 
+  if (useCache) {
+    saveProgramBinary(shaderProgram, key);
+  }
+
   return shaderProgram;
 }
 
@@ -249,16 +468,9 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
  */
 std::vector<abcg::OpenGLShader> abcg::triggerOpenGLShaderCompile(
     std::vector<ShaderSource> const &pathsOrSources) {
-  std::vector<ShaderSource> sources;
-  sources.reserve(pathsOrSources.size());
-  for (auto const &pathOrSource : pathsOrSources) {
-    sources.push_back(
-        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
-  }
-
   std::vector<OpenGLShader> compiledShaders;
-  compiledShaders.reserve(sources.size());
-  for (auto const &source : sources) {
+  compiledShaders.reserve(pathsOrSources.size());
+  for (auto const &source : toSources(pathsOrSources)) {
     compiledShaders.push_back(
         compileHelper(source.source, abcgStageToOpenGLStage(source.stage)));
   }
@@ -320,27 +532,10 @@ bool abcg::checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
  */
 GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                      bool throwOnError) {
-  auto const shaderProgram{glCreateProgram()};
-  if (shaderProgram == 0) {
-    deleteShaders(shaders);
-    if (throwOnError) {
-      throw abcg::RuntimeError("Failed to create program");
-    }
-    return 0;
-  }
-
-  for (auto const &shader : shaders) {
-    glAttachShader(shaderProgram, shader.shader);
-  }
-
-  glLinkProgram(shaderProgram);
-
-  for (auto const &shader : shaders) {
-    glDetachShader(shaderProgram, shader.shader);
+  auto const shaderProgram{linkHelper(shaders, false)};
+  if (shaderProgram == 0 && throwOnError) {
+    throw abcg::RuntimeError("Failed to create program");
   }
-
-  deleteShaders(shaders);
-
   return shaderProgram;
 }
 
@@ -373,4 +568,347 @@ bool abcg::checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError) {
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Enables the on-disk cache of program binaries used by
+ * abcg::createOpenGLProgram.
+ *
+ * The cache is disabled by default. Each program is stored in its own file,
+ * named after a hash of everything the binary depends on, so changing a
+ * shader or updating the driver creates a new file instead of invalidating
+ * the old one. Old files are never deleted.
+ *
+ * @param path Directory of the cache. It is created when the first binary is
+ * stored. Use an empty string to disable the cache.
+ *
+ * @remark Program binaries are not available in WebGL 2.0, in which case the
+ * cache is always disabled.
+ *
+ * @sa abcg::OpenGLSettings::programCacheDirectory.
+ */
+void abcg::setOpenGLProgramCacheDirectory(std::string_view path) {
+  programCacheDirectory = path;
+}
+
+/**
+ * @brief Submits the shaders of a program for compilation and returns
+ * immediately.
+ *
+ * All shaders are handed to the driver right away. If the program is in the
+ * cache set with abcg::setOpenGLProgramCacheDirectory, it is restored from its
+ * binary and is ready immediately.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders to be compiled and
+ * linked to the program.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ *
+ * @return Index of the program, to be used with
+ * abcg::OpenGLProgramBuilder::getProgram.
+ */
+std::size_t abcg::OpenGLProgramBuilder::add(
+    std::vector<ShaderSource> const &pathsOrSources) {
+  if (m_programs.empty()) {
+    m_parallel = isParallelShaderCompileSupported();
+#if !defined(__EMSCRIPTEN__)
+    // Lets the driver choose the number of compiler threads. GLEW loads only
+    // the entry point of the extension that is supported
+    if (GLEW_KHR_parallel_shader_compile != 0) {
+      glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (GLEW_ARB_parallel_shader_compile != 0) {
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+#endif
+  }
+
+  auto const sources{toSources(pathsOrSources)};
+
+  Program program;
+  program.useCache = isProgramCacheEnabled();
+  if (program.useCache) {
+    program.key = getProgramKey(sources);
+    program.program = loadProgramBinary(program.key);
+    if (program.program != 0) {
+      program.state = State::Ready;
+      ++m_numReadyPrograms;
+    }
+  }
+
+  if (program.state == State::Compiling) {
+    program.shaders.reserve(sources.size());
+    for (auto const &source : sources) {
+      program.shaders.push_back(
+          compileHelper(source.source, abcgStageToOpenGLStage(source.stage)));
+    }
+  }
+
+  m_programs.push_back(std::move(program));
+  return m_programs.size() - 1;
+}
+
+/**
+ * @brief Advances the build of the programs without blocking.
+ *
+ * Call once per frame, e.g., in abcg::OpenGLWindow::onPaint while rendering a
+ * loading screen. Programs whose shaders finished compiling are linked, and
+ * programs that finished linking become ready.
+ *
+ * If `KHR_parallel_shader_compile` (or `ARB_parallel_shader_compile`) is
+ * supported, progress is polled with `GL_COMPLETION_STATUS_KHR` and the
+ * driver compiles and links on its own threads. Otherwise, a single step of a
+ * single program is completed per call, which blocks until the driver is done
+ * but keeps each call short.
+ *
+ * @throw abcg::RuntimeError if the compilation of any shader has failed, or if
+ * a program could not be created or linked. The program that failed is
+ * deleted and counted as ready, with ID 0.
+ *
+ * @return `true` if all programs are ready; `false` otherwise.
+ */
+bool abcg::OpenGLProgramBuilder::update() {
+  for (auto &program : m_programs) {
+    if (program.state != State::Ready && advance(program, !m_parallel) &&
+        !m_parallel) {
+      break;
+    }
+  }
+  return isReady();
+}
+
+/**
+ * @brief Blocks until all programs are ready.
+ *
+ * @throw abcg::RuntimeError if the compilation of any shader has failed, or if
+ * a program could not be created or linked.
+ */
+void abcg::OpenGLProgramBuilder::wait() {
+  // All programs are linked before the first link status is queried, so that
+  // links also overlap each other
+  for (auto const state : {State::Compiling, State::Linking}) {
+    for (auto &program : m_programs) {
+      if (program.state == state) {
+        advance(program, true);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Deletes the programs that are not ready yet and removes all programs
+ * from the builder.
+ *
+ * Programs that are ready belong to the application and are not deleted. Must
+ * be called while the OpenGL context is current, e.g., in
+ * abcg::OpenGLWindow::onDestroy.
+ */
+void abcg::OpenGLProgramBuilder::destroy() {
+  for (auto const &program : m_programs) {
+    if (program.state == State::Compiling) {
+      deleteShaders(program.shaders);
+    } else if (program.state == State::Linking) {
+      glDeleteProgram(program.program);
+    }
+  }
+  m_programs.clear();
+  m_numReadyPrograms = 0;
+}
+
+/**
+ * @brief Returns whether all programs are ready.
+ */
+bool abcg::OpenGLProgramBuilder::isReady() const noexcept {
+  return m_numReadyPrograms == m_programs.size();
+}
+
+/**
+ * @brief Returns whether the driver compiles and links in the background.
+ *
+ * Only valid after the first call to abcg::OpenGLProgramBuilder::add.
+ */
+bool abcg::OpenGLProgramBuilder::isParallel() const noexcept {
+  return m_parallel;
+}
+
+/**
+ * @brief Returns the number of programs added to the builder.
+ */
+std::size_t abcg::OpenGLProgramBuilder::getNumPrograms() const noexcept {
+  return m_programs.size();
+}
+
+/**
+ * @brief Returns the number of programs that are ready, e.g., to show the
+ * progress of a loading screen.
+ */
+std::size_t abcg::OpenGLProgramBuilder::getNumReadyPrograms() const noexcept {
+  return m_numReadyPrograms;
+}
+
+/**
+ * @brief Returns the ID of a program object.
+ *
+ * @param index Index returned by abcg::OpenGLProgramBuilder::add.
+ *
+ * @return ID of the program object, or 0 if the program is not ready or if
+ * its build has failed. Once ready, the program belongs to the application,
+ * which must delete it with `glDeleteProgram`.
+ */
+GLuint abcg::OpenGLProgramBuilder::getProgram(std::size_t index) const {
+  auto const &program{m_programs.at(index)};
+  return program.state == State::Ready ? program.program : 0;
+}
+
+// Completes the current step of a program: compilation or linking. If block
+// is false and the driver is not done yet, returns false
+bool abcg::OpenGLProgramBuilder::advance(Program &program, bool block) {
+  if (program.state == State::Compiling) {
+    if (!block) {
+      for (auto const &shader : program.shaders) {
+        GLint completionStatus{};
+        glGetShaderiv(shader.shader, GL_COMPLETION_STATUS_KHR,
+                      &completionStatus);
+        if (completionStatus == GL_FALSE) {
+          return false;
+        }
+      }
+    }
+
+    // The shaders are deleted by the checks, so the program counts as a
+    // failed one until it is linking, in case the checks throw
+    auto const shaders{std::exchange(program.shaders, {})};
+    program.state = State::Ready;
+    ++m_numReadyPrograms;
+    checkOpenGLShaderCompile(shaders);
+    program.program = linkHelper(shaders, program.useCache);
+    if (program.program == 0) {
+      throw abcg::RuntimeError("Failed to create program");
+    }
+    program.state = State::Linking;
+    --m_numReadyPrograms;
+    return true;
+  }
+
+  if (program.state == State::Linking) {
+    if (!block) {
+      GLint completionStatus{};
+      glGetProgramiv(program.program, GL_COMPLETION_STATUS_KHR,
+                     &completionStatus);
+      if (completionStatus == GL_FALSE) {
+        return false;
+      }
+    }
+
+    // Same as above: the program is deleted if the check throws
+    auto const shaderProgram{std::exchange(program.program, 0U)};
+    program.state = State::Ready;
+    ++m_numReadyPrograms;
+    checkOpenGLShaderLink(shaderProgram);
+    program.program = shaderProgram;
+    if (program.useCache) {
+      saveProgramBinary(shaderProgram, program.key);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the shaders of the permutations.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders, with the
+ * definitions common to all variants, if any.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ */
+void abcg::OpenGLShaderPermutations::create(
+    std::vector<ShaderSource> const &pathsOrSources) {
+  destroy();
+  m_sources.clear();
+  m_sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    m_sources.push_back({.source = toSource(pathOrSource.source),
+                         .stage = pathOrSource.stage,
+                         .defines = pathOrSource.defines});
+  }
+}
+
+/**
+ * @brief Returns the program of a variant, compiling it on first use.
+ *
+ * @param defines Definitions of the variant, added to the definitions of each
+ * shader.
+ *
+ * @throw abcg::RuntimeError if the program could not be created, or if the
+ * compilation of any shader has failed, or if the linking has failed.
+ *
+ * @return ID of the program object. The program belongs to the permutations
+ * and is deleted by abcg::OpenGLShaderPermutations::destroy.
+ */
+GLuint abcg::OpenGLShaderPermutations::getProgram(
+    std::vector<std::string> const &defines) {
+  auto sortedDefines{defines};
+  std::ranges::sort(sortedDefines);
+  auto const [first, last]{std::ranges::unique(sortedDefines)};
+  sortedDefines.erase(first, last);
+
+  std::string variantKey;
+  for (auto const &define : sortedDefines) {
+    variantKey += define;
+    variantKey += '\n';
+  }
+  if (auto const iter{m_variants.find(variantKey)}; iter != m_variants.end()) {
+    return iter->second;
+  }
+
+  // Definitions of each shader followed by the ones of the variant, without
+  // repetitions
+  std::vector<ShaderSource> sources;
+  sources.reserve(m_sources.size());
+  std::string sourcesKey;
+  for (auto const &source : m_sources) {
+    auto shaderDefines{source.defines};
+    for (auto const &define : sortedDefines) {
+      if (std::ranges::find(shaderDefines, define) == shaderDefines.end()) {
+        shaderDefines.push_back(define);
+      }
+    }
+    sources.push_back({.source = addShaderDefines(source.source, shaderDefines),
+                       .stage = source.stage});
+    sourcesKey += fmt::format("{}:{}:", static_cast<int>(source.stage),
+                              sources.back().source.size());
+    sourcesKey += sources.back().source;
+  }
+
+  GLuint program{};
+  if (auto const iter{m_programs.find(sourcesKey)}; iter != m_programs.end()) {
+    program = iter->second;
+  } else {
+    program = createOpenGLProgram(sources);
+    m_programs.emplace(std::move(sourcesKey), program);
+  }
+  m_variants.emplace(std::move(variantKey), program);
+  return program;
+}
+
+/**
+ * @brief Returns the number of programs compiled so far.
+ *
+ * Variants that share a program are counted once.
+ */
+std::size_t abcg::OpenGLShaderPermutations::getNumPrograms() const noexcept {
+  return m_programs.size();
+}
+
+/**
+ * @brief Deletes the programs of all variants.
+ *
+ * The shaders read by abcg::OpenGLShaderPermutations::create are kept, so
+ * variants can still be requested afterwards.
+ */
+void abcg::OpenGLShaderPermutations::destroy() {
+  for (auto const &[sourcesKey, program] : m_programs) {
+    glDeleteProgram(program);
+  }
+  m_programs.clear();
+  m_variants.clear();
+}
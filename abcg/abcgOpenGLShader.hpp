@@ -14,11 +14,18 @@
 #include "abcgOpenGLExternal.hpp"
 #include "abcgShader.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace abcg {
 struct OpenGLShader;
-}
+class OpenGLProgramBuilder;
+class OpenGLShaderPermutations;
+} // namespace abcg
 
 /**
  * @brief OpenGL shader object and its corresponding stage.
@@ -41,6 +48,96 @@ bool checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
 GLuint triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                bool throwOnError = true);
 bool checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError = true);
+void setOpenGLProgramCacheDirectory(std::string_view path);
 } // namespace abcg
 
+/**
+ * @brief Builds a batch of OpenGL programs without blocking the application.
+ *
+ * abcg::createOpenGLProgram waits for each program to be compiled and linked
+ * before the next one is submitted. This class submits the shaders of all
+ * programs up front and collects the results later, so that drivers that
+ * support `KHR_parallel_shader_compile` compile them on their own threads
+ * while the application keeps rendering, e.g., a loading screen:
+ * @code
+ * // onCreate
+ * m_programIndex = m_programBuilder.add({{.source = ..., .stage = ...}, ...});
+ * // onPaint
+ * if (!m_programBuilder.update()) {
+ *   // Render the loading screen
+ *   return;
+ * }
+ * auto const program{m_programBuilder.getProgram(m_programIndex)};
+ * @endcode
+ *
+ * Programs are restored from the cache set with
+ * abcg::setOpenGLProgramCacheDirectory, and new programs are stored in it.
+ */
+class abcg::OpenGLProgramBuilder {
+public:
+  OpenGLProgramBuilder() = default;
+  OpenGLProgramBuilder(OpenGLProgramBuilder const &) = delete;
+  OpenGLProgramBuilder(OpenGLProgramBuilder &&) = delete;
+  OpenGLProgramBuilder &operator=(OpenGLProgramBuilder const &) = delete;
+  OpenGLProgramBuilder &operator=(OpenGLProgramBuilder &&) = delete;
+  ~OpenGLProgramBuilder() = default;
+
+  std::size_t add(std::vector<ShaderSource> const &pathsOrSources);
+  bool update();
+  void wait();
+  void destroy();
+
+  [[nodiscard]] bool isReady() const noexcept;
+  [[nodiscard]] bool isParallel() const noexcept;
+  [[nodiscard]] std::size_t getNumPrograms() const noexcept;
+  [[nodiscard]] std::size_t getNumReadyPrograms() const noexcept;
+  [[nodiscard]] GLuint getProgram(std::size_t index) const;
+
+private:
+  enum class State { Compiling, Linking, Ready };
+
+  struct Program {
+    std::vector<OpenGLShader> shaders;
+    GLuint program{};
+    std::uint64_t key{};
+    bool useCache{};
+    State state{State::Compiling};
+  };
+
+  bool advance(Program &program, bool block);
+
+  std::vector<Program> m_programs;
+  std::size_t m_numReadyPrograms{};
+  bool m_parallel{};
+};
+
+/**
+ * @brief Compile-time variants of a group of shaders.
+ *
+ * Each variant is the same group of shaders with a different set of
+ * preprocessor definitions (see abcg::ShaderSource::defines), so that
+ * specialized programs (e.g., without texturing or lighting, or with
+ * instancing) need no branching in the shaders and no separate shader files.
+ *
+ * Shader files are read once, in abcg::OpenGLShaderPermutations::create.
+ * Variants are compiled on first use with abcg::createOpenGLProgram, so they
+ * also use the program binary cache. Sets of definitions that differ only in
+ * order or repetition, or that result in the same source code, share the same
+ * program.
+ */
+class abcg::OpenGLShaderPermutations {
+public:
+  void create(std::vector<ShaderSource> const &pathsOrSources);
+  [[nodiscard]] GLuint getProgram(std::vector<std::string> const &defines = {});
+  [[nodiscard]] std::size_t getNumPrograms() const noexcept;
+  void destroy();
+
+private:
+  std::vector<ShaderSource> m_sources;
+  // Programs by sorted set of definitions, one per line
+  std::unordered_map<std::string, GLuint> m_variants;
+  // Programs by stage, size and text of their final source codes
+  std::unordered_map<std::string, GLuint> m_programs;
+};
+
 #endif
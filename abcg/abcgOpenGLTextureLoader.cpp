@@ -0,0 +1,535 @@
+/**
+ * @file abcgOpenGLTextureLoader.cpp
+ * @brief Definition of abcg::OpenGLTextureLoader members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLTextureLoader.hpp"
+
+#include <SDL_events.h>
+#include <SDL_image.h>
+
+#include <algorithm>
+#include <array>
+
+#include "abcgException.hpp"
+#include "abcgImage.hpp"
+#include "abcgProfiler.hpp"
+#include "abcgUtil.hpp"
+
+/**
+ * @brief Stops the worker threads.
+ *
+ * Textures are not deleted here, as the OpenGL context may no longer exist.
+ * Call abcg::OpenGLTextureLoader::destroy for that.
+ */
+abcg::OpenGLTextureLoader::~OpenGLTextureLoader() { stopWorkers(); }
+
+/**
+ * @brief Creates the placeholder textures and starts the worker threads.
+ *
+ * Must be called after the OpenGL context is created.
+ */
+void abcg::OpenGLTextureLoader::create() {
+  std::array<unsigned char, 4> const gray{128, 128, 128, 255};
+  glGenTextures(1, &m_placeholder);
+  glBindTexture(GL_TEXTURE_2D, m_placeholder);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               gray.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenTextures(1, &m_arrayPlaceholder);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrayPlaceholder);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, gray.data());
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  for (auto &&[index, supported] : iter::enumerate(m_compressedFormats)) {
+    supported = isOpenGLTextureFormatSupported(
+        index < 2 ? KTX2Format::BC1 : KTX2Format::ETC2, index % 2 == 1);
+  }
+
+  if (auto const eventType{SDL_RegisterEvents(1)};
+      eventType != std::numeric_limits<Uint32>::max()) {
+    m_wakeEventType = eventType;
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  stopWorkers();
+  m_stopping = false;
+  auto const numWorkers{
+      std::clamp(std::thread::hardware_concurrency() - 1, 1U, 4U)};
+  for ([[maybe_unused]] auto const _ : iter::range(numWorkers)) {
+    m_workers.emplace_back(&OpenGLTextureLoader::workerLoop, this);
+  }
+#endif
+}
+
+/**
+ * @brief Stops the worker threads, discards the pending requests and deletes
+ * all textures, including the placeholder.
+ *
+ * Must be called while the OpenGL context is current.
+ */
+void abcg::OpenGLTextureLoader::destroy() {
+  stopWorkers();
+  m_jobs.clear();
+  m_decoded.clear();
+  m_inFlight = 0;
+
+  for (auto const &entry : m_entries) {
+    if (entry.texture != 0) {
+      glDeleteTextures(1, &entry.texture);
+    }
+  }
+  m_entries.clear();
+  m_freeEntries.clear();
+
+  glDeleteTextures(1, &m_placeholder);
+  glDeleteTextures(1, &m_arrayPlaceholder);
+  m_placeholder = 0;
+  m_arrayPlaceholder = 0;
+}
+
+/**
+ * @brief Requests a texture to be loaded asynchronously.
+ *
+ * @param createInfo Texture creation settings.
+ *
+ * @return Handle to the texture. Until the texture is ready,
+ * abcg::OpenGLTextureLoader::getTexture returns the placeholder texture.
+ */
+abcg::OpenGLTextureLoader::Handle
+abcg::OpenGLTextureLoader::load(OpenGLTextureCreateInfo const &createInfo) {
+  Entry entry;
+  entry.createInfo = createInfo;
+  entry.createInfo.path = {};
+
+  Job job;
+  job.path = createInfo.path;
+  job.flipUpsideDown = createInfo.flipUpsideDown;
+  job.sRGBToLinear = createInfo.sRGBToLinear;
+
+  return addEntry(std::move(entry), std::move(job));
+}
+
+/**
+ * @brief Requests an array texture to be loaded asynchronously.
+ *
+ * @param createInfo Texture creation settings. The layers are either all
+ * PNG/JPEG images or all KTX2 files.
+ *
+ * @return Handle to the texture. Until the texture is ready,
+ * abcg::OpenGLTextureLoader::getTexture returns a placeholder array texture.
+ */
+abcg::OpenGLTextureLoader::Handle abcg::OpenGLTextureLoader::load(
+    OpenGLTextureArrayCreateInfo const &createInfo) {
+  Entry entry;
+  entry.arrayCreateInfo = createInfo;
+  entry.arrayCreateInfo->paths.clear();
+
+  Job job;
+  job.layerPaths.assign(createInfo.paths.begin(), createInfo.paths.end());
+  job.layerSize = createInfo.size;
+  job.flipUpsideDown = createInfo.flipUpsideDown;
+  job.sRGBToLinear = createInfo.sRGBToLinear;
+
+  return addEntry(std::move(entry), std::move(job));
+}
+
+/**
+ * @brief Deletes a texture.
+ *
+ * If the texture is still pending, its request is discarded. The handle must
+ * not be used afterwards.
+ *
+ * @param handle Handle returned by abcg::OpenGLTextureLoader::load.
+ */
+void abcg::OpenGLTextureLoader::release(Handle handle) {
+  if (getStatus(handle) == Status::Released)
+    return;
+
+  auto &entry{m_entries.at(handle.index)};
+  if (entry.texture != 0) {
+    glDeleteTextures(1, &entry.texture);
+    entry.texture = 0;
+  }
+  entry.status = Status::Released;
+  m_freeEntries.push_back(handle.index);
+}
+
+/**
+ * @brief Creates the textures of the images decoded so far, within the upload
+ * budget.
+ *
+ * Must be called on the OpenGL thread. abcg::OpenGLWindow calls it once per
+ * frame, before abcg::OpenGLWindow::onPaintUI.
+ */
+void abcg::OpenGLTextureLoader::update() {
+  if (m_inFlight == 0)
+    return;
+
+  ProfilerZone zone{"Texture uploads"};
+  std::size_t uploadedBytes{};
+  while (uploadedBytes < m_uploadBudget) {
+    Job job;
+    auto decodeHere{false};
+    {
+      std::scoped_lock lock{m_mutex};
+      if (!m_decoded.empty()) {
+        job = std::move(m_decoded.front());
+        m_decoded.pop_front();
+      } else if (m_workers.empty() && !m_jobs.empty()) {
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        decodeHere = true;
+      } else {
+        break;
+      }
+    }
+
+    if (decodeHere) {
+      decode(job);
+    }
+    uploadedBytes += upload(job);
+    --m_inFlight;
+  }
+}
+
+/**
+ * @brief Returns the texture of a handle.
+ *
+ * @param handle Handle returned by abcg::OpenGLTextureLoader::load.
+ *
+ * @return ID of the texture if it is ready, ID of the placeholder texture if
+ * it is pending or failed to load, or zero if the handle was released.
+ */
+GLuint abcg::OpenGLTextureLoader::getTexture(Handle handle) const {
+  switch (getStatus(handle)) {
+  case Status::Ready:
+    return m_entries.at(handle.index).texture;
+  case Status::Released:
+    return 0;
+  default:
+    return m_entries.at(handle.index).arrayCreateInfo ? m_arrayPlaceholder
+                                                      : m_placeholder;
+  }
+}
+
+/**
+ * @brief Returns the loading status of a texture.
+ *
+ * @param handle Handle returned by abcg::OpenGLTextureLoader::load.
+ */
+abcg::OpenGLTextureLoader::Status
+abcg::OpenGLTextureLoader::getStatus(Handle handle) const {
+  if (handle.index >= m_entries.size())
+    return Status::Released;
+  return m_entries.at(handle.index).status;
+}
+
+/**
+ * @brief Returns whether all requested textures were uploaded or discarded.
+ */
+bool abcg::OpenGLTextureLoader::isIdle() const { return m_inFlight == 0; }
+
+/**
+ * @brief Returns the number of bytes after which
+ * abcg::OpenGLTextureLoader::update stops uploading textures.
+ */
+std::size_t abcg::OpenGLTextureLoader::getUploadBudget() const noexcept {
+  return m_uploadBudget;
+}
+
+/**
+ * @brief Sets the number of bytes after which
+ * abcg::OpenGLTextureLoader::update stops uploading textures.
+ *
+ * @param bytes Upload budget. At least one texture is uploaded per update
+ * regardless of its size.
+ */
+void abcg::OpenGLTextureLoader::setUploadBudget(std::size_t bytes) noexcept {
+  m_uploadBudget = std::max<std::size_t>(bytes, 1);
+}
+
+abcg::OpenGLTextureLoader::Handle
+abcg::OpenGLTextureLoader::addEntry(Entry entry, Job job) {
+  std::size_t index{};
+  if (m_freeEntries.empty()) {
+    index = m_entries.size();
+    m_entries.emplace_back();
+  } else {
+    index = m_freeEntries.back();
+    m_freeEntries.pop_back();
+  }
+
+  auto &slot{m_entries.at(index)};
+  entry.status = Status::Pending;
+  entry.generation = slot.generation + 1;
+  slot = std::move(entry);
+
+  job.index = index;
+  job.generation = slot.generation;
+  ++m_inFlight;
+  {
+    std::scoped_lock lock{m_mutex};
+    m_jobs.push_back(std::move(job));
+  }
+  m_jobAdded.notify_one();
+
+  return {.index = index};
+}
+
+void abcg::OpenGLTextureLoader::decode(Job &job) const {
+  ProfilerZone zone{"Texture decode"};
+  if (!job.layerPaths.empty()) {
+    decodeArray(job);
+  } else if (job.path.ends_with(".ktx2")) {
+    decodeKTX2(job);
+  } else {
+    decodeImage(job);
+  }
+}
+
+void abcg::OpenGLTextureLoader::decodeImage(Job &job) const {
+
+  SurfacePtr surface{IMG_Load(job.path.c_str())};
+  if (!surface) {
+    job.error = fmt::format("Failed to load texture file {}", job.path);
+    return;
+  }
+
+  // Enforce RGB/RGBA, without copying if the image already is
+  if (auto const pixelFormat{surface->format->format};
+      pixelFormat != SDL_PIXELFORMAT_RGB24 &&
+      pixelFormat != SDL_PIXELFORMAT_RGBA32) {
+    surface.reset(SDL_ConvertSurfaceFormat(surface.get(),
+                                           surface->format->BytesPerPixel == 3
+                                               ? SDL_PIXELFORMAT_RGB24
+                                               : SDL_PIXELFORMAT_RGBA32,
+                                           0));
+    if (!surface) {
+      job.error = fmt::format("Failed to convert texture file {}", job.path);
+      return;
+    }
+  }
+
+  if (job.flipUpsideDown) {
+    flipVertically(*surface);
+  }
+  job.surface = std::move(surface);
+}
+
+// Leaves the image ready to be uploaded as it is
+void abcg::OpenGLTextureLoader::decodeKTX2(Job &job) const {
+  try {
+    auto image{readKTX2(job.path)};
+    if (image.bottomUp != job.flipUpsideDown) {
+      flipVertically(image);
+    } else if (!isFormatSupported(image, job.sRGBToLinear)) {
+      image = decompressKTX2(image);
+    }
+    job.image = std::move(image);
+  } catch (std::exception const &exception) {
+    job.error = exception.what();
+  }
+}
+
+// Converts the layers to the pixel format of the first one and resizes them
+void abcg::OpenGLTextureLoader::decodeArray(Job &job) const {
+  auto const isKTX2{[](auto const &path) { return path.ends_with(".ktx2"); }};
+  if (std::ranges::all_of(job.layerPaths, isKTX2)) {
+    decodeKTX2Array(job);
+    return;
+  }
+  if (std::ranges::any_of(job.layerPaths, isKTX2)) {
+    job.error =
+        "Texture array layers must be either all KTX2 or all PNG/JPEG files";
+    return;
+  }
+
+  for (auto const &path : job.layerPaths) {
+    job.path = path;
+    decodeImage(job);
+    if (!job.surface) {
+      job.layers.clear();
+      return;
+    }
+
+    auto &layer{job.layers.emplace_back(std::move(job.surface))};
+    auto const &first{*job.layers.front()};
+    auto const size{job.layerSize == glm::ivec2{} ? glm::ivec2{first.w, first.h}
+                                                  : job.layerSize};
+
+    if (auto const pixelFormat{first.format->format};
+        layer->format->format != pixelFormat) {
+      layer.reset(SDL_ConvertSurfaceFormat(layer.get(), pixelFormat, 0));
+      if (!layer) {
+        job.error = fmt::format("Failed to convert texture file {}", path);
+        job.layers.clear();
+        return;
+      }
+    }
+
+    if (layer->w != size.x || layer->h != size.y) {
+      layer.reset(resize(*layer, size.x, size.y));
+      if (!layer) {
+        job.error = fmt::format("Failed to resize texture file {}", path);
+        job.layers.clear();
+        return;
+      }
+    }
+  }
+}
+
+// Leaves the layers ready to be uploaded as they are. As in
+// abcg::createOpenGLTextureArray, all layers are decompressed if any of them
+// cannot be uploaded as it is
+void abcg::OpenGLTextureLoader::decodeKTX2Array(Job &job) const {
+  try {
+    for (auto const &path : job.layerPaths) {
+      auto const &image{job.layerImages.emplace_back(readKTX2(path))};
+      auto const &first{job.layerImages.front()};
+      if (image.levels.empty() || image.size != first.size ||
+          image.sRGB != first.sRGB ||
+          (job.layerSize != glm::ivec2{} && image.size != job.layerSize)) {
+        throw abcg::RuntimeError(fmt::format(
+            "KTX2 texture file {} does not match the other layers", path));
+      }
+    }
+
+    auto const &first{job.layerImages.front()};
+    if (std::ranges::any_of(job.layerImages, [&](auto const &image) {
+          return image.format != first.format ||
+                 image.bottomUp != job.flipUpsideDown ||
+                 !isFormatSupported(image, job.sRGBToLinear);
+        })) {
+      for (auto &image : job.layerImages) {
+        image = decompressKTX2(image);
+        if (image.bottomUp != job.flipUpsideDown) {
+          flipVertically(image);
+        }
+      }
+    }
+  } catch (std::exception const &exception) {
+    job.error = exception.what();
+    job.layerImages.clear();
+  }
+}
+
+// Whether the image can be uploaded without decompression. Uses the support
+// queried by create, as the worker threads have no OpenGL context
+bool abcg::OpenGLTextureLoader::isFormatSupported(KTX2Image const &image,
+                                                  bool sRGBToLinear) const {
+  if (image.format == KTX2Format::RGBA8)
+    return true;
+  auto const sRGB{image.sRGB || sRGBToLinear};
+  return m_compressedFormats.at((image.format == KTX2Format::BC1 ? 0U : 2U) +
+                                (sRGB ? 1U : 0U));
+}
+
+std::size_t abcg::OpenGLTextureLoader::upload(Job const &job) {
+  auto &entry{m_entries.at(job.index)};
+  if (entry.status != Status::Pending || entry.generation != job.generation)
+    return 0;
+
+  if (job.image) {
+    auto const &image{*job.image};
+    auto createInfo{entry.createInfo};
+    createInfo.flipUpsideDown = image.bottomUp;
+    entry.texture = createOpenGLTexture(image, createInfo);
+    entry.status = Status::Ready;
+    std::size_t bytes{};
+    for (auto const &level : image.levels) {
+      bytes += level.size();
+    }
+    return bytes;
+  }
+
+  if (!job.layerImages.empty()) {
+    auto createInfo{*entry.arrayCreateInfo};
+    createInfo.flipUpsideDown = job.layerImages.front().bottomUp;
+    entry.texture = createOpenGLTextureArray(job.layerImages, createInfo);
+    entry.status = Status::Ready;
+    std::size_t bytes{};
+    for (auto const &image : job.layerImages) {
+      for (auto const &level : image.levels) {
+        bytes += level.size();
+      }
+    }
+    return bytes;
+  }
+
+  if (!job.layers.empty()) {
+    std::vector<SDL_Surface *> layers;
+    std::size_t bytes{};
+    for (auto const &layer : job.layers) {
+      layers.push_back(layer.get());
+      bytes += gsl::narrow<std::size_t>(layer->pitch) *
+               gsl::narrow<std::size_t>(layer->h);
+    }
+    entry.texture = createOpenGLTextureArray(layers, *entry.arrayCreateInfo);
+    entry.status = Status::Ready;
+    return bytes;
+  }
+
+  if (!job.surface) {
+    fmt::print(stderr, "{}\n", toRedString(job.error));
+    entry.status = Status::Failed;
+    return 0;
+  }
+
+  entry.texture = createOpenGLTexture(*job.surface, entry.createInfo);
+  entry.status = Status::Ready;
+  return gsl::narrow<std::size_t>(job.surface->pitch) *
+         gsl::narrow<std::size_t>(job.surface->h);
+}
+
+void abcg::OpenGLTextureLoader::workerLoop() {
+  Profiler::setThreadName("Texture loader");
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock{m_mutex};
+      m_jobAdded.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+      if (m_stopping)
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    decode(job);
+
+    {
+      std::scoped_lock lock{m_mutex};
+      m_decoded.push_back(std::move(job));
+    }
+
+    // Wake up the main loop if it is waiting for events
+    if (m_wakeEventType != 0) {
+      SDL_Event event{};
+      event.type = m_wakeEventType;
+      SDL_PushEvent(&event);
+    }
+  }
+}
+
+void abcg::OpenGLTextureLoader::stopWorkers() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_jobAdded.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
@@ -0,0 +1,176 @@
+/**
+ * @file abcgOpenGLTextureLoader.hpp
+ * @brief Header file of abcg::OpenGLTextureLoader.
+ *
+ * Declaration of abcg::OpenGLTextureLoader.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_TEXTURE_LOADER_HPP_
+#define ABCG_OPENGL_TEXTURE_LOADER_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLImage.hpp"
+
+namespace abcg {
+class OpenGLTextureLoader;
+} // namespace abcg
+
+/**
+ * @brief Asynchronous loader of 2D textures.
+ *
+ * abcg::OpenGLTextureLoader::load returns a handle immediately. The image is
+ * decoded, converted to RGB/RGBA and flipped by a pool of worker threads, and
+ * the texture is created on the OpenGL thread by
+ * abcg::OpenGLTextureLoader::update. Each call stops uploading once
+ * abcg::OpenGLTextureLoader::getUploadBudget bytes have been uploaded, so at
+ * least one texture is uploaded per call. Until then,
+ * abcg::OpenGLTextureLoader::getTexture returns a 1x1 gray placeholder
+ * texture. When a worker thread finishes decoding an image, it pushes an SDL
+ * event to wake up a window that renders on demand.
+ *
+ * Array textures are loaded the same way: the worker threads decode all
+ * layers and resize them as done by abcg::loadOpenGLTextureArray, or read
+ * them if they are KTX2 files, and the placeholder of an array texture has a
+ * single gray layer.
+ *
+ * KTX2 files are read by the worker threads and their levels are uploaded
+ * without decompression if the format is supported by the context (see
+ * abcg::createOpenGLTexture).
+ *
+ * The loader owns the textures it creates. They are deleted by
+ * abcg::OpenGLTextureLoader::release or abcg::OpenGLTextureLoader::destroy.
+ *
+ * In WebAssembly builds, images are decoded by
+ * abcg::OpenGLTextureLoader::update, within the same budget.
+ *
+ * @sa abcg::OpenGLWindow::getTextureLoader.
+ *
+ * @remark Objects of this type cannot be copied or moved.
+ */
+class abcg::OpenGLTextureLoader {
+public:
+  /** @brief Default value of the upload budget, in bytes per update. */
+  static constexpr std::size_t defaultUploadBudget{8U << 20U};
+
+  /** @brief Loading status of a texture. */
+  enum class Status {
+    /** @brief The image is being decoded or waiting to be uploaded. */
+    Pending,
+    /** @brief The texture is ready. */
+    Ready,
+    /** @brief The image could not be loaded. The placeholder is kept. */
+    Failed,
+    /** @brief The texture was released or the handle is invalid. */
+    Released
+  };
+
+  /** @brief Handle to a texture requested with
+   * abcg::OpenGLTextureLoader::load. */
+  struct Handle {
+    /** @brief Index of the texture in the loader. */
+    std::size_t index{std::numeric_limits<std::size_t>::max()};
+  };
+
+  OpenGLTextureLoader() = default;
+  ~OpenGLTextureLoader();
+
+  OpenGLTextureLoader(OpenGLTextureLoader const &) = delete;
+  OpenGLTextureLoader(OpenGLTextureLoader &&) = delete;
+  OpenGLTextureLoader &operator=(OpenGLTextureLoader const &) = delete;
+  OpenGLTextureLoader &operator=(OpenGLTextureLoader &&) = delete;
+
+  void create();
+  void destroy();
+
+  [[nodiscard]] Handle load(OpenGLTextureCreateInfo const &createInfo);
+  [[nodiscard]] Handle load(OpenGLTextureArrayCreateInfo const &createInfo);
+  void release(Handle handle);
+  void update();
+
+  [[nodiscard]] GLuint getTexture(Handle handle) const;
+  [[nodiscard]] Status getStatus(Handle handle) const;
+  [[nodiscard]] bool isIdle() const;
+
+  [[nodiscard]] std::size_t getUploadBudget() const noexcept;
+  void setUploadBudget(std::size_t bytes) noexcept;
+
+private:
+  struct SurfaceDeleter {
+    void operator()(SDL_Surface *surface) const { SDL_FreeSurface(surface); }
+  };
+  using SurfacePtr = std::unique_ptr<SDL_Surface, SurfaceDeleter>;
+
+  struct Entry {
+    GLuint texture{};
+    Status status{Status::Released};
+    std::uint32_t generation{}; // Tells apart reuses of the entry
+    OpenGLTextureCreateInfo createInfo; // Without the path
+    // Without the paths. Set only for array textures
+    std::optional<OpenGLTextureArrayCreateInfo> arrayCreateInfo;
+  };
+
+  struct Job {
+    std::size_t index{};
+    std::uint32_t generation{};
+    std::string path;
+    bool flipUpsideDown{};
+    bool sRGBToLinear{};
+    SurfacePtr surface;
+    std::optional<KTX2Image> image; // Read from a KTX2 file
+    std::vector<std::string> layerPaths; // Paths of an array texture
+    glm::ivec2 layerSize{};
+    std::vector<SurfacePtr> layers;
+    std::vector<KTX2Image> layerImages; // Read from KTX2 files
+    std::string error;
+  };
+
+  [[nodiscard]] Handle addEntry(Entry entry, Job job);
+  void decode(Job &job) const;
+  void decodeImage(Job &job) const;
+  void decodeKTX2(Job &job) const;
+  void decodeArray(Job &job) const;
+  void decodeKTX2Array(Job &job) const;
+  [[nodiscard]] bool isFormatSupported(KTX2Image const &image,
+                                       bool sRGBToLinear) const;
+  [[nodiscard]] std::size_t upload(Job const &job);
+  void workerLoop();
+  void stopWorkers();
+
+  std::vector<Entry> m_entries;
+  std::vector<std::size_t> m_freeEntries;
+  GLuint m_placeholder{};
+  GLuint m_arrayPlaceholder{}; // Same as m_placeholder, with one layer
+  std::size_t m_uploadBudget{defaultUploadBudget};
+  Uint32 m_wakeEventType{};
+  std::size_t m_inFlight{}; // Requests not yet uploaded nor discarded
+  // Support of BC1, BC1 sRGB, ETC2 and ETC2 sRGB, queried by create
+  std::array<bool, 4> m_compressedFormats{};
+
+  // Shared with the worker threads
+  std::mutex m_mutex;
+  std::condition_variable m_jobAdded;
+  std::deque<Job> m_jobs;
+  std::deque<Job> m_decoded;
+  bool m_stopping{};
+  std::vector<std::thread> m_workers;
+};
+
+#endif
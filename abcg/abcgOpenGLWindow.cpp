@@ -15,10 +15,44 @@
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl2.h>
 
+#if defined(ABCG_HEADLESS_EGL)
+#if !defined(EGL_NO_X11)
+#define EGL_NO_X11
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgOpenGLShader.hpp"
+#include "abcgProfiler.hpp"
 #include "abcgWindow.hpp"
 
+namespace {
+// Creates a single-sampled RGBA render target, or resizes an existing one
+void createColorTarget(GLuint &framebuffer, GLuint &renderbuffer,
+                       glm::ivec2 const &size) {
+  if (renderbuffer == 0) {
+    abcg::glGenRenderbuffers(1, &renderbuffer);
+  }
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  abcg::glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  if (framebuffer == 0) {
+    abcg::glGenFramebuffers(1, &framebuffer);
+    abcg::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    abcg::glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                    GL_RENDERBUFFER, renderbuffer);
+    if (abcg::glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+      throw abcg::RuntimeError("Recording framebuffer is incomplete");
+    }
+  }
+}
+} // namespace
+
 /**
  * @brief Returns the configuration settings of the OpenGL context.
  *
@@ -44,36 +78,147 @@ void abcg::OpenGLWindow::setOpenGLSettings(
   m_openGLSettings = openGLSettings;
 }
 
+/**
+ * @brief Returns the GPU profiler of the window.
+ *
+ * The profiler is enabled only if abcg::OpenGLSettings::showGPUProfiler is
+ * `true` and timer queries are supported. The time spent in
+ * abcg::OpenGLWindow::onPaint and in the rendering of the UI is always
+ * profiled. Use abcg::OpenGLProfilerScope inside abcg::OpenGLWindow::onPaint
+ * to break it down into passes.
+ *
+ * @returns Reference to the abcg::OpenGLProfiler object.
+ */
+abcg::OpenGLProfiler &abcg::OpenGLWindow::getGPUProfiler() noexcept {
+  return m_GPUProfiler;
+}
+
+/**
+ * @brief Returns the asynchronous texture loader of the window.
+ *
+ * Textures requested with abcg::OpenGLTextureLoader::load are decoded on
+ * worker threads and uploaded by the window at the beginning of each frame,
+ * before abcg::OpenGLWindow::onPaint. They are deleted after
+ * abcg::OpenGLWindow::onDestroy.
+ *
+ * @returns Reference to the abcg::OpenGLTextureLoader object.
+ */
+abcg::OpenGLTextureLoader &abcg::OpenGLWindow::getTextureLoader() noexcept {
+  return m_textureLoader;
+}
+
 /**
  * @brief Takes a snapshot of the screen and saves it to a file.
  *
+ * The pixels are read back asynchronously through abcg::OpenGLFrameCapture
+ * and the file is encoded and written by a worker thread, so this returns
+ * without waiting for the GPU. All pending screenshots are written before the
+ * window is destroyed.
+ *
  * @param filename String view to the filename.
  */
 void abcg::OpenGLWindow::saveScreenshotPNG(std::string_view filename) const {
-  auto const size{getWindowSize()};
-  auto const bitsPerPixel{8};
-  auto const channels{4};
-  auto const pitch{gsl::narrow<long>(size.x * channels)};
+  bindReadBuffer();
+  m_frameCapture.readPixels(
+      getWindowSize(), [filename = std::string{filename}](auto const &frame) {
+        OpenGLFrameCapture::savePNG(frame, filename);
+      });
+}
 
-  auto const numPixels{gsl::narrow<std::size_t>(size.x * size.y * channels)};
-  std::vector<unsigned char> pixels(numPixels);
-  glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
-  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+/**
+ * @brief Starts capturing every rendered frame to a sequence of PNG files.
+ *
+ * Each frame is captured after the UI is rendered and before the buffers are
+ * swapped, and is saved to a file named after @a prefix followed by a
+ * five-digit frame number and the `.png` extension (e.g., `frame_00000.png`).
+ *
+ * @param prefix Prefix of the filenames, possibly including a directory.
+ *
+ * @sa abcg::OpenGLWindow::stopFrameCapture.
+ */
+void abcg::OpenGLWindow::startFrameCapture(std::string_view prefix) {
+  m_frameCapturePrefix = prefix;
+  m_capturedFrames = 0;
+  m_capturingFrames = true;
+}
 
-  // Flip upside down
-  for (auto const line : iter::range(size.y / 2)) {
-    std::swap_ranges(pixels.begin() + pitch * line,
-                     pixels.begin() + pitch * (line + 1),
-                     pixels.begin() + pitch * (size.y - line - 1));
-  }
+/**
+ * @brief Stops the capture started by abcg::OpenGLWindow::startFrameCapture.
+ *
+ * Frames already captured are still written to their files.
+ */
+void abcg::OpenGLWindow::stopFrameCapture() noexcept {
+  m_capturingFrames = false;
+}
 
-  if (auto *const surface{SDL_CreateRGBSurfaceFrom(
-          pixels.data(), size.x, size.y, channels * bitsPerPixel,
-          gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
-          0xFF000000)}) {
-    IMG_SavePNG(surface, filename.data());
-    SDL_FreeSurface(surface);
-  }
+/**
+ * @brief Returns whether every frame is being captured.
+ */
+bool abcg::OpenGLWindow::isCapturingFrames() const noexcept {
+  return m_capturingFrames;
+}
+
+/**
+ * @brief Starts recording every rendered frame to a video file.
+ *
+ * Frames are captured after the UI is rendered, scaled on the GPU to the
+ * video size, and read back asynchronously through abcg::OpenGLFrameCapture.
+ * The conversion to the output format runs on the worker threads of the
+ * capture, and the frames are written in order by the writer thread of an
+ * abcg::VideoWriter. The render thread only issues the blit and the readback.
+ *
+ * While recording, repaints are requested continuously, so that
+ * abcg::WindowSettings::renderOnDemand does not pause the video.
+ *
+ * @param recordingSettings Recording settings.
+ *
+ * @throw abcg::RuntimeError if the file cannot be created.
+ *
+ * @sa abcg::OpenGLWindow::stopRecording.
+ */
+void abcg::OpenGLWindow::startRecording(
+    RecordingSettings const &recordingSettings) {
+  stopRecording();
+
+  auto const size{glm::vec2{getWindowSize()} * recordingSettings.scale};
+  auto const videoSize{glm::max(glm::ivec2{size} / 2 * 2, glm::ivec2{2})};
+  m_recording.writer.open(recordingSettings.filename, recordingSettings.format,
+                          videoSize, recordingSettings.frameRate);
+  createColorTarget(m_recording.framebuffer, m_recording.renderbuffers.at(0),
+                    videoSize);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_openGLSettings.headless
+                                        ? m_headless.framebuffer
+                                        : 0);
+}
+
+/**
+ * @brief Stops the recording started by abcg::OpenGLWindow::startRecording.
+ *
+ * Waits until all recorded frames are written and closes the file.
+ */
+void abcg::OpenGLWindow::stopRecording() {
+  if (!m_recording.writer.isOpen())
+    return;
+
+  // Frames still in the readback ring can only be resolved from here
+  m_frameCapture.flush();
+  m_recording.writer.close();
+
+  glDeleteFramebuffers(1, &m_recording.framebuffer);
+  glDeleteFramebuffers(1, &m_recording.resolveFramebuffer);
+  glDeleteRenderbuffers(gsl::narrow<GLsizei>(m_recording.renderbuffers.size()),
+                        m_recording.renderbuffers.data());
+  m_recording.framebuffer = 0;
+  m_recording.resolveFramebuffer = 0;
+  m_recording.renderbuffers = {};
+  m_recording.resolveSize = {};
+}
+
+/**
+ * @brief Returns whether a video is being recorded.
+ */
+bool abcg::OpenGLWindow::isRecording() const noexcept {
+  return m_recording.writer.isOpen();
 }
 
 /**
@@ -126,8 +271,10 @@ void abcg::OpenGLWindow::onPaint() {
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
- * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
+ * abcg::WindowSettings::showFPS is set to `true`, a toggle fullscreen
+ * button if abcg::WindowSettings::showFullscreenButton is set to `true`, and
+ * the GPU times of the profiled scopes if
+ * abcg::OpenGLSettings::showGPUProfiler is set to `true`.
  */
 void abcg::OpenGLWindow::onPaintUI() {
   // FPS counter
@@ -159,6 +306,23 @@ void abcg::OpenGLWindow::onPaintUI() {
     ImGui::End();
   }
 
+  // GPU profiler
+  if (m_GPUProfiler.isSupported()) {
+    auto const windowSize{getWindowSize()};
+    ImGui::SetNextWindowPos(ImVec2(gsl::narrow<float>(windowSize.x) - 5, 5),
+                            ImGuiCond_Always, ImVec2(1, 0));
+    ImGui::Begin("GPU", nullptr,
+                 ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                     ImGuiWindowFlags_NoBringToFrontOnFocus |
+                     ImGuiWindowFlags_NoFocusOnAppearing |
+                     ImGuiWindowFlags_AlwaysAutoResize);
+    for (auto const &timing : m_GPUProfiler.getTimings()) {
+      ImGui::Text("%*s%-12s %6.3f ms", timing.depth * 2, "",
+                  timing.name.c_str(), timing.milliseconds);
+    }
+    ImGui::End();
+  }
+
   // Fullscreen button
   if (abcg::Window::getWindowSettings().showFullscreenButton) {
 #if defined(__EMSCRIPTEN__)
@@ -317,59 +481,12 @@ void abcg::OpenGLWindow::create() {
     break;
   }
 
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, majorVersion);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minorVersion);
-  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER,
-                      m_openGLSettings.doubleBuffering ? 1 : 0);
-  SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, m_openGLSettings.depthBufferSize);
-  SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, m_openGLSettings.stencilBufferSize);
-
-  if (m_openGLSettings.samples > 0) {
-    // Enable multisampling
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    // Can be 2, 4, 8 or 16
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, m_openGLSettings.samples);
+  if (m_openGLSettings.headless) {
+    createHeadlessContext();
   } else {
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
-  }
-
-  // Create window with graphics context
-  while (true) {
-    if (!createSDLWindow(SDL_WINDOW_OPENGL) && m_openGLSettings.samples > 0) {
-      // Try again, but this time with multisampling disabled
-      m_openGLSettings.samples = 0;
-      SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
-      SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
-      fmt::print("Warning: multisampling requested but not supported!\n");
-    } else {
-      break;
-    }
-  }
-
-  if (abcg::Window::getSDLWindow() == nullptr) {
-    throw abcg::SDLError("SDL_CreateWindow failed");
-  }
-
-  // Create OpenGL context
-  m_GLContext = SDL_GL_CreateContext(abcg::Window::getSDLWindow());
-  if (m_GLContext == nullptr) {
-    throw abcg::SDLError("SDL_GL_CreateContext failed");
+    createSDLContext();
   }
 
-#if !defined(__EMSCRIPTEN__)
-  SDL_GL_SetSwapInterval(m_openGLSettings.vSync ? 1 : 0);
-#endif
-
-#if !defined(__EMSCRIPTEN__)
-  if (auto const err{glewInit()}; GLEW_OK != err) {
-    throw abcg::Exception{
-        fmt::format("Failed to initialize OpenGL loader: {}",
-                    reinterpret_cast<char const *>(glewGetErrorString(err)))};
-  }
-  fmt::print("Using GLEW.....: {}\n",
-             reinterpret_cast<char const *>(glewGetString(GLEW_VERSION)));
-#endif
-
   fmt::print("OpenGL vendor..: {}\n",
              reinterpret_cast<char const *>(glGetString(GL_VENDOR)));
   fmt::print("OpenGL renderer: {}\n",
@@ -404,7 +521,9 @@ void abcg::OpenGLWindow::create() {
   guiIO.IniFilename = nullptr;
 
   // Setup platform/renderer bindings
-  ImGui_ImplSDL2_InitForOpenGL(abcg::Window::getSDLWindow(), m_GLContext);
+  if (!m_openGLSettings.headless) {
+    ImGui_ImplSDL2_InitForOpenGL(abcg::Window::getSDLWindow(), m_GLContext);
+  }
   ImGui_ImplOpenGL3_Init(m_GLSLVersion.c_str());
 
   // Load fonts
@@ -419,18 +538,97 @@ void abcg::OpenGLWindow::create() {
     throw abcg::RuntimeError("Failed to load font file");
   }
 
+  m_frameCapture.create();
+  m_textureLoader.create();
+  if (!m_openGLSettings.programCacheDirectory.empty()) {
+    setOpenGLProgramCacheDirectory(m_openGLSettings.programCacheDirectory);
+  }
+
+  if (m_openGLSettings.showGPUProfiler) {
+    m_GPUProfiler.create();
+    if (!m_GPUProfiler.isSupported()) {
+      fmt::print("Warning: GPU profiler requested but timer queries are not "
+                 "supported!\n");
+    }
+  }
+
   onCreate();
 
   onResize(getWindowSize());
 }
 
+void abcg::OpenGLWindow::createSDLContext() {
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION,
+                      m_openGLSettings.majorVersion);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION,
+                      m_openGLSettings.minorVersion);
+  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER,
+                      m_openGLSettings.doubleBuffering ? 1 : 0);
+  SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, m_openGLSettings.depthBufferSize);
+  SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, m_openGLSettings.stencilBufferSize);
+
+  if (m_openGLSettings.samples > 0) {
+    // Enable multisampling
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+    // Can be 2, 4, 8 or 16
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, m_openGLSettings.samples);
+  } else {
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+  }
+
+  // Create window with graphics context
+  while (true) {
+    if (!createSDLWindow(SDL_WINDOW_OPENGL) && m_openGLSettings.samples > 0) {
+      // Try again, but this time with multisampling disabled
+      m_openGLSettings.samples = 0;
+      SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
+      SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+      fmt::print("Warning: multisampling requested but not supported!\n");
+    } else {
+      break;
+    }
+  }
+
+  if (abcg::Window::getSDLWindow() == nullptr) {
+    throw abcg::SDLError("SDL_CreateWindow failed");
+  }
+
+  // Create OpenGL context
+  m_GLContext = SDL_GL_CreateContext(abcg::Window::getSDLWindow());
+  if (m_GLContext == nullptr) {
+    throw abcg::SDLError("SDL_GL_CreateContext failed");
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  SDL_GL_SetSwapInterval(m_openGLSettings.vSync ? 1 : 0);
+#endif
+
+#if !defined(__EMSCRIPTEN__)
+  if (auto const err{glewInit()}; GLEW_OK != err) {
+    throw abcg::Exception{
+        fmt::format("Failed to initialize OpenGL loader: {}",
+                    reinterpret_cast<char const *>(glewGetErrorString(err)))};
+  }
+  fmt::print("Using GLEW.....: {}\n",
+             reinterpret_cast<char const *>(glewGetString(GLEW_VERSION)));
+#endif
+}
+
 void abcg::OpenGLWindow::paint() {
-  onUpdate();
+  {
+    ProfilerZone zone{"onUpdate"};
+    onUpdate();
+  }
 
   if (m_hidden || m_minimized)
     return;
 
-  SDL_GL_MakeCurrent(abcg::Window::getSDLWindow(), m_GLContext);
+  if (!m_openGLSettings.headless) {
+    SDL_GL_MakeCurrent(abcg::Window::getSDLWindow(), m_GLContext);
+  }
+
+  m_frameCapture.poll();
+  m_textureLoader.update();
 
 #if defined(__EMSCRIPTEN__)
   // Force window size in windowed mode
@@ -443,18 +641,67 @@ void abcg::OpenGLWindow::paint() {
   }
 #endif
 
-  ImGui_ImplOpenGL3_NewFrame();
-  ImGui_ImplSDL2_NewFrame();
-  ImGui::NewFrame();
+  {
+    ProfilerZone zone{"onPaintUI"};
+    ImGui_ImplOpenGL3_NewFrame();
+    if (m_openGLSettings.headless) {
+      // There is no platform backend to fill these in
+      auto &guiIO{ImGui::GetIO()};
+      auto const size{getWindowSize()};
+      guiIO.DisplaySize = ImVec2(gsl::narrow<float>(size.x),
+                                 gsl::narrow<float>(size.y));
+      guiIO.DeltaTime = gsl::narrow_cast<float>(getDeltaTime());
+    } else {
+      ImGui_ImplSDL2_NewFrame();
+    }
+    ImGui::NewFrame();
+
+    onPaintUI();
 
-  onPaintUI();
+    ImGui::Render();
+  }
+
+  m_GPUProfiler.beginFrame();
 
-  ImGui::Render();
+  if (m_openGLSettings.headless) {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_headless.framebuffer);
+  }
 
-  onPaint();
+  {
+    ProfilerZone zone{"onPaint"};
+    OpenGLProfilerScope scope{m_GPUProfiler, "onPaint"};
+    onPaint();
+  }
 
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  if (m_openGLSettings.doubleBuffering) {
+  {
+    ProfilerZone zone{"ImGui draw"};
+    OpenGLProfilerScope scope{m_GPUProfiler, "ImGui"};
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  }
+
+  // Resolve the multisampled target so that it can be read back
+  if (m_openGLSettings.headless && m_headless.resolveFramebuffer != 0) {
+    auto const size{getWindowSize()};
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_headless.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_headless.resolveFramebuffer);
+    glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_headless.framebuffer);
+  }
+
+  if (m_capturingFrames) {
+    saveScreenshotPNG(
+        fmt::format("{}{:05}.png", m_frameCapturePrefix, m_capturedFrames++));
+  }
+
+  if (m_recording.writer.isOpen()) {
+    recordFrame();
+  }
+
+  ProfilerZone zone{"Swap"};
+  if (m_openGLSettings.headless) {
+    glFlush();
+  } else if (m_openGLSettings.doubleBuffering) {
     SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
   } else {
     glFinish();
@@ -464,21 +711,254 @@ void abcg::OpenGLWindow::paint() {
 void abcg::OpenGLWindow::destroy() {
   onDestroy();
 
+  if (m_GLContext != nullptr || m_headless.context != nullptr) {
+    m_GPUProfiler.destroy();
+    stopRecording();
+    m_frameCapture.destroy();
+    m_textureLoader.destroy();
+    destroyOpenGLSamplers();
+  }
+
   if (ImGui::GetCurrentContext() != nullptr) {
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
+    if (!m_openGLSettings.headless) {
+      ImGui_ImplSDL2_Shutdown();
+    }
     ImGui::DestroyContext();
   }
   if (m_GLContext != nullptr) {
     SDL_GL_DeleteContext(m_GLContext);
     m_GLContext = nullptr;
   }
+  destroyHeadlessContext();
 }
 
 [[nodiscard]] glm::ivec2 abcg::OpenGLWindow::getWindowSize() const {
+  if (m_openGLSettings.headless) {
+    auto const &windowSettings{abcg::Window::getWindowSettings()};
+    return {windowSettings.width, windowSettings.height};
+  }
+
   glm::ivec2 size{};
   if (auto *window{abcg::Window::getSDLWindow()}; window != nullptr) {
     SDL_GL_GetDrawableSize(window, &size.x, &size.y);
   }
   return size;
 }
+
+bool abcg::OpenGLWindow::isHeadless() const noexcept {
+  return m_openGLSettings.headless;
+}
+
+void abcg::OpenGLWindow::bindReadBuffer() const {
+  if (m_openGLSettings.headless) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_headless.resolveFramebuffer != 0
+                                               ? m_headless.resolveFramebuffer
+                                               : m_headless.framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  } else {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
+  }
+}
+
+void abcg::OpenGLWindow::recordFrame() {
+  ProfilerZone zone{"Record frame"};
+  requestRepaint();
+
+  auto const size{getWindowSize()};
+  auto const videoSize{m_recording.writer.getSize()};
+  bindReadBuffer();
+  if (size != videoSize) {
+    // A multisampled framebuffer can only be blitted without scaling, so it
+    // is resolved first
+    if (!m_openGLSettings.headless && m_openGLSettings.samples > 0) {
+      if (m_recording.resolveSize != size) {
+        createColorTarget(m_recording.resolveFramebuffer,
+                          m_recording.renderbuffers.at(1), size);
+        m_recording.resolveSize = size;
+      }
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_recording.resolveFramebuffer);
+      glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y,
+                        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, m_recording.resolveFramebuffer);
+      glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_recording.framebuffer);
+    glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, videoSize.x, videoSize.y,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_recording.framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_openGLSettings.headless
+                                               ? m_headless.framebuffer
+                                               : 0);
+  }
+
+  m_frameCapture.readPixels(
+      videoSize, [&writer = m_recording.writer,
+                  sequence = m_recording.writer.reserveFrame()](
+                     OpenGLFrameCapture::Frame const &frame) {
+        if (frame.pixels.empty()) {
+          writer.skip(sequence);
+        } else {
+          writer.write(sequence, frame.size, frame.pixels);
+        }
+      });
+  glBindFramebuffer(GL_READ_FRAMEBUFFER,
+                    m_openGLSettings.headless ? m_headless.framebuffer : 0);
+}
+
+void abcg::OpenGLWindow::createHeadlessContext() {
+#if defined(ABCG_HEADLESS_EGL)
+  // Prefer Mesa's surfaceless platform, which needs neither a display server
+  // nor a GPU device node
+  EGLDisplay display{EGL_NO_DISPLAY};
+  if (auto const getPlatformDisplay{
+          reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+              eglGetProcAddress("eglGetPlatformDisplayEXT"))};
+      getPlatformDisplay != nullptr) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                 EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY ||
+      eglInitialize(display, nullptr, nullptr) == EGL_FALSE) {
+    throw abcg::RuntimeError("Failed to initialize EGL display");
+  }
+  m_headless.display = display;
+
+  auto const isES{m_openGLSettings.profile == OpenGLProfile::ES};
+  if (eglBindAPI(isES ? EGL_OPENGL_ES_API : EGL_OPENGL_API) == EGL_FALSE) {
+    throw abcg::RuntimeError("eglBindAPI failed");
+  }
+
+  // The surfaceless platform only exposes pbuffer configs
+  std::array const configAttributes{
+      EGLint{EGL_SURFACE_TYPE}, EGLint{EGL_PBUFFER_BIT},
+      EGLint{EGL_RENDERABLE_TYPE},
+      EGLint{isES ? EGL_OPENGL_ES3_BIT : EGL_OPENGL_BIT}, EGLint{EGL_NONE}};
+  EGLConfig config{};
+  EGLint numConfigs{};
+  if (eglChooseConfig(display, configAttributes.data(), &config, 1,
+                      &numConfigs) == EGL_FALSE ||
+      numConfigs == 0) {
+    throw abcg::RuntimeError("eglChooseConfig failed");
+  }
+
+  std::vector<EGLint> contextAttributes{
+      EGL_CONTEXT_MAJOR_VERSION, m_openGLSettings.majorVersion,
+      EGL_CONTEXT_MINOR_VERSION, m_openGLSettings.minorVersion};
+  if (!isES) {
+    auto const isCore{m_openGLSettings.profile == OpenGLProfile::Core};
+    contextAttributes.insert(
+        contextAttributes.end(),
+        {EGL_CONTEXT_OPENGL_PROFILE_MASK,
+         isCore ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT
+                : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+         EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE,
+         isCore ? EGL_TRUE : EGL_FALSE});
+  }
+  contextAttributes.push_back(EGL_NONE);
+
+  m_headless.context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                                        contextAttributes.data());
+  if (m_headless.context == EGL_NO_CONTEXT) {
+    throw abcg::RuntimeError("eglCreateContext failed");
+  }
+
+  // Requires EGL_KHR_surfaceless_context
+  if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                     m_headless.context) == EGL_FALSE) {
+    throw abcg::RuntimeError("eglMakeCurrent failed");
+  }
+
+  // glewInit also looks for a GLX or WGL display, which does not exist here
+  glewExperimental = GL_TRUE;
+  if (auto const err{glewContextInit()}; GLEW_OK != err) {
+    throw abcg::Exception{
+        fmt::format("Failed to initialize OpenGL loader: {}",
+                    reinterpret_cast<char const *>(glewGetErrorString(err)))};
+  }
+  fmt::print("Using GLEW.....: {}\n",
+             reinterpret_cast<char const *>(glewGetString(GLEW_VERSION)));
+
+  createHeadlessFramebuffer();
+#else
+  throw abcg::RuntimeError("Headless rendering is not supported in this build");
+#endif
+}
+
+// Creates the framebuffer object that replaces the default framebuffer
+void abcg::OpenGLWindow::createHeadlessFramebuffer() {
+  auto const size{getWindowSize()};
+  auto const samples{std::max(m_openGLSettings.samples, 0)};
+  GLenum const depthFormat{m_openGLSettings.stencilBufferSize > 0
+                               ? GLenum{GL_DEPTH24_STENCIL8}
+                               : GLenum{GL_DEPTH_COMPONENT24}};
+  GLenum const depthAttachment{m_openGLSettings.stencilBufferSize > 0
+                                   ? GLenum{GL_DEPTH_STENCIL_ATTACHMENT}
+                                   : GLenum{GL_DEPTH_ATTACHMENT}};
+
+  auto &[colorRenderbuffer, depthRenderbuffer,
+         resolveRenderbuffer]{m_headless.renderbuffers};
+  glGenRenderbuffers(samples > 0 ? 3 : 2, m_headless.renderbuffers.data());
+
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, size.x,
+                                   size.y);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, depthFormat,
+                                   size.x, size.y);
+
+  glGenFramebuffers(1, &m_headless.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_headless.framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorRenderbuffer);
+  if (m_openGLSettings.depthBufferSize > 0 ||
+      m_openGLSettings.stencilBufferSize > 0) {
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, depthAttachment, GL_RENDERBUFFER,
+                              depthRenderbuffer);
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw abcg::RuntimeError("Headless framebuffer is incomplete");
+  }
+
+  // Single-sampled copy of the color buffer, used for reading back pixels
+  if (samples > 0) {
+    glBindRenderbuffer(GL_RENDERBUFFER, resolveRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+    glGenFramebuffers(1, &m_headless.resolveFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_headless.resolveFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, resolveRenderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw abcg::RuntimeError("Headless resolve framebuffer is incomplete");
+    }
+  }
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_headless.framebuffer);
+  glViewport(0, 0, size.x, size.y);
+}
+
+void abcg::OpenGLWindow::destroyHeadlessContext() {
+#if defined(ABCG_HEADLESS_EGL)
+  if (m_headless.context != nullptr) {
+    glDeleteFramebuffers(1, &m_headless.resolveFramebuffer);
+    glDeleteFramebuffers(1, &m_headless.framebuffer);
+    glDeleteRenderbuffers(gsl::narrow<GLsizei>(m_headless.renderbuffers.size()),
+                          m_headless.renderbuffers.data());
+    eglMakeCurrent(m_headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    eglDestroyContext(m_headless.display, m_headless.context);
+  }
+  if (m_headless.display != nullptr) {
+    eglTerminate(m_headless.display);
+  }
+#endif
+  m_headless = {};
+}
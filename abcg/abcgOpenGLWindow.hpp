@@ -13,16 +13,22 @@
 #ifndef ABCG_OPENGL_WINDOW_HPP_
 #define ABCG_OPENGL_WINDOW_HPP_
 
+#include <array>
 #include <string>
 
 #include "abcgExternal.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLProfiler.hpp"
+#include "abcgOpenGLTextureLoader.hpp"
+#include "abcgVideoWriter.hpp"
 #include "abcgWindow.hpp"
 
 namespace abcg {
 enum class OpenGLProfile;
 class OpenGLWindow;
 struct OpenGLSettings;
+struct RecordingSettings;
 } // namespace abcg
 
 /**
@@ -77,6 +83,56 @@ struct abcg::OpenGLSettings {
   bool vSync{false};
   /** @brief Whether the output is double buffered. */
   bool doubleBuffering{true};
+  /** @brief Whether to show an overlay window with the GPU time of each
+   * profiled scope.
+   *
+   * Requires timer queries, which are not available in WebGL 2.0.
+   *
+   * @sa abcg::OpenGLWindow::getGPUProfiler.
+   */
+  bool showGPUProfiler{false};
+  /** @brief Whether to render offscreen, without creating a window.
+   *
+   * If `true`, the OpenGL context is created through EGL without a surface
+   * (e.g., with Mesa's llvmpipe on a machine with no display), and the scene
+   * is rendered into a framebuffer object of size abcg::WindowSettings::width
+   * x abcg::WindowSettings::height. The window receives no events and uses a
+   * fixed delta time. Use the second argument of abcg::Application::run to
+   * exit after a given number of frames.
+   *
+   * @remark Only supported on Linux, when ABCg is built with EGL.
+   */
+  bool headless{false};
+  /** @brief Directory of the cache of program binaries, or empty to disable
+   * the cache.
+   *
+   * If not empty, it is passed to abcg::setOpenGLProgramCacheDirectory
+   * before abcg::OpenGLWindow::onCreate, so that programs created by
+   * abcg::createOpenGLProgram are restored from their binaries on later runs.
+   */
+  std::string programCacheDirectory{};
+};
+
+/**
+ * @brief Configuration settings for recording a video.
+ *
+ * @sa abcg::OpenGLWindow::startRecording.
+ */
+struct abcg::RecordingSettings {
+  /** @brief Path to the output file. */
+  std::string filename{"recording.y4m"};
+  /** @brief Format of the output file. */
+  VideoFormat format{VideoFormat::Y4M};
+  /** @brief Scale factor applied to the window size to get the video size.
+   *
+   * The video size is rounded down to even numbers. Frames are scaled on the
+   * GPU with linear filtering before they are read back. */
+  float scale{1.0f};
+  /** @brief Nominal frame rate written to the stream header.
+   *
+   * Every rendered frame is recorded. Use abcg::WindowSettings::maxFrameRate
+   * to render at this rate. */
+  int frameRate{60};
 };
 
 /**
@@ -101,8 +157,17 @@ public:
   [[nodiscard]] OpenGLSettings const &getOpenGLSettings() const noexcept;
   void setOpenGLSettings(OpenGLSettings const &openGLSettings) noexcept;
   void saveScreenshotPNG(std::string_view filename) const;
+  void startFrameCapture(std::string_view prefix);
+  void stopFrameCapture() noexcept;
+  [[nodiscard]] bool isCapturingFrames() const noexcept;
+  void startRecording(RecordingSettings const &recordingSettings);
+  void stopRecording();
+  [[nodiscard]] bool isRecording() const noexcept;
 
 protected:
+  [[nodiscard]] OpenGLProfiler &getGPUProfiler() noexcept;
+  [[nodiscard]] OpenGLTextureLoader &getTextureLoader() noexcept;
+
   virtual void onEvent(SDL_Event const &event);
   virtual void onCreate();
   virtual void onPaint();
@@ -117,10 +182,49 @@ private:
   void paint() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
+  [[nodiscard]] bool isHeadless() const noexcept final;
+
+  void createSDLContext();
+  void createHeadlessContext();
+  void createHeadlessFramebuffer();
+  void destroyHeadlessContext();
+  void bindReadBuffer() const;
+  void recordFrame();
 
   OpenGLSettings m_openGLSettings;
   std::string m_GLSLVersion;
   SDL_GLContext m_GLContext{};
+  OpenGLProfiler m_GPUProfiler;
+  mutable OpenGLFrameCapture m_frameCapture;
+  OpenGLTextureLoader m_textureLoader;
+
+  // Continuous capture started by startFrameCapture
+  std::string m_frameCapturePrefix;
+  std::uint64_t m_capturedFrames{};
+  bool m_capturingFrames{};
+
+  // Video recording started by startRecording. The video size is fixed, so
+  // frames are blitted into the scaled target whenever the window size
+  // differs from it
+  struct Recording {
+    VideoWriter writer;
+    GLuint framebuffer{};
+    GLuint resolveFramebuffer{};
+    std::array<GLuint, 2> renderbuffers{}; // Scaled color, resolved color
+    glm::ivec2 resolveSize{};
+  };
+  Recording m_recording;
+
+  // Offscreen render target used in headless mode. The EGL handles are kept
+  // as opaque pointers so that EGL headers are not exposed
+  struct Headless {
+    void *display{};
+    void *context{};
+    GLuint framebuffer{};
+    GLuint resolveFramebuffer{};
+    std::array<GLuint, 3> renderbuffers{}; // Color, depth, resolved color
+  };
+  Headless m_headless;
   bool m_hidden{};
   bool m_minimized{};
 };
@@ -0,0 +1,259 @@
+/**
+ * @file abcgProfiler.cpp
+ * @brief Definition of abcg::Profiler and abcg::ProfilerZone members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgProfiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "abcgException.hpp"
+
+namespace {
+struct Event {
+  char const *name{};
+  std::int64_t begin{};
+  std::int64_t end{};
+};
+
+// Slot of the ring buffer. The fields are atomic so that writeChromeTrace can
+// read them while the owner thread overwrites them
+struct EventSlot {
+  std::atomic<char const *> name{};
+  std::atomic<std::int64_t> begin{};
+  std::atomic<std::int64_t> end{};
+};
+
+// Written only by its owner thread, as a sequence lock: the total number of
+// events ever written is the sequence counter, and writeChromeTrace discards
+// the events that were overwritten while it was reading them
+struct ThreadBuffer {
+  std::array<EventSlot, abcg::Profiler::bufferCapacity> events{};
+  std::atomic<std::uint64_t> written{};
+  std::uint32_t threadID{};
+  std::string name; // Guarded by the registry mutex
+};
+
+struct Registry {
+  std::mutex mutex; // Guards buffers (not their events)
+  std::vector<ThreadBuffer *> buffers;
+  std::uint32_t nextThreadID{};
+};
+
+std::atomic<bool> profilingEnabled{false};
+auto const epoch{std::chrono::steady_clock::now()};
+
+Registry &getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+// Owns the buffer of a thread and keeps it registered while the thread is
+// alive
+class ThreadBufferOwner {
+public:
+  ThreadBufferOwner() : m_buffer{std::make_unique<ThreadBuffer>()} {
+    auto &registry{getRegistry()};
+    std::scoped_lock lock{registry.mutex};
+    m_buffer->threadID = registry.nextThreadID++;
+    registry.buffers.push_back(m_buffer.get());
+  }
+
+  ~ThreadBufferOwner() {
+    auto &registry{getRegistry()};
+    std::scoped_lock lock{registry.mutex};
+    std::erase(registry.buffers, m_buffer.get());
+  }
+
+  ThreadBufferOwner(ThreadBufferOwner const &) = delete;
+  ThreadBufferOwner(ThreadBufferOwner &&) = delete;
+  ThreadBufferOwner &operator=(ThreadBufferOwner const &) = delete;
+  ThreadBufferOwner &operator=(ThreadBufferOwner &&) = delete;
+
+  [[nodiscard]] ThreadBuffer &get() const noexcept { return *m_buffer; }
+
+private:
+  std::unique_ptr<ThreadBuffer> m_buffer;
+};
+
+// Registers the buffer of the calling thread on first use. The buffer is
+// released when the thread exits
+ThreadBuffer &getThreadBuffer() {
+  thread_local ThreadBufferOwner const owner;
+  return owner.get();
+}
+
+std::string escapeJSON(std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (auto const character : text) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+    }
+    if (static_cast<unsigned char>(character) < 0x20) {
+      escaped += fmt::format("\\u{:04x}", static_cast<int>(character));
+    } else {
+      escaped += character;
+    }
+  }
+  return escaped;
+}
+} // namespace
+
+/**
+ * @brief Enables or disables the recording of zones.
+ *
+ * @param enabled Whether zones are recorded. Zones that are already open when
+ * profiling is disabled are still recorded when they end.
+ */
+void abcg::Profiler::setEnabled(bool enabled) noexcept {
+  profilingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns whether the recording of zones is enabled.
+ */
+bool abcg::Profiler::isEnabled() noexcept {
+  return profilingEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sets the name of the calling thread, as shown in the trace.
+ *
+ * @param name Thread name.
+ */
+void abcg::Profiler::setThreadName(std::string_view name) {
+  auto &buffer{getThreadBuffer()};
+  auto &registry{getRegistry()};
+  std::scoped_lock lock{registry.mutex};
+  buffer.name = name;
+}
+
+/**
+ * @brief Writes the recorded events to a JSON file in the Trace Event Format.
+ *
+ * The events are not cleared. This can be called from any thread, including
+ * while other threads are recording zones. Events of threads that have
+ * exited are not written, as their buffers are released.
+ *
+ * @param filename Path to the output file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
+ */
+void abcg::Profiler::writeChromeTrace(std::string_view filename) {
+  std::ofstream stream{std::string{filename}};
+  if (!stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to open trace file {}", filename));
+  }
+
+  auto &registry{getRegistry()};
+  std::scoped_lock lock{registry.mutex};
+
+  std::vector<Event> events;
+  auto separator{""};
+  stream << "{\"traceEvents\":[";
+  for (auto const &buffer : registry.buffers) {
+    if (!buffer->name.empty()) {
+      stream << separator
+             << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":"
+                            "1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                            buffer->threadID, escapeJSON(buffer->name));
+      separator = ",";
+    }
+
+    // Copy the buffer, then discard whatever the owner thread may have
+    // overwritten during the copy, including the slot it may be writing to.
+    // The acquire fence pairs with the release fence in record, so that any
+    // overwrite seen in the copy is also seen in writtenAfter
+    auto const capacity{std::uint64_t{bufferCapacity}};
+    auto const writtenBefore{buffer->written.load(std::memory_order_acquire)};
+    auto const first{writtenBefore > capacity ? writtenBefore - capacity : 0};
+    events.clear();
+    for (auto index{first}; index < writtenBefore; ++index) {
+      auto const &slot{buffer->events.at(index % capacity)};
+      events.push_back({.name = slot.name.load(std::memory_order_relaxed),
+                        .begin = slot.begin.load(std::memory_order_relaxed),
+                        .end = slot.end.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const writtenAfter{buffer->written.load(std::memory_order_relaxed)};
+    auto const overwritten{writtenAfter + 1 > capacity + first
+                               ? writtenAfter + 1 - capacity - first
+                               : 0};
+
+    for (auto index{std::min<std::uint64_t>(overwritten, events.size())};
+         index < events.size(); ++index) {
+      auto const &event{events.at(index)};
+      stream << separator
+             << fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+                            "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                            escapeJSON(event.name), buffer->threadID,
+                            static_cast<double>(event.begin) / 1e3,
+                            static_cast<double>(event.end - event.begin) /
+                                1e3);
+      separator = ",";
+    }
+  }
+  stream << "],\"displayTimeUnit\":\"ms\"}\n";
+
+  if (!stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to write trace file {}", filename));
+  }
+}
+
+std::int64_t abcg::Profiler::now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void abcg::Profiler::record(char const *name, std::int64_t begin,
+                            std::int64_t end) noexcept {
+  auto &buffer{getThreadBuffer()};
+  auto const written{buffer.written.load(std::memory_order_relaxed)};
+  // Orders the previous update of the counter before the writes to the slot
+  std::atomic_thread_fence(std::memory_order_release);
+  auto &slot{buffer.events[written % bufferCapacity]};
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(begin, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  buffer.written.store(written + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Begins a zone if profiling is enabled.
+ *
+ * @param name Zone name. Must outlive the profiler (e.g., a string literal).
+ */
+abcg::ProfilerZone::ProfilerZone(char const *name) noexcept {
+  if (Profiler::isEnabled()) {
+    m_name = name;
+    m_begin = Profiler::now();
+  }
+}
+
+/**
+ * @brief Ends the zone and records it.
+ */
+abcg::ProfilerZone::~ProfilerZone() {
+  if (m_name != nullptr) {
+    Profiler::record(m_name, m_begin, Profiler::now());
+  }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file abcgProfiler.hpp
+ * @brief Header file of abcg::Profiler and abcg::ProfilerZone.
+ *
+ * Declaration of abcg::Profiler and abcg::ProfilerZone.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROFILER_HPP_
+#define ABCG_PROFILER_HPP_
+
+#include <cstdint>
+#include <string_view>
+
+namespace abcg {
+class Profiler;
+class ProfilerZone;
+} // namespace abcg
+
+/**
+ * @brief CPU profiler of nested time zones.
+ *
+ * Zones are recorded by abcg::ProfilerZone objects into a per-thread ring
+ * buffer of abcg::Profiler::bufferCapacity events. Recording a zone does not
+ * take any lock: each thread only writes to its own buffer. When a buffer is
+ * full, the oldest events are overwritten. The buffer is released when its
+ * thread exits.
+ *
+ * The recorded events can be written at any time to a JSON file in the Trace
+ * Event Format, which can be opened in `chrome://tracing` or in Perfetto
+ * (https://ui.perfetto.dev).
+ *
+ * Profiling is disabled by default. abcg::Window and abcg::OpenGLWindow
+ * record a zone for each phase of the frame.
+ */
+class abcg::Profiler {
+public:
+  /** @brief Maximum number of events kept in the buffer of each thread. */
+  static constexpr std::size_t bufferCapacity{1U << 16U};
+
+  static void setEnabled(bool enabled) noexcept;
+  [[nodiscard]] static bool isEnabled() noexcept;
+
+  static void setThreadName(std::string_view name);
+  static void writeChromeTrace(std::string_view filename);
+
+private:
+  friend class ProfilerZone;
+
+  [[nodiscard]] static std::int64_t now() noexcept;
+  static void record(char const *name, std::int64_t begin,
+                     std::int64_t end) noexcept;
+};
+
+/**
+ * @brief Scope guard that records a zone in abcg::Profiler.
+ *
+ * The zone begins when the object is constructed and ends when it is
+ * destroyed:
+ * @code
+ * void Ground::paint() {
+ *   abcg::ProfilerZone zone{"Ground::paint"};
+ *   // ...
+ * }
+ * @endcode
+ *
+ * @remark The name is stored as a pointer and must outlive the profiler
+ * (e.g., a string literal).
+ * @remark Objects of this type cannot be copied or moved.
+ */
+class abcg::ProfilerZone {
+public:
+  explicit ProfilerZone(char const *name) noexcept;
+  ~ProfilerZone();
+
+  ProfilerZone(ProfilerZone const &) = delete;
+  ProfilerZone(ProfilerZone &&) = delete;
+  ProfilerZone &operator=(ProfilerZone const &) = delete;
+  ProfilerZone &operator=(ProfilerZone &&) = delete;
+
+private:
+  char const *m_name{};
+  std::int64_t m_begin{};
+};
+
+#endif
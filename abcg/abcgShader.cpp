@@ -0,0 +1,78 @@
+/**
+ * @file abcgShader.cpp
+ * @brief Definition of helper functions for building shaders.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgShader.hpp"
+
+namespace {
+// Returns the position right after the line of the #version directive, or 0 if
+// there is no such directive before the first line of code
+[[nodiscard]] std::size_t findVersionEnd(std::string_view source) {
+  std::size_t lineBegin{};
+  while (lineBegin < source.size()) {
+    auto lineEnd{source.find('\n', lineBegin)};
+    lineEnd = lineEnd == std::string_view::npos ? source.size() : lineEnd + 1;
+    auto line{source.substr(lineBegin, lineEnd - lineBegin)};
+
+    auto const trim{[&line] {
+      auto const first{line.find_first_not_of(" \t\r\n")};
+      line.remove_prefix(first == std::string_view::npos ? line.size()
+                                                         : first);
+    }};
+    trim();
+    if (line.starts_with('#')) {
+      line.remove_prefix(1);
+      trim();
+      return line.starts_with("version") ? lineEnd : 0;
+    }
+    // Only blank lines and comments may precede the #version directive
+    if (!line.empty() && !line.starts_with("//")) {
+      return 0;
+    }
+    lineBegin = lineEnd;
+  }
+  return 0;
+}
+} // namespace
+
+/**
+ * @brief Returns a shader source code with preprocessor definitions added.
+ *
+ * Each definition becomes a `#define` directive. The directives are inserted
+ * right after the `#version` directive, which must remain the first directive
+ * of the shader, or at the beginning of the source code if there is no
+ * `#version` directive.
+ *
+ * @param source Shader source code.
+ * @param defines Definitions, each one with a macro name optionally followed
+ * by a space and its replacement text (e.g., `"INSTANCED"` or
+ * `"NUM_LIGHTS 4"`).
+ *
+ * @return Source code with the definitions.
+ */
+std::string abcg::addShaderDefines(std::string_view source,
+                                   std::span<std::string const> defines) {
+  if (defines.empty()) {
+    return std::string{source};
+  }
+
+  auto const position{findVersionEnd(source)};
+  std::string result{source.substr(0, position)};
+  // The #version line may be the last one, without a line break
+  if (!result.empty() && !result.ends_with('\n')) {
+    result += '\n';
+  }
+  for (auto const &define : defines) {
+    result += "#define ";
+    result += define;
+    result += '\n';
+  }
+  result += source.substr(position);
+  return result;
+}
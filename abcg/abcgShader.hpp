@@ -2,6 +2,9 @@
  * @file abcgShader.hpp
  * @brief Declaration of a structure for building shaders.
  *
+ * Declaration of abcg::ShaderSource, abcg::ShaderStage and
+ * abcg::addShaderDefines.
+ *
  * This file is part of ABCg (https://github.com/hbatagelo/abcg).
  *
  * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
@@ -12,11 +15,18 @@
 #define ABCG_SHADER_HPP_
 
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace abcg {
 struct ShaderSource;
 enum class ShaderStage;
+
+[[nodiscard]] std::string
+addShaderDefines(std::string_view source,
+                 std::span<std::string const> defines);
 } // namespace abcg
 
 /**
@@ -52,6 +62,14 @@ struct abcg::ShaderSource {
   std::string source{};
   /** @brief Shader stage. */
   abcg::ShaderStage stage{};
+  /** @brief Preprocessor definitions added after the `#version` directive.
+   *
+   * Each definition is a macro name optionally followed by a space and its
+   * replacement text (e.g., `"INSTANCED"` or `"NUM_LIGHTS 4"`).
+   *
+   * @sa abcg::addShaderDefines.
+   */
+  std::vector<std::string> defines{};
 };
 
 #endif
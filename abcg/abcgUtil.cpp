@@ -10,13 +10,75 @@
 
 #include "abcgUtil.hpp"
 
+#include <bit>
+#include <cstring>
+
 namespace {
 auto const codeBoldRed{"\033[1;31m"};
 auto const codeBoldYellow{"\033[1;33m"};
 auto const codeBoldBlue{"\033[1;34m"};
 auto const codeReset{"\033[0m"};
+
+constexpr std::uint64_t goldenRatio{0x9e3779b97f4a7c15};
+
+// Finalizer of MurmurHash3: every input bit affects every output bit
+std::uint64_t mix(std::uint64_t value) noexcept {
+  value ^= value >> 33U;
+  value *= 0xff51afd7ed558ccd;
+  value ^= value >> 33U;
+  value *= 0xc4ceb9fe1a85ec53;
+  value ^= value >> 33U;
+  return value;
+}
+
+// Reads up to 8 bytes as a little-endian word, so that hashes do not depend on
+// the byte order of the machine
+std::uint64_t loadWord(std::span<std::byte const> bytes) noexcept {
+  std::uint64_t word{};
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(&word, bytes.data(), bytes.size());
+  } else {
+    for (std::size_t index{}; index < bytes.size(); ++index) {
+      word |= std::to_integer<std::uint64_t>(bytes[index]) << (index * 8U);
+    }
+  }
+  return word;
+}
 } // namespace
 
+/**
+ * @brief Computes a 64-bit hash value of a sequence of bytes.
+ *
+ * The bytes are read in little-endian words of 8 bytes, each one mixed with
+ * the MurmurHash3 finalizer, so that values that differ in a single bit (e.g.,
+ * coordinates that differ only in the sign) have unrelated hashes. Unlike
+ * abcg::hashCombine, it does not depend on the quality of std::hash.
+ *
+ * @param bytes Bytes to hash.
+ * @param seed Seed value.
+ *
+ * @return Hash value. The algorithm is fixed and does not depend on the
+ * platform, so the value can be stored in files (e.g., as the key of a cache
+ * on disk). Changing the algorithm invalidates such files.
+ */
+std::uint64_t abcg::hashBytes(std::span<std::byte const> bytes,
+                              std::uint64_t seed) noexcept {
+  auto hash{seed ^ (bytes.size() * goldenRatio)};
+  auto const combine{[&hash](std::uint64_t word) {
+    hash = std::rotl(hash ^ mix(word), 27) * goldenRatio + 0x52dce729;
+  }};
+
+  while (bytes.size() >= sizeof(std::uint64_t)) {
+    combine(loadWord(bytes.first(sizeof(std::uint64_t))));
+    bytes = bytes.subspan(sizeof(std::uint64_t));
+  }
+  if (!bytes.empty()) {
+    combine(loadWord(bytes));
+  }
+
+  return mix(hash);
+}
+
 /**
  * @brief Creates a string prefixed with the ANSI color code that corresponds to
  * foreground bold red.
@@ -11,7 +11,10 @@
 #ifndef ABCG_UTIL_HPP_
 #define ABCG_UTIL_HPP_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
 
 namespace abcg {
@@ -69,6 +72,9 @@ std::size_t hashCombine(const TFirst &value, const TRest &...rest) {
   return seed;
 }
 
+[[nodiscard]] std::uint64_t hashBytes(std::span<std::byte const> bytes,
+                                      std::uint64_t seed = 0) noexcept;
+
 std::string toRedString(std::string_view str);
 std::string toYellowString(std::string_view str);
 std::string toBlueString(std::string_view str);
@@ -0,0 +1,289 @@
+/**
+ * @file abcgVideoWriter.cpp
+ * @brief Definition of abcg::VideoWriter members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVideoWriter.hpp"
+
+#include <algorithm>
+
+#include "abcgException.hpp"
+#include "abcgProfiler.hpp"
+#include "abcgUtil.hpp"
+
+/**
+ * @brief Closes the file after writing the frames already submitted.
+ */
+abcg::VideoWriter::~VideoWriter() { close(); }
+
+/**
+ * @brief Creates the file, writes the stream header and starts the writer
+ * thread.
+ *
+ * @param filename Path to the output file.
+ * @param format Format of the output file.
+ * @param size Width and height of the frames. Must be even for
+ * abcg::VideoFormat::Y4M.
+ * @param frameRate Nominal frame rate written to the stream header.
+ *
+ * @throw abcg::RuntimeError if the size is invalid or if the file cannot be
+ * created.
+ */
+void abcg::VideoWriter::open(std::string_view filename, VideoFormat format,
+                             glm::ivec2 const &size, int frameRate) {
+  close();
+
+  if (size.x <= 0 || size.y <= 0 ||
+      (format == VideoFormat::Y4M && (size.x % 2 != 0 || size.y % 2 != 0))) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid video frame size {}x{}", size.x, size.y));
+  }
+
+  m_stream.open(std::string{filename}, std::ios::binary | std::ios::trunc);
+  if (!m_stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to create video file {}", filename));
+  }
+
+  auto const numPixels{gsl::narrow<std::size_t>(size.x) *
+                       gsl::narrow<std::size_t>(size.y)};
+  m_format = format;
+  m_size = size;
+  if (format == VideoFormat::Y4M) {
+    m_frameSize = numPixels + numPixels / 2;
+    // The samples are full range, which players assume to be limited range
+    // unless told otherwise
+    m_stream << fmt::format(
+        "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", size.x,
+        size.y, std::max(frameRate, 1));
+  } else {
+    m_frameSize = numPixels * 4;
+  }
+
+  m_reservedFrames = 0;
+  m_nextSequence = 0;
+  m_closing = false;
+  m_open = true;
+  m_writer = std::thread(&VideoWriter::writerLoop, this);
+}
+
+/**
+ * @brief Waits until all reserved frames are written or skipped, stops the
+ * writer thread and closes the file.
+ *
+ * Does nothing if the writer is not open.
+ */
+void abcg::VideoWriter::close() {
+  if (!m_open)
+    return;
+
+  {
+    std::scoped_lock lock{m_mutex};
+    m_closing = true;
+    m_closingAt = m_reservedFrames;
+  }
+  m_frameAdded.notify_all();
+  m_writer.join();
+
+  m_stream.close();
+  m_pending.clear();
+  m_freeBuffers.clear();
+  m_open = false;
+}
+
+/**
+ * @brief Returns whether the writer is open.
+ */
+bool abcg::VideoWriter::isOpen() const noexcept { return m_open; }
+
+/**
+ * @brief Returns the width and height of the frames.
+ */
+glm::ivec2 abcg::VideoWriter::getSize() const noexcept { return m_size; }
+
+/**
+ * @brief Reserves the next position in the stream.
+ *
+ * Call this in presentation order, from the thread that opens the writer.
+ * Every reserved frame must be eventually submitted with
+ * abcg::VideoWriter::write or abcg::VideoWriter::skip.
+ *
+ * @return Sequence number of the frame.
+ */
+std::uint64_t abcg::VideoWriter::reserveFrame() { return m_reservedFrames++; }
+
+/**
+ * @brief Converts a frame and queues it for writing.
+ *
+ * This can be called from any thread. Frames whose size does not match the
+ * size of the stream are skipped.
+ *
+ * @param sequence Sequence number returned by abcg::VideoWriter::reserveFrame.
+ * @param size Width and height of the frame.
+ * @param pixels RGBA pixels with 8 bits per channel, from the top row down.
+ */
+void abcg::VideoWriter::write(std::uint64_t sequence, glm::ivec2 const &size,
+                              std::span<unsigned char const> pixels) {
+  if (size != m_size ||
+      pixels.size() != gsl::narrow<std::size_t>(size.x * size.y * 4)) {
+    skip(sequence);
+    return;
+  }
+
+  ProfilerZone zone{"Video frame conversion"};
+  auto data{acquireBuffer()};
+  if (m_format == VideoFormat::Y4M) {
+    convertRGBAToI420(pixels, size, data);
+  } else {
+    std::copy(pixels.begin(), pixels.end(), data.begin());
+  }
+  submit(sequence, std::move(data));
+}
+
+/**
+ * @brief Marks a reserved frame as lost so that the stream can proceed.
+ *
+ * @param sequence Sequence number returned by abcg::VideoWriter::reserveFrame.
+ */
+void abcg::VideoWriter::skip(std::uint64_t sequence) { submit(sequence, {}); }
+
+/**
+ * @brief Converts RGBA pixels to planar YUV 4:2:0 (I420).
+ *
+ * Uses the full-range BT.601 coefficients of JPEG in 16-bit fixed point. Each
+ * chroma sample is computed from the average of a 2x2 block. The inner loops
+ * have no branches nor dependencies between iterations, so that they are
+ * vectorized by the compiler.
+ *
+ * @param pixels RGBA pixels with 8 bits per channel.
+ * @param size Width and height of the image. Must be even.
+ * @param planes Output Y, U and V planes, one after the other. Must hold at
+ * least 1.5 bytes per pixel.
+ */
+void abcg::VideoWriter::convertRGBAToI420(std::span<unsigned char const> pixels,
+                                          glm::ivec2 const &size,
+                                          std::span<unsigned char> planes) {
+  auto const width{gsl::narrow<std::size_t>(size.x)};
+  auto const height{gsl::narrow<std::size_t>(size.y)};
+  auto const halfWidth{width / 2};
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const *const rgba{pixels.data()};
+  auto *const planeY{planes.data()};
+  auto *const planeU{planeY + width * height};
+  auto *const planeV{planeU + halfWidth * (height / 2)};
+
+  for (std::size_t y{}; y < height; ++y) {
+    auto const *const source{rgba + y * width * 4};
+    auto *const destination{planeY + y * width};
+    for (std::size_t x{}; x < width; ++x) {
+      auto const red{std::int32_t{source[x * 4]}};
+      auto const green{std::int32_t{source[x * 4 + 1]}};
+      auto const blue{std::int32_t{source[x * 4 + 2]}};
+      destination[x] = static_cast<unsigned char>(
+          (19595 * red + 38470 * green + 7471 * blue + 32768) >> 16);
+    }
+  }
+
+  // Sums of 2x2 blocks are in [0, 1020], hence the extra 2 bits of shift
+  auto constexpr chromaBias{(128 << 18) + (1 << 17)};
+  for (std::size_t y{}; y < height / 2; ++y) {
+    auto const *const top{rgba + 2 * y * width * 4};
+    auto const *const bottom{top + width * 4};
+    auto *const destinationU{planeU + y * halfWidth};
+    auto *const destinationV{planeV + y * halfWidth};
+    for (std::size_t x{}; x < halfWidth; ++x) {
+      auto const red{std::int32_t{top[x * 8]} + top[x * 8 + 4] +
+                     bottom[x * 8] + bottom[x * 8 + 4]};
+      auto const green{std::int32_t{top[x * 8 + 1]} + top[x * 8 + 5] +
+                       bottom[x * 8 + 1] + bottom[x * 8 + 5]};
+      auto const blue{std::int32_t{top[x * 8 + 2]} + top[x * 8 + 6] +
+                      bottom[x * 8 + 2] + bottom[x * 8 + 6]};
+      // Pure blue or red round up to 256
+      destinationU[x] = static_cast<unsigned char>(std::min(
+          (-11059 * red - 21709 * green + 32768 * blue + chromaBias) >> 18,
+          255));
+      destinationV[x] = static_cast<unsigned char>(std::min(
+          (32768 * red - 27439 * green - 5329 * blue + chromaBias) >> 18,
+          255));
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void abcg::VideoWriter::submit(std::uint64_t sequence,
+                               std::vector<unsigned char> data) {
+  {
+    // The next frame in sequence is always accepted, otherwise a full queue
+    // of later frames would never drain
+    std::unique_lock lock{m_mutex};
+    m_frameWritten.wait(lock, [this, sequence] {
+      return m_pending.size() < maxQueuedFrames || sequence == m_nextSequence;
+    });
+    m_pending.emplace(sequence, std::move(data));
+  }
+  m_frameAdded.notify_one();
+}
+
+std::vector<unsigned char> abcg::VideoWriter::acquireBuffer() {
+  std::vector<unsigned char> buffer;
+  {
+    std::scoped_lock lock{m_mutex};
+    if (!m_freeBuffers.empty()) {
+      buffer = std::move(m_freeBuffers.back());
+      m_freeBuffers.pop_back();
+    }
+  }
+  buffer.resize(m_frameSize);
+  return buffer;
+}
+
+void abcg::VideoWriter::writerLoop() {
+  Profiler::setThreadName("Video writer");
+  auto failed{false};
+  while (true) {
+    std::vector<unsigned char> data;
+    {
+      std::unique_lock lock{m_mutex};
+      m_frameAdded.wait(lock, [this] {
+        return (!m_pending.empty() &&
+                m_pending.begin()->first == m_nextSequence) ||
+               (m_closing && m_nextSequence >= m_closingAt);
+      });
+      if (m_pending.empty() || m_pending.begin()->first != m_nextSequence)
+        return;
+      data = std::move(m_pending.begin()->second);
+      m_pending.erase(m_pending.begin());
+    }
+
+    // Skipped frames have no data
+    if (!data.empty() && !failed) {
+      ProfilerZone zone{"Video frame write"};
+      if (m_format == VideoFormat::Y4M) {
+        m_stream << "FRAME\n";
+      }
+      m_stream.write(reinterpret_cast<char const *>(data.data()), // NOLINT
+                     gsl::narrow<std::streamsize>(data.size()));
+      if (!m_stream) {
+        fmt::print(stderr, "{}\n",
+                   toRedString("Failed to write video frame; recording "
+                               "stopped"));
+        failed = true;
+      }
+    }
+
+    {
+      std::scoped_lock lock{m_mutex};
+      if (!data.empty() && m_freeBuffers.size() < maxQueuedFrames) {
+        m_freeBuffers.push_back(std::move(data));
+      }
+      ++m_nextSequence;
+    }
+    m_frameWritten.notify_all();
+  }
+}
@@ -0,0 +1,121 @@
+/**
+ * @file abcgVideoWriter.hpp
+ * @brief Header file of abcg::VideoWriter.
+ *
+ * Declaration of abcg::VideoWriter and abcg::VideoFormat.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VIDEO_WRITER_HPP_
+#define ABCG_VIDEO_WRITER_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "abcgExternal.hpp"
+
+namespace abcg {
+enum class VideoFormat;
+class VideoWriter;
+} // namespace abcg
+
+/**
+ * @brief Enumeration of video file formats supported by abcg::VideoWriter.
+ */
+enum class abcg::VideoFormat {
+  /** @brief YUV4MPEG2 stream with 4:2:0 chroma subsampling (full range).
+   *
+   * Can be played with `ffplay` or `mpv`, and converted with `ffmpeg -i
+   * video.y4m video.mp4`.
+   */
+  Y4M,
+  /** @brief Headerless stream of RGBA frames with 8 bits per channel.
+   *
+   * Can be converted with `ffmpeg -f rawvideo -pix_fmt rgba -s WxH -r FPS -i
+   * video.rgba video.mp4`.
+   */
+  RawRGBA
+};
+
+/**
+ * @brief Writer of uncompressed video streams.
+ *
+ * Frames are submitted with abcg::VideoWriter::write from any thread, possibly
+ * out of order. Each frame is identified by a sequence number obtained on the
+ * producer side with abcg::VideoWriter::reserveFrame, in presentation order.
+ * The pixels are converted to the output format on the calling thread, and
+ * the converted frames are kept in a bounded queue until a writer thread
+ * writes them to the file in sequence order.
+ *
+ * Producers block only if abcg::VideoWriter::maxQueuedFrames frames are
+ * waiting to be written and the submitted frame is not the next one in
+ * sequence.
+ *
+ * @remark Objects of this type cannot be copied or moved.
+ */
+class abcg::VideoWriter {
+public:
+  /** @brief Maximum number of converted frames waiting to be written. */
+  static constexpr std::size_t maxQueuedFrames{8};
+
+  VideoWriter() = default;
+  ~VideoWriter();
+
+  VideoWriter(VideoWriter const &) = delete;
+  VideoWriter(VideoWriter &&) = delete;
+  VideoWriter &operator=(VideoWriter const &) = delete;
+  VideoWriter &operator=(VideoWriter &&) = delete;
+
+  void open(std::string_view filename, VideoFormat format,
+            glm::ivec2 const &size, int frameRate);
+  void close();
+  [[nodiscard]] bool isOpen() const noexcept;
+  [[nodiscard]] glm::ivec2 getSize() const noexcept;
+
+  [[nodiscard]] std::uint64_t reserveFrame();
+  void write(std::uint64_t sequence, glm::ivec2 const &size,
+             std::span<unsigned char const> pixels);
+  void skip(std::uint64_t sequence);
+
+  static void convertRGBAToI420(std::span<unsigned char const> pixels,
+                                glm::ivec2 const &size,
+                                std::span<unsigned char> planes);
+
+private:
+  void submit(std::uint64_t sequence, std::vector<unsigned char> data);
+  [[nodiscard]] std::vector<unsigned char> acquireBuffer();
+  void writerLoop();
+
+  std::ofstream m_stream;
+  VideoFormat m_format{VideoFormat::Y4M};
+  glm::ivec2 m_size{};
+  std::size_t m_frameSize{};
+
+  // Written only by the thread that calls open, reserveFrame and close
+  std::uint64_t m_reservedFrames{};
+
+  // Shared with the writer thread and the producers
+  mutable std::mutex m_mutex;
+  std::condition_variable m_frameAdded;
+  std::condition_variable m_frameWritten;
+  std::map<std::uint64_t, std::vector<unsigned char>> m_pending;
+  std::vector<std::vector<unsigned char>> m_freeBuffers;
+  std::uint64_t m_nextSequence{};
+  std::uint64_t m_closingAt{};
+  bool m_closing{};
+  bool m_open{};
+  std::thread m_writer;
+};
+
+#endif
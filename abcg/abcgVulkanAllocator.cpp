@@ -0,0 +1,608 @@
+/**
+ * @file abcgVulkanAllocator.cpp
+ * @brief Definition of abcg::VulkanAllocator
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanAllocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+#include <limits>
+#include <optional>
+
+#include "abcgException.hpp"
+
+namespace {
+// Block size on heaps larger than largeHeapSize. Smaller heaps use 1/8 of the
+// heap size
+constexpr vk::DeviceSize largeHeapBlockSize{vk::DeviceSize{64} << 20U};
+constexpr vk::DeviceSize largeHeapSize{vk::DeviceSize{1} << 30U};
+
+// Each first level list of the TLSF (sizes between two powers of two) is split
+// into 2^secondLevelBits second level lists of equal ranges. Sizes smaller
+// than secondLevelCount are mapped one to one in the first level zero
+constexpr std::uint32_t secondLevelBits{4};
+constexpr std::uint32_t secondLevelCount{1U << secondLevelBits};
+constexpr std::uint32_t firstLevelCount{64 - secondLevelBits + 1};
+
+constexpr std::uint32_t noRegion{std::numeric_limits<std::uint32_t>::max()};
+
+[[nodiscard]] constexpr vk::DeviceSize alignUp(vk::DeviceSize value,
+                                               vk::DeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+[[nodiscard]] constexpr vk::DeviceSize alignDown(vk::DeviceSize value,
+                                                 vk::DeviceSize alignment) {
+  return value & ~(alignment - 1);
+}
+
+// Indices of the free list of a region of the given size
+[[nodiscard]] std::pair<std::uint32_t, std::uint32_t>
+getListIndices(vk::DeviceSize size) {
+  if (size < secondLevelCount) {
+    return {0, gsl::narrow_cast<std::uint32_t>(size)};
+  }
+  auto const log2{gsl::narrow_cast<std::uint32_t>(std::bit_width(size) - 1)};
+  return {log2 - secondLevelBits + 1,
+          gsl::narrow_cast<std::uint32_t>(size >> (log2 - secondLevelBits)) ^
+              secondLevelCount};
+}
+} // namespace
+
+// Device memory object split into regions with a TLSF allocator. Regions are
+// linked in order of offset, and free regions are also linked in the free list
+// of their size. Adjacent free regions are always merged
+class abcg::VulkanAllocator::Block {
+public:
+  Block(vk::DeviceMemory memory, vk::DeviceSize size, std::uint32_t memoryType,
+        bool linear, bool dedicated, void *mappedData)
+      : m_memory{memory}, m_size{size}, m_memoryType{memoryType},
+        m_linear{linear}, m_dedicated{dedicated}, m_mappedData{mappedData} {
+    for (auto &heads : m_heads) {
+      heads.fill(noRegion);
+    }
+    m_regions.push_back({.size = size});
+    insertFree(0);
+  }
+
+  // Returns the offset and the region of an allocation, or std::nullopt if
+  // there is no free region large enough
+  [[nodiscard]] std::optional<std::pair<vk::DeviceSize, std::uint32_t>>
+  allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    // Any region of the list found for size + alignment - 1 bytes fits the
+    // allocation at the first aligned offset
+    auto const index{findFree(size + alignment - 1)};
+    if (index == noRegion) {
+      return std::nullopt;
+    }
+    removeFree(index);
+
+    // Padding before the aligned offset is kept as a free region
+    auto const offset{m_regions[index].offset};
+    auto const alignedOffset{alignUp(offset, alignment)};
+    if (alignedOffset > offset) {
+      auto const aligned{split(index, alignedOffset - offset)};
+      insertFree(index);
+      return allocateTail(aligned, size);
+    }
+    return allocateTail(index, size);
+  }
+
+  void free(std::uint32_t index) {
+    auto &region{m_regions[index]};
+    region.free = true;
+    m_usedBytes -= region.size;
+    --m_allocationCount;
+
+    if (auto const next{region.nextPhysical};
+        next != noRegion && m_regions[next].free) {
+      removeFree(next);
+      merge(index, next);
+    }
+    if (auto const previous{m_regions[index].previousPhysical};
+        previous != noRegion && m_regions[previous].free) {
+      removeFree(previous);
+      merge(previous, index);
+      index = previous;
+    }
+    insertFree(index);
+  }
+
+  // Returns the number of free bytes that are not in the largest free region
+  // of the block
+  vk::DeviceSize addStatistics(VulkanAllocatorStatistics &statistics) const {
+    ++statistics.blockCount;
+    statistics.allocationCount += m_allocationCount;
+    statistics.blockBytes += m_size;
+    statistics.usedBytes += m_usedBytes;
+    statistics.freeBytes += m_size - m_usedBytes;
+    vk::DeviceSize largestFreeRegion{};
+    for (auto index{m_first}; index != noRegion;
+         index = m_regions[index].nextPhysical) {
+      if (auto const &region{m_regions[index]}; region.free) {
+        ++statistics.freeRegionCount;
+        largestFreeRegion = std::max(largestFreeRegion, region.size);
+      }
+    }
+    statistics.largestFreeRegion =
+        std::max(statistics.largestFreeRegion, largestFreeRegion);
+    return m_size - m_usedBytes - largestFreeRegion;
+  }
+
+  [[nodiscard]] bool isEmpty() const noexcept { return m_allocationCount == 0; }
+  [[nodiscard]] vk::DeviceMemory getMemory() const noexcept { return m_memory; }
+  [[nodiscard]] vk::DeviceSize getSize() const noexcept { return m_size; }
+  [[nodiscard]] std::uint32_t getMemoryType() const noexcept {
+    return m_memoryType;
+  }
+  [[nodiscard]] bool isLinear() const noexcept { return m_linear; }
+  [[nodiscard]] bool isDedicated() const noexcept { return m_dedicated; }
+  [[nodiscard]] void *getMappedData() const noexcept { return m_mappedData; }
+
+private:
+  struct Region {
+    vk::DeviceSize offset{};
+    vk::DeviceSize size{};
+    std::uint32_t previousPhysical{noRegion};
+    std::uint32_t nextPhysical{noRegion};
+    std::uint32_t previousFree{noRegion};
+    std::uint32_t nextFree{noRegion};
+    bool free{};
+  };
+
+  // Uses the beginning of a region for an allocation and returns the rest to
+  // the free lists
+  [[nodiscard]] std::pair<vk::DeviceSize, std::uint32_t>
+  allocateTail(std::uint32_t index, vk::DeviceSize size) {
+    if (m_regions[index].size > size) {
+      insertFree(split(index, size));
+    }
+    m_regions[index].free = false;
+    m_usedBytes += m_regions[index].size;
+    ++m_allocationCount;
+    return {m_regions[index].offset, index};
+  }
+
+  // Splits a region at the given size and returns the second part
+  [[nodiscard]] std::uint32_t split(std::uint32_t index, vk::DeviceSize size) {
+    auto const second{newRegion()};
+    auto &region{m_regions[index]};
+    auto &rest{m_regions[second]};
+    rest.offset = region.offset + size;
+    rest.size = region.size - size;
+    rest.previousPhysical = index;
+    rest.nextPhysical = region.nextPhysical;
+    if (region.nextPhysical != noRegion) {
+      m_regions[region.nextPhysical].previousPhysical = second;
+    }
+    region.size = size;
+    region.nextPhysical = second;
+    return second;
+  }
+
+  // Merges a region into the region that precedes it
+  void merge(std::uint32_t index, std::uint32_t next) {
+    auto &region{m_regions[index]};
+    region.size += m_regions[next].size;
+    region.nextPhysical = m_regions[next].nextPhysical;
+    if (region.nextPhysical != noRegion) {
+      m_regions[region.nextPhysical].previousPhysical = index;
+    }
+    m_regions[next] = {};
+    m_unusedRegions.push_back(next);
+  }
+
+  [[nodiscard]] std::uint32_t newRegion() {
+    if (!m_unusedRegions.empty()) {
+      auto const index{m_unusedRegions.back()};
+      m_unusedRegions.pop_back();
+      return index;
+    }
+    m_regions.emplace_back();
+    return gsl::narrow<std::uint32_t>(m_regions.size() - 1);
+  }
+
+  // Returns a free region of at least the given size in constant time. The
+  // size is rounded up to the next list, so that any region of the list fits.
+  // If there is none, the first region of the list of the size is tried
+  [[nodiscard]] std::uint32_t findFree(vk::DeviceSize size) const {
+    if (size > m_size) {
+      return noRegion;
+    }
+    if (auto const index{findFreeRoundedUp(size)}; index != noRegion) {
+      return index;
+    }
+    auto const [firstLevel, secondLevel]{getListIndices(size)};
+    auto const index{m_heads.at(firstLevel).at(secondLevel)};
+    return index != noRegion && m_regions[index].size >= size ? index
+                                                              : noRegion;
+  }
+
+  [[nodiscard]] std::uint32_t findFreeRoundedUp(vk::DeviceSize size) const {
+    if (size >= secondLevelCount) {
+      size += (vk::DeviceSize{1} << (std::bit_width(size) - 1 -
+                                     secondLevelBits)) -
+              1;
+    }
+    auto [firstLevel, secondLevel]{getListIndices(size)};
+
+    auto secondLevelMap{m_secondLevelMaps.at(firstLevel) &
+                        (~0U << secondLevel)};
+    if (secondLevelMap == 0) {
+      if (firstLevel + 1 >= firstLevelCount) {
+        return noRegion;
+      }
+      auto const firstLevelMap{m_firstLevelMap &
+                               (~std::uint64_t{0} << (firstLevel + 1))};
+      if (firstLevelMap == 0) {
+        return noRegion;
+      }
+      firstLevel = gsl::narrow_cast<std::uint32_t>(
+          std::countr_zero(firstLevelMap));
+      secondLevelMap = m_secondLevelMaps.at(firstLevel);
+    }
+    secondLevel =
+        gsl::narrow_cast<std::uint32_t>(std::countr_zero(secondLevelMap));
+    return m_heads.at(firstLevel).at(secondLevel);
+  }
+
+  void insertFree(std::uint32_t index) {
+    auto &region{m_regions[index]};
+    region.free = true;
+    auto const [firstLevel, secondLevel]{getListIndices(region.size)};
+    auto &head{m_heads.at(firstLevel).at(secondLevel)};
+    region.previousFree = noRegion;
+    region.nextFree = head;
+    if (head != noRegion) {
+      m_regions[head].previousFree = index;
+    }
+    head = index;
+    m_firstLevelMap |= std::uint64_t{1} << firstLevel;
+    m_secondLevelMaps.at(firstLevel) |= 1U << secondLevel;
+  }
+
+  void removeFree(std::uint32_t index) {
+    auto &region{m_regions[index]};
+    if (region.previousFree != noRegion) {
+      m_regions[region.previousFree].nextFree = region.nextFree;
+    }
+    if (region.nextFree != noRegion) {
+      m_regions[region.nextFree].previousFree = region.previousFree;
+    }
+    auto const [firstLevel, secondLevel]{getListIndices(region.size)};
+    if (auto &head{m_heads.at(firstLevel).at(secondLevel)}; head == index) {
+      head = region.nextFree;
+      if (head == noRegion) {
+        m_secondLevelMaps.at(firstLevel) &= ~(1U << secondLevel);
+        if (m_secondLevelMaps.at(firstLevel) == 0) {
+          m_firstLevelMap &= ~(std::uint64_t{1} << firstLevel);
+        }
+      }
+    }
+    region.previousFree = noRegion;
+    region.nextFree = noRegion;
+  }
+
+  vk::DeviceMemory m_memory;
+  vk::DeviceSize m_size{};
+  std::uint32_t m_memoryType{};
+  bool m_linear{};
+  bool m_dedicated{};
+  void *m_mappedData{};
+
+  std::vector<Region> m_regions;
+  std::vector<std::uint32_t> m_unusedRegions;
+  std::uint32_t m_first{};
+  std::uint64_t m_firstLevelMap{};
+  std::array<std::uint32_t, firstLevelCount> m_secondLevelMaps{};
+  std::array<std::array<std::uint32_t, secondLevelCount>, firstLevelCount>
+      m_heads{};
+  vk::DeviceSize m_usedBytes{};
+  std::size_t m_allocationCount{};
+};
+
+abcg::VulkanAllocator::VulkanAllocator() = default;
+
+abcg::VulkanAllocator::~VulkanAllocator() = default;
+
+/**
+ * @brief Prepares the allocator for a logical device.
+ *
+ * No device memory is allocated until the first call to
+ * abcg::VulkanAllocator::allocate.
+ *
+ * @param device Logical device.
+ * @param physicalDevice Physical device of the logical device.
+ * @param blockSize Size of the device memory objects, in bytes, or 0 to use
+ * 64 MiB, or 1/8 of the heap size on heaps smaller than 1 GiB.
+ */
+void abcg::VulkanAllocator::create(vk::Device const &device,
+                                   VulkanPhysicalDevice const &physicalDevice,
+                                   vk::DeviceSize blockSize) {
+  std::scoped_lock const lock{m_mutex};
+  m_device = device;
+  m_physicalDevice = physicalDevice;
+  m_blockSize = blockSize;
+
+  auto const &vkPhysicalDevice{
+      static_cast<vk::PhysicalDevice>(m_physicalDevice)};
+  m_memoryProperties = vkPhysicalDevice.getMemoryProperties();
+  auto const limits{vkPhysicalDevice.getProperties().limits};
+  m_bufferImageGranularity = std::max(limits.bufferImageGranularity,
+                                      vk::DeviceSize{1});
+  m_nonCoherentAtomSize = std::max(limits.nonCoherentAtomSize,
+                                   vk::DeviceSize{1});
+  m_maxBlockCount = limits.maxMemoryAllocationCount;
+}
+
+/**
+ * @brief Releases all device memory objects.
+ *
+ * Allocations still in use are reported and released.
+ */
+void abcg::VulkanAllocator::destroy() {
+  std::scoped_lock const lock{m_mutex};
+  for (auto const index : iter::range(m_blocks.size())) {
+    if (m_blocks[index] == nullptr) {
+      continue;
+    }
+    if (!m_blocks[index]->isEmpty()) {
+      fmt::print("Warning: destroying device memory with allocations in use\n");
+    }
+    destroyBlock(gsl::narrow<std::uint32_t>(index));
+  }
+  m_blocks.clear();
+}
+
+/**
+ * @brief Allocates a range of device memory.
+ *
+ * @param requirements Memory requirements of the buffer or image.
+ * @param properties Required memory properties.
+ * @param linear Whether the memory will be bound to a buffer or to an image
+ * with linear tiling, as opposed to an image with optimal tiling.
+ *
+ * @throw abcg::RuntimeError if there is no memory type with the required
+ * properties or if the maximum number of device memory objects is reached.
+ * @throw vk::SystemError if device memory could not be allocated.
+ *
+ * @return Allocation to be bound to the resource, and released with
+ * abcg::VulkanAllocator::free.
+ */
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocate(vk::MemoryRequirements const &requirements,
+                                vk::MemoryPropertyFlags properties,
+                                bool linear) {
+  auto const memoryType{m_physicalDevice.findMemoryType(
+      requirements.memoryTypeBits, properties)};
+  if (!memoryType.has_value()) {
+    throw abcg::RuntimeError("Failed to find suitable memory type");
+  }
+
+  auto alignment{std::max(requirements.alignment, vk::DeviceSize{1})};
+  auto size{std::max(requirements.size, vk::DeviceSize{1})};
+  if (!isCoherent(memoryType.value())) {
+    alignment = std::max(alignment, m_nonCoherentAtomSize);
+    size = alignUp(size, m_nonCoherentAtomSize);
+  }
+  // All resources can share blocks if there are no granularity restrictions
+  if (m_bufferImageGranularity == 1) {
+    linear = true;
+  }
+
+  std::scoped_lock const lock{m_mutex};
+
+  auto const heapIndex{
+      m_memoryProperties.memoryTypes.at(memoryType.value()).heapIndex};
+  auto const heapSize{m_memoryProperties.memoryHeaps.at(heapIndex).size};
+  auto blockSize{m_blockSize};
+  if (blockSize == 0) {
+    blockSize = heapSize > largeHeapSize ? largeHeapBlockSize : heapSize / 8;
+  }
+
+  auto const makeAllocation{[&](std::uint32_t index, vk::DeviceSize offset,
+                                std::uint32_t region) {
+    auto const &block{*m_blocks[index]};
+    auto *const mappedData{static_cast<std::byte *>(block.getMappedData())};
+    return VulkanAllocation{
+        .memory = block.getMemory(),
+        .offset = offset,
+        .size = size,
+        .mappedData = mappedData != nullptr ? mappedData + offset : nullptr,
+        .block = index,
+        .region = region};
+  }};
+
+  // Large resources get their own device memory object
+  if (size + alignment - 1 > blockSize / 2) {
+    auto const index{createBlock(memoryType.value(), linear, size, true)};
+    auto const [offset, region]{m_blocks[index]->allocate(size, 1).value()};
+    return makeAllocation(index, offset, region);
+  }
+
+  for (auto const index : iter::range(m_blocks.size())) {
+    auto &block{m_blocks[index]};
+    if (block == nullptr || block->isDedicated() ||
+        block->getMemoryType() != memoryType.value() ||
+        block->isLinear() != linear) {
+      continue;
+    }
+    if (auto const result{block->allocate(size, alignment)}) {
+      auto const [offset, region]{result.value()};
+      return makeAllocation(gsl::narrow<std::uint32_t>(index), offset, region);
+    }
+  }
+
+  // Smaller blocks are tried if the device runs out of memory
+  for (;;) {
+    try {
+      auto const index{createBlock(memoryType.value(), linear, blockSize,
+                                   false)};
+      auto const [offset, region]{
+          m_blocks[index]->allocate(size, alignment).value()};
+      return makeAllocation(index, offset, region);
+    } catch (vk::OutOfDeviceMemoryError const &) {
+      if (blockSize / 2 < size + alignment - 1) {
+        throw;
+      }
+      blockSize /= 2;
+    }
+  }
+}
+
+/**
+ * @brief Releases an allocation.
+ *
+ * Device memory objects are released when they become empty, except for one
+ * empty block of each memory type, which is kept for future allocations.
+ *
+ * @param allocation Allocation returned by abcg::VulkanAllocator::allocate.
+ * It is reset to an invalid allocation.
+ */
+void abcg::VulkanAllocator::free(VulkanAllocation &allocation) {
+  if (!allocation) {
+    return;
+  }
+
+  std::scoped_lock const lock{m_mutex};
+  auto const index{allocation.block};
+  auto const &block{m_blocks.at(index)};
+  block->free(allocation.region);
+  allocation = {};
+  if (!block->isEmpty()) {
+    return;
+  }
+
+  auto const emptyBlocks{
+      std::ranges::count_if(m_blocks, [&block](auto const &other) {
+        return other != nullptr && !other->isDedicated() && other->isEmpty() &&
+               other->getMemoryType() == block->getMemoryType() &&
+               other->isLinear() == block->isLinear();
+      })};
+  if (block->isDedicated() || emptyBlocks > 1) {
+    destroyBlock(index);
+  }
+}
+
+/**
+ * @brief Makes host writes to an allocation visible to the device.
+ *
+ * This is required only for memory types without
+ * `vk::MemoryPropertyFlagBits::eHostCoherent`, and does nothing otherwise.
+ *
+ * @param allocation Allocation of host visible memory.
+ * @param offset Offset of the written range from the beginning of the
+ * allocation, in bytes.
+ * @param size Size of the written range, in bytes, or `VK_WHOLE_SIZE` for the
+ * rest of the allocation.
+ */
+void abcg::VulkanAllocator::flush(VulkanAllocation const &allocation,
+                                  vk::DeviceSize offset,
+                                  vk::DeviceSize size) const {
+  if (!allocation) {
+    return;
+  }
+
+  std::scoped_lock const lock{m_mutex};
+  auto const &block{*m_blocks.at(allocation.block)};
+  if (isCoherent(block.getMemoryType())) {
+    return;
+  }
+  if (size == VK_WHOLE_SIZE) {
+    size = allocation.size - offset;
+  }
+
+  // Allocations of non-coherent memory are aligned to nonCoherentAtomSize, so
+  // the aligned range never touches other allocations
+  auto const begin{
+      alignDown(allocation.offset + offset, m_nonCoherentAtomSize)};
+  auto const end{std::min(
+      alignUp(allocation.offset + offset + size, m_nonCoherentAtomSize),
+      allocation.offset + allocation.size)};
+  m_device.flushMappedMemoryRanges(vk::MappedMemoryRange{
+      .memory = allocation.memory, .offset = begin, .size = end - begin});
+}
+
+/**
+ * @brief Returns statistics of memory usage and fragmentation.
+ *
+ * @return Statistics of all memory types.
+ */
+abcg::VulkanAllocatorStatistics abcg::VulkanAllocator::getStatistics() const {
+  std::scoped_lock const lock{m_mutex};
+  VulkanAllocatorStatistics statistics;
+  vk::DeviceSize fragmentedBytes{};
+  for (auto const &block : m_blocks) {
+    if (block != nullptr) {
+      fragmentedBytes += block->addStatistics(statistics);
+    }
+  }
+  // Allocations never span blocks, so fragmentation is measured within each
+  // block: several empty blocks are not fragmented
+  if (statistics.freeBytes > 0) {
+    statistics.fragmentation = gsl::narrow_cast<float>(fragmentedBytes) /
+                               gsl::narrow_cast<float>(statistics.freeBytes);
+  }
+  return statistics;
+}
+
+bool abcg::VulkanAllocator::isCoherent(
+    std::uint32_t memoryType) const noexcept {
+  auto const flags{m_memoryProperties.memoryTypes.at(memoryType).propertyFlags};
+  return !(flags & vk::MemoryPropertyFlagBits::eHostVisible) ||
+         bool(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+std::uint32_t abcg::VulkanAllocator::createBlock(std::uint32_t memoryType,
+                                                 bool linear,
+                                                 vk::DeviceSize size,
+                                                 bool dedicated) {
+  if (m_blockCount >= m_maxBlockCount) {
+    throw abcg::RuntimeError("Maximum number of device memory objects reached");
+  }
+
+  auto const memory{m_device.allocateMemory(
+      {.allocationSize = size, .memoryTypeIndex = memoryType})};
+  void *mappedData{};
+  if (m_memoryProperties.memoryTypes.at(memoryType).propertyFlags &
+      vk::MemoryPropertyFlagBits::eHostVisible) {
+    try {
+      mappedData = m_device.mapMemory(memory, 0, VK_WHOLE_SIZE);
+    } catch (...) {
+      m_device.freeMemory(memory);
+      throw;
+    }
+  }
+
+  auto block{std::make_unique<Block>(memory, size, memoryType, linear,
+                                     dedicated, mappedData)};
+  ++m_blockCount;
+  if (auto const slot{std::ranges::find_if(
+          m_blocks, [](auto const &other) { return other == nullptr; })};
+      slot != m_blocks.end()) {
+    *slot = std::move(block);
+    return gsl::narrow<std::uint32_t>(slot - m_blocks.begin());
+  }
+  m_blocks.push_back(std::move(block));
+  return gsl::narrow<std::uint32_t>(m_blocks.size() - 1);
+}
+
+void abcg::VulkanAllocator::destroyBlock(std::uint32_t block) {
+  auto &slot{m_blocks.at(block)};
+  if (slot->getMappedData() != nullptr) {
+    m_device.unmapMemory(slot->getMemory());
+  }
+  m_device.freeMemory(slot->getMemory());
+  slot.reset();
+  --m_blockCount;
+}
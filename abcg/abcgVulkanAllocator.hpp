@@ -0,0 +1,140 @@
+/**
+ * @file abcgVulkanAllocator.hpp
+ * @brief Header file of abcg::VulkanAllocator
+ *
+ * Declaration of abcg::VulkanAllocator, abcg::VulkanAllocation and
+ * abcg::VulkanAllocatorStatistics.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_ALLOCATOR_HPP_
+#define ABCG_VULKAN_ALLOCATOR_HPP_
+
+#include "abcgVulkanPhysicalDevice.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace abcg {
+struct VulkanAllocation;
+struct VulkanAllocatorStatistics;
+class VulkanAllocator;
+} // namespace abcg
+
+/**
+ * @brief Range of device memory returned by abcg::VulkanAllocator::allocate.
+ */
+struct abcg::VulkanAllocation {
+  /** @brief Device memory object, shared with other allocations. */
+  vk::DeviceMemory memory{};
+  /** @brief Offset of the allocation in the device memory object, in bytes. */
+  vk::DeviceSize offset{};
+  /** @brief Size of the allocation, in bytes. */
+  vk::DeviceSize size{};
+  /** @brief Pointer to the beginning of the allocation if the memory is host
+   * visible, or `nullptr` otherwise. The memory stays mapped while the
+   * allocation exists. */
+  void *mappedData{};
+  /** @brief Index of the memory block. Used by the allocator. */
+  std::uint32_t block{};
+  /** @brief Index of the region of the memory block. Used by the allocator. */
+  std::uint32_t region{};
+
+  /** @brief Whether this is a valid allocation. */
+  explicit operator bool() const noexcept { return static_cast<bool>(memory); }
+};
+
+/**
+ * @brief Memory usage statistics of abcg::VulkanAllocator.
+ */
+struct abcg::VulkanAllocatorStatistics {
+  /** @brief Number of device memory objects. */
+  std::size_t blockCount{};
+  /** @brief Number of allocations. */
+  std::size_t allocationCount{};
+  /** @brief Size of all device memory objects, in bytes. */
+  vk::DeviceSize blockBytes{};
+  /** @brief Bytes used by allocations, including rounding to the memory
+   * requirements. */
+  vk::DeviceSize usedBytes{};
+  /** @brief Bytes not used by allocations. */
+  vk::DeviceSize freeBytes{};
+  /** @brief Number of contiguous ranges of free bytes. */
+  std::size_t freeRegionCount{};
+  /** @brief Size of the largest contiguous range of free bytes. */
+  vk::DeviceSize largestFreeRegion{};
+  /** @brief Fraction of free bytes that are not in the largest free range of
+   * their block, from 0 (no fragmentation) to 1. */
+  float fragmentation{};
+};
+
+/**
+ * @brief A class for sub-allocating buffers and images from shared blocks of
+ * device memory.
+ *
+ * Each memory type has its own list of blocks. Blocks are split into regions
+ * managed by a two-level segregated fit (TLSF) free list, which finds a free
+ * region and merges adjacent free regions in constant time. Requests larger
+ * than half of the block size get a dedicated device memory object.
+ *
+ * Buffers and images are kept in separate blocks when the
+ * `bufferImageGranularity` limit of the physical device is larger than 1, so
+ * that linear and non-linear resources never share a page. Host visible blocks
+ * are persistently mapped, and allocations of non-coherent memory are aligned
+ * to `nonCoherentAtomSize` so that they can be flushed independently.
+ *
+ * abcg::VulkanDevice owns an allocator used by abcg::VulkanBuffer and
+ * abcg::VulkanImage. The member functions can be called from any thread.
+ */
+class abcg::VulkanAllocator {
+public:
+  VulkanAllocator();
+  ~VulkanAllocator();
+
+  VulkanAllocator(VulkanAllocator const &) = delete;
+  VulkanAllocator(VulkanAllocator &&) = delete;
+  VulkanAllocator &operator=(VulkanAllocator const &) = delete;
+  VulkanAllocator &operator=(VulkanAllocator &&) = delete;
+
+  void create(vk::Device const &device,
+              VulkanPhysicalDevice const &physicalDevice,
+              vk::DeviceSize blockSize = 0);
+  void destroy();
+
+  [[nodiscard]] VulkanAllocation
+  allocate(vk::MemoryRequirements const &requirements,
+           vk::MemoryPropertyFlags properties, bool linear);
+  void free(VulkanAllocation &allocation);
+  void flush(VulkanAllocation const &allocation, vk::DeviceSize offset = 0,
+             vk::DeviceSize size = VK_WHOLE_SIZE) const;
+
+  [[nodiscard]] VulkanAllocatorStatistics getStatistics() const;
+
+private:
+  class Block;
+
+  [[nodiscard]] bool isCoherent(std::uint32_t memoryType) const noexcept;
+  [[nodiscard]] std::uint32_t createBlock(std::uint32_t memoryType,
+                                          bool linear, vk::DeviceSize size,
+                                          bool dedicated);
+  void destroyBlock(std::uint32_t block);
+
+  mutable std::mutex m_mutex;
+  vk::Device m_device;
+  VulkanPhysicalDevice m_physicalDevice;
+  vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+  vk::DeviceSize m_blockSize{};
+  vk::DeviceSize m_bufferImageGranularity{1};
+  vk::DeviceSize m_nonCoherentAtomSize{1};
+  std::uint32_t m_maxBlockCount{};
+  std::uint32_t m_blockCount{};
+  std::vector<std::unique_ptr<Block>> m_blocks;
+};
+
+#endif
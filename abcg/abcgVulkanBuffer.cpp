@@ -19,9 +19,10 @@
 void abcg::VulkanBuffer::create(VulkanDevice const &device,
                                 VulkanBufferCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
   if (createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) {
-    std::tie(m_buffer, m_deviceMemory) = createBuffer(
+    std::tie(m_buffer, m_allocation) = createBuffer(
         device, createInfo.size, createInfo.usage, createInfo.properties);
 
     if (createInfo.data.has_value()) {
@@ -30,7 +31,7 @@ void abcg::VulkanBuffer::create(VulkanDevice const &device,
   } else if (createInfo.data.has_value()) {
     // Use a staging buffer for mapping, and a device local buffer as the final
     // destination
-    auto [stagingBuffer, stagingBufferMemory]{createBuffer(
+    auto [stagingBuffer, stagingAllocation]{createBuffer(
         device, createInfo.size, vk::BufferUsageFlagBits::eTransferSrc,
         vk::MemoryPropertyFlagBits::eHostVisible |
             vk::MemoryPropertyFlagBits::eHostCoherent)};
@@ -38,13 +39,11 @@ void abcg::VulkanBuffer::create(VulkanDevice const &device,
     // Copy data to mapped staging buffer
     // Transfer of data to the GPU will happen in the background before the next
     // call to vkQueueSubmit
-    void *data{m_device.mapMemory(stagingBufferMemory, vk::DeviceSize{0},
-                                  createInfo.size)};
-    memcpy(data, createInfo.data->get(), createInfo.size);
-    m_device.unmapMemory(stagingBufferMemory);
+    memcpy(stagingAllocation.mappedData, createInfo.data->get(),
+           createInfo.size);
 
     // Create buffer in device local memory
-    std::tie(m_buffer, m_deviceMemory) =
+    std::tie(m_buffer, m_allocation) =
         createBuffer(device, createInfo.size,
                      createInfo.usage | vk::BufferUsageFlagBits::eTransferDst,
                      vk::MemoryPropertyFlagBits::eDeviceLocal);
@@ -59,32 +58,47 @@ void abcg::VulkanBuffer::create(VulkanDevice const &device,
 
     // Release staging buffer
     m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+    m_allocator->free(stagingAllocation);
   }
 }
 
 void abcg::VulkanBuffer::destroy() {
   m_device.destroyBuffer(m_buffer);
-  m_device.freeMemory(m_deviceMemory);
+  if (m_allocator != nullptr) {
+    m_allocator->free(m_allocation);
+  }
 }
 
 /**
  * @brief Loads data to the buffer.
  *
+ * The buffer memory must be host visible. It is mapped for the lifetime of the
+ * buffer.
+ *
  * @param data Pointer to the beginning of the data.
  * @param size Size of the data fo the copied, in bytes.
  * @param offset Offset from the beginning of the buffer memory.
+ *
+ * @throw abcg::RuntimeError if the buffer memory is not host visible, or if
+ * the range is out of the buffer memory.
  */
 void abcg::VulkanBuffer::loadData(gsl::not_null<void const *> data,
                                   vk::DeviceSize size, vk::DeviceSize offset) {
+  if (m_allocation.mappedData == nullptr) {
+    throw abcg::RuntimeError("Buffer memory is not host visible");
+  }
+  if (offset > m_allocation.size || size > m_allocation.size - offset) {
+    throw abcg::RuntimeError("Data range is out of the buffer memory");
+  }
+
   // Transfer of data to the GPU will happen in the background before the next
   // call to vkQueueSubmit
-  auto *mappedData{m_device.mapMemory(m_deviceMemory, offset, size)};
-  memcpy(mappedData, data, size);
-  m_device.unmapMemory(m_deviceMemory);
+  memcpy(static_cast<std::byte *>(m_allocation.mappedData) + offset, data,
+         size);
+  m_allocator->flush(m_allocation, offset, size);
 }
 
-std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
+std::pair<vk::Buffer, abcg::VulkanAllocation> abcg::VulkanBuffer::createBuffer(
     VulkanDevice const &device, vk::DeviceSize size, vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties) const {
   auto const &physicalDevice{device.getPhysicalDevice()};
@@ -115,19 +129,19 @@ std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
   auto const memoryRequirements{m_device.getBufferMemoryRequirements(buffer)};
 
   // Allocate buffer memory
-  auto const memoryType{physicalDevice.findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
+  VulkanAllocation allocation;
+  try {
+    allocation = device.getAllocator().allocate(memoryRequirements, properties,
+                                                true);
+  } catch (...) {
+    m_device.destroyBuffer(buffer);
+    throw;
   }
-  auto bufferMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
 
   // Associate buffer memory to buffer
-  m_device.bindBufferMemory(buffer, bufferMemory, 0);
+  m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
 
-  return {buffer, bufferMemory};
+  return {buffer, allocation};
 }
 
 /**
@@ -141,8 +155,25 @@ abcg::VulkanBuffer::operator vk::Buffer const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with the buffer.
  *
+ * The device memory object may be shared with other resources.
+ *
+ * @sa abcg::VulkanBuffer::getAllocation.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanBuffer::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the range of device memory associated with the buffer.
+ *
+ * The device memory object is shared with other resources, so the buffer
+ * memory starts at abcg::VulkanAllocation::offset.
+ *
+ * @return Allocation of the buffer memory.
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanBuffer::getAllocation() const noexcept {
+  return m_allocation;
 }
\ No newline at end of file
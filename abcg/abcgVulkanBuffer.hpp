@@ -36,7 +36,9 @@ struct abcg::VulkanBufferCreateInfo {
  * @brief A class for representing a Vulkan buffer.
  *
  * This class provides helper functions for creating and managing vk::Buffer
- * objects.
+ * objects. The memory of the buffer is a range of a device memory object
+ * shared with other resources, allocated by the abcg::VulkanAllocator of the
+ * device.
  */
 class abcg::VulkanBuffer {
 public:
@@ -49,15 +51,17 @@ public:
   explicit operator vk::Buffer const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Buffer, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Buffer, VulkanAllocation>
   createBuffer(VulkanDevice const &device, vk::DeviceSize size,
                vk::BufferUsageFlags usage,
                vk::MemoryPropertyFlags properties) const;
 
   vk::Buffer m_buffer;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
   vk::Device m_device;
 };
 
@@ -66,9 +66,14 @@ void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
   }
 
   createCommandPools();
+
+  m_allocator = std::make_shared<VulkanAllocator>();
+  m_allocator->create(m_device, m_physicalDevice);
 }
 
 void abcg::VulkanDevice::destroy() {
+  m_allocator->destroy();
+  m_allocator.reset();
   destroyCommandPools();
   m_device.destroy();
 }
@@ -109,6 +114,40 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
   return m_commandPools;
 }
 
+/**
+ * @brief Returns the memory allocator of this device.
+ *
+ * @return Allocator used by abcg::VulkanBuffer and abcg::VulkanImage.
+ */
+abcg::VulkanAllocator &abcg::VulkanDevice::getAllocator() const noexcept {
+  return *m_allocator;
+}
+
+/**
+ * @brief Returns the default pipeline cache of this device.
+ *
+ * @return Pipeline cache used by abcg::VulkanPipeline::create when
+ * abcg::VulkanPipelineCreateInfo::pipelineCache is null. May be null.
+ */
+vk::PipelineCache const &abcg::VulkanDevice::getPipelineCache() const noexcept {
+  return m_pipelineCache;
+}
+
+/**
+ * @brief Sets the default pipeline cache of this device.
+ *
+ * The device does not own the pipeline cache. abcg::VulkanWindow sets its own
+ * cache before creating the swapchain, so that every copy of the device made
+ * afterwards refers to it.
+ *
+ * @param pipelineCache Pipeline cache, or a null handle to create pipelines
+ * without a cache.
+ */
+void abcg::VulkanDevice::setPipelineCache(
+    vk::PipelineCache pipelineCache) noexcept {
+  m_pipelineCache = pipelineCache;
+}
+
 /**
  * @brief Allocates and creates a command buffer to be immediately submitted and
  * released.
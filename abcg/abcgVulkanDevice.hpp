@@ -13,9 +13,11 @@
 #ifndef ABCG_VULKAN_DEVICE_HPP_
 #define ABCG_VULKAN_DEVICE_HPP_
 
+#include "abcgVulkanAllocator.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
 
 #include <functional>
+#include <memory>
 
 namespace abcg {
 struct VulkanCommandPools;
@@ -50,7 +52,8 @@ struct abcg::VulkanQueues {
  * resources.
  *
  * This class creates and manages the Vulkan logical device, queues, descriptor
- * pool, and command pools.
+ * pool, command pools, and the memory allocator. Copies of a device share the
+ * same allocator.
  */
 class abcg::VulkanDevice {
 public:
@@ -63,6 +66,9 @@ public:
   [[nodiscard]] VulkanPhysicalDevice const &getPhysicalDevice() const noexcept;
   [[nodiscard]] VulkanQueues const &getQueues() const noexcept;
   [[nodiscard]] VulkanCommandPools const &getCommandPools() const noexcept;
+  [[nodiscard]] VulkanAllocator &getAllocator() const noexcept;
+  [[nodiscard]] vk::PipelineCache const &getPipelineCache() const noexcept;
+  void setPipelineCache(vk::PipelineCache pipelineCache) noexcept;
 
   void withCommandBuffer(
       std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
@@ -77,6 +83,8 @@ private:
   VulkanPhysicalDevice m_physicalDevice;
   VulkanCommandPools m_commandPools;
   VulkanQueues m_queues;
+  std::shared_ptr<VulkanAllocator> m_allocator;
+  vk::PipelineCache m_pipelineCache;
 };
 
 #endif
\ No newline at end of file
@@ -21,6 +21,7 @@
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                std::string_view path, bool generateMipmaps) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
   // Load the bitmap
   if (SDL_Surface *const surface{IMG_Load(path.data())}) {
@@ -55,7 +56,7 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
     auto const imageFormat{vk::Format::eR8G8B8A8Srgb};
 
     // Create image buffer
-    std::tie(m_image, m_deviceMemory) = createImage(
+    std::tie(m_image, m_allocation) = createImage(
         device,
         {.imageType = vk::ImageType::e2D,
          .format = imageFormat,
@@ -160,10 +161,11 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                VulkanImageCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
   // Create image only if createInfo.viewInfo.image is undefined
   if (!createInfo.viewInfo.image) {
-    std::tie(m_image, m_deviceMemory) =
+    std::tie(m_image, m_allocation) =
         createImage(device, createInfo.info, createInfo.properties);
   }
 
@@ -185,8 +187,8 @@ void abcg::VulkanImage::destroy() {
   if (m_image) {
     m_device.destroyImage(m_image);
   }
-  if (m_deviceMemory) {
-    m_device.freeMemory(m_deviceMemory);
+  if (m_allocation) {
+    m_allocator->free(m_allocation);
   }
 }
 
@@ -201,10 +203,25 @@ abcg::VulkanImage::operator vk::Image const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with this image.
  *
+ * The device memory object may be shared with other resources.
+ *
+ * @sa abcg::VulkanImage::getAllocation.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanImage::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the range of device memory associated with this image.
+ *
+ * @return Allocation of the image memory. Invalid if the image was not
+ * created by this object.
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanImage::getAllocation() const noexcept {
+  return m_allocation;
 }
 
 /**
@@ -241,7 +258,7 @@ uint32_t abcg::VulkanImage::getMipLevels() const noexcept {
   return m_mipLevels;
 }
 
-std::pair<vk::Image, vk::DeviceMemory>
+std::pair<vk::Image, abcg::VulkanAllocation>
 abcg::VulkanImage::createImage(VulkanDevice const &device,
                                vk::ImageCreateInfo const &imageInfo,
                                vk::MemoryPropertyFlags properties) const {
@@ -251,20 +268,22 @@ abcg::VulkanImage::createImage(VulkanDevice const &device,
   // Get memory requirements
   auto const memoryRequirements{m_device.getImageMemoryRequirements(image)};
 
-  // Allocate image memory
-  auto const memoryType{device.getPhysicalDevice().findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
+  // Allocate image memory. Images with linear tiling can share pages with
+  // buffers
+  VulkanAllocation allocation;
+  try {
+    allocation = device.getAllocator().allocate(
+        memoryRequirements, properties,
+        imageInfo.tiling == vk::ImageTiling::eLinear);
+  } catch (...) {
+    m_device.destroyImage(image);
+    throw;
   }
-  auto imageMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
 
   // Associate image memory to image
-  m_device.bindImageMemory(image, imageMemory, 0);
+  m_device.bindImageMemory(image, allocation.memory, allocation.offset);
 
-  return {image, imageMemory};
+  return {image, allocation};
 }
 
 void abcg::VulkanImage::transitionImageLayout(
@@ -48,13 +48,14 @@ public:
   explicit operator vk::Image const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
   [[nodiscard]] vk::ImageView const &getView() const noexcept;
   [[nodiscard]] vk::DescriptorImageInfo const &
   getDescriptorImageInfo() const noexcept;
   [[nodiscard]] uint32_t getMipLevels() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Image, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Image, VulkanAllocation>
   createImage(VulkanDevice const &device, vk::ImageCreateInfo const &imageInfo,
               vk::MemoryPropertyFlags properties) const;
   void transitionImageLayout(VulkanDevice const &device,
@@ -70,7 +71,8 @@ private:
                             uint32_t texHeight, uint32_t mipLevels);
 
   vk::Image m_image;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
   vk::ImageView m_imageView;
   vk::Sampler m_sampler;
   vk::DescriptorImageInfo m_descriptorImageInfo;
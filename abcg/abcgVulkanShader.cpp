@@ -18,8 +18,18 @@
 
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 namespace {
+// SPIR-V of the shaders compiled at run time, by stage and full source code.
+// Shared by all devices, as SPIR-V does not depend on them
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::mutex spirvCacheMutex;
+std::unordered_map<std::string, std::vector<uint32_t>>
+    spirvCache; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
 TBuiltInResource InitResources() {
   TBuiltInResource Resources{
       .maxLights = 32,
@@ -252,6 +262,41 @@ abcgStageToVulkanStage(abcg::ShaderStage stage) {
   }
   return source.str();
 }
+
+// Reads the SPIR-V compiled at build time from a shader file (see
+// compile_abcg_shaders in ABCg.cmake), i.e., the file with the same name
+// followed by `.spv`. Returns std::nullopt if there is no such file or if it is
+// not valid SPIR-V. File times are not compared, as assets are copied to the
+// output directory without preserving them; the build recompiles the SPIR-V
+// whenever the shader changes
+[[nodiscard]] std::optional<std::vector<uint32_t>>
+readPrebuiltSPIRV(std::string_view path) {
+  static const std::size_t maxPathSize{260};
+  if (path.size() > maxPathSize) {
+    return std::nullopt;
+  }
+
+  auto spirvPath{std::filesystem::path{path}};
+  spirvPath += ".spv";
+  std::ifstream stream(spirvPath, std::ios::binary | std::ios::ate);
+  if (!stream) {
+    return std::nullopt;
+  }
+  auto const size{static_cast<std::size_t>(stream.tellg())};
+  if (size == 0 || size % sizeof(uint32_t) != 0) {
+    return std::nullopt;
+  }
+  std::vector<uint32_t> code(size / sizeof(uint32_t));
+  stream.seekg(0);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  stream.read(reinterpret_cast<char *>(code.data()),
+              gsl::narrow<std::streamsize>(size));
+  static constexpr uint32_t spirvMagic{0x07230203};
+  if (!stream || code.front() != spirvMagic) {
+    return std::nullopt;
+  }
+  return code;
+}
 } // namespace
 
 // Compiles the given GLSL shader source into Vulkan SPIR-V.
@@ -301,9 +346,46 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   return outCode;
 }
 
+namespace {
+// Compiles a shader with glslang, unless it has already been compiled in this
+// process
+[[nodiscard]] std::vector<uint32_t>
+compileSPIRV(abcg::ShaderSource const &pathOrSource) {
+  abcg::ShaderSource const source{
+      .source = abcg::addShaderDefines(toSource(pathOrSource.source),
+                                       pathOrSource.defines),
+      .stage = pathOrSource.stage};
+
+  auto key{fmt::format("{}:", static_cast<int>(source.stage))};
+  key += source.source;
+  {
+    std::scoped_lock const lock{spirvCacheMutex};
+    if (auto const iter{spirvCache.find(key)}; iter != spirvCache.end()) {
+      return iter->second;
+    }
+  }
+
+  glslang::InitializeProcess();
+  auto const finalize{gsl::finally([] { glslang::FinalizeProcess(); })};
+  auto shader{GLSLtoSPV(source)};
+
+  std::scoped_lock const lock{spirvCacheMutex};
+  spirvCache.try_emplace(std::move(key), shader);
+  return shader;
+}
+} // namespace
+
 /**
  * @brief Compiles a GLSL shader to SPIR-V and creates its module.
  *
+ * If @a pathOrSource is the path of a shader file without definitions, and the
+ * SPIR-V of the file was compiled at build time by `compile_abcg_shaders`
+ * (i.e., there is a file with the same name followed by `.spv`), the SPIR-V is
+ * loaded from that file and glslang is not used. Otherwise, the shader is
+ * compiled with glslang. The SPIR-V of shaders compiled at run time is kept in
+ * memory, keyed by the stage and the full source code, so each shader is
+ * compiled at most once per process.
+ *
  * @param device Vulkan device to be used to create the shader module.
  * @param pathOrSource Path or source code of the GLSL shader to be compiled to
  * SPIR-V.
@@ -314,14 +396,18 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
 void abcg::VulkanShader::create(VulkanDevice const &device,
                                 ShaderSource const &pathOrSource) {
   m_device = static_cast<vk::Device>(device);
+  m_stage = abcgStageToVulkanStage(pathOrSource.stage);
 
-  ShaderSource const source{.source = toSource(pathOrSource.source),
-                            .stage = pathOrSource.stage};
-
-  glslang::InitializeProcess();
-  std::vector<uint32_t> shader{GLSLtoSPV(source)};
-  m_stage = abcgStageToVulkanStage(source.stage);
-  glslang::FinalizeProcess();
+  // Definitions are only known at run time
+  std::vector<uint32_t> shader;
+  if (pathOrSource.defines.empty()) {
+    if (auto prebuilt{readPrebuiltSPIRV(pathOrSource.source)}) {
+      shader = std::move(*prebuilt);
+    }
+  }
+  if (shader.empty()) {
+    shader = compileSPIRV(pathOrSource);
+  }
 
   m_module = m_device.createShaderModule(
       {.codeSize = shader.size() * sizeof(uint32_t), .pCode = shader.data()});
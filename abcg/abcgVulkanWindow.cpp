@@ -12,12 +12,18 @@
 
 #include <SDL_vulkan.h>
 #include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <gsl/gsl>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_vulkan.h>
+#include <memory>
+#include <span>
 
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgUtil.hpp"
 #include "abcgVulkanError.hpp"
 #include "abcgVulkanInstance.hpp"
 #include "abcgWindow.hpp"
@@ -57,6 +63,113 @@ getRequiredExtensions(gsl::not_null<SDL_Window *> window) {
 }
 
 void checkVkResultSingleArg(VkResult retCode) { abcg::checkVkResult(retCode); }
+
+// Header of a pipeline cache file. The data of the pipeline cache follows the
+// header, and is checked against its size and hash before being passed to the
+// driver
+struct PipelineCacheFileHeader {
+  static constexpr std::array<char, 4> expectedMagic{'A', 'B', 'P', 'C'};
+  static constexpr std::uint32_t currentVersion{1};
+
+  std::array<char, 4> magic{expectedMagic};
+  std::uint32_t version{currentVersion};
+  std::uint64_t size{};
+  std::uint64_t hash{};
+};
+
+// Size of the header of version one of the data of a pipeline cache:
+// headerSize, headerVersion, vendorID and deviceID (32-bit each), followed by
+// pipelineCacheUUID
+constexpr std::size_t pipelineCacheHeaderSize{4 * sizeof(std::uint32_t) +
+                                              VK_UUID_SIZE};
+
+// Whether the data of a pipeline cache was created by the given physical
+// device. Drivers must reject incompatible data, but some crash instead, so it
+// is checked up front
+[[nodiscard]] bool
+isPipelineCacheCompatible(std::span<std::byte const> data,
+                          vk::PhysicalDeviceProperties const &properties) {
+  if (data.size() < pipelineCacheHeaderSize) {
+    return false;
+  }
+  std::array<std::uint32_t, 4> fields{};
+  std::memcpy(fields.data(), data.data(), sizeof(fields));
+  auto const [headerSize, headerVersion, vendorID, deviceID]{fields};
+  return headerSize >= pipelineCacheHeaderSize &&
+         headerSize <= data.size() &&
+         headerVersion ==
+             static_cast<std::uint32_t>(VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+         vendorID == properties.vendorID && deviceID == properties.deviceID &&
+         std::memcmp(data.data() + sizeof(fields),
+                     properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+// Returns the data of a pipeline cache file, or no data if the file does not
+// exist, is corrupted, or was created by another device or driver version
+[[nodiscard]] std::vector<std::byte>
+readPipelineCache(std::filesystem::path const &path,
+                  vk::PhysicalDeviceProperties const &properties) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream) {
+    return {};
+  }
+
+  PipelineCacheFileHeader header{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  std::error_code error;
+  auto const fileSize{std::filesystem::file_size(path, error)};
+  if (!stream || error ||
+      header.magic != PipelineCacheFileHeader::expectedMagic ||
+      header.version != PipelineCacheFileHeader::currentVersion ||
+      header.size != fileSize - sizeof(header)) {
+    return {};
+  }
+
+  std::vector<std::byte> data(gsl::narrow<std::size_t>(header.size));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  stream.read(reinterpret_cast<char *>(data.data()),
+              gsl::narrow<std::streamsize>(data.size()));
+  if (!stream || abcg::hashBytes(data) != header.hash ||
+      !isPipelineCacheCompatible(data, properties)) {
+    return {};
+  }
+  return data;
+}
+
+// Writes the data of a pipeline cache. The cache is only an optimization, so
+// failures are reported but not thrown
+void writePipelineCache(std::filesystem::path const &path,
+                        std::span<std::byte const> data, std::uint64_t hash) {
+  PipelineCacheFileHeader const header{.size = data.size(), .hash = hash};
+
+  // Writes to a temporary file that is then renamed, so that other processes
+  // never read a partial cache
+  auto temporary{path};
+  temporary += ".tmp";
+  std::error_code error;
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), error);
+  }
+  {
+    std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<char const *>(data.data()),
+                 gsl::narrow<std::streamsize>(data.size()));
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!stream.flush()) {
+      error = std::make_error_code(std::errc::io_error);
+    }
+  }
+  if (!error) {
+    std::filesystem::rename(temporary, path, error);
+  }
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    fmt::print("Warning: failed to write pipeline cache {}\n", path.string());
+  }
+}
 } // namespace
 
 /**
@@ -304,6 +417,10 @@ void abcg::VulkanWindow::create() {
   // Create logical device
   m_device.create(m_physicalDevice, m_deviceExtensions);
 
+  // Create pipeline cache. It must be set before the swapchain and the
+  // pipelines get their copies of the device
+  createPipelineCache();
+
   // Create swapchain
   m_swapchain.create(m_device, m_vulkanSettings, getWindowSize());
 
@@ -352,7 +469,7 @@ void abcg::VulkanWindow::create() {
       .Device = static_cast<vk::Device>(m_device),
       .QueueFamily = m_physicalDevice.getQueuesFamilies().graphics.value_or(0),
       .Queue = m_device.getQueues().graphics,
-      .PipelineCache = VK_NULL_HANDLE,
+      .PipelineCache = m_pipelineCache,
       .DescriptorPool = m_UIdescriptorPool,
       .Subpass = 0,
       .MinImageCount = 2,
@@ -434,6 +551,7 @@ void abcg::VulkanWindow::destroy() {
 
   static_cast<vk::Device>(m_device).destroyDescriptorPool(m_UIdescriptorPool);
   m_swapchain.destroy();
+  destroyPipelineCache();
   m_device.destroy();
   m_physicalDevice.destroy();
   static_cast<vk::Instance>(m_instance).destroySurfaceKHR(m_surface);
@@ -447,4 +565,57 @@ glm::ivec2 abcg::VulkanWindow::getWindowSize() const {
     SDL_Vulkan_GetDrawableSize(window, &size.x, &size.y);
   }
   return size;
-}
\ No newline at end of file
+}
+
+std::string abcg::VulkanWindow::getPipelineCachePath() const {
+  if (!m_vulkanSettings.pipelineCachePath.empty()) {
+    return m_vulkanSettings.pipelineCachePath;
+  }
+
+  auto const &title{abcg::Window::getWindowSettings().title};
+  std::unique_ptr<char, decltype(&SDL_free)> const prefPath{
+      SDL_GetPrefPath("abcg", title.c_str()), SDL_free};
+  if (!prefPath) {
+    return {};
+  }
+  return std::string{prefPath.get()} + "pipeline_cache.bin";
+}
+
+void abcg::VulkanWindow::createPipelineCache() {
+  std::vector<std::byte> data;
+  if (m_vulkanSettings.persistentPipelineCache) {
+    if (auto const path{getPipelineCachePath()}; !path.empty()) {
+      auto const properties{
+          static_cast<vk::PhysicalDevice>(m_physicalDevice).getProperties()};
+      data = readPipelineCache(path, properties);
+    }
+  }
+  m_pipelineCacheHash = data.empty() ? 0 : abcg::hashBytes(data);
+
+  m_pipelineCache = static_cast<vk::Device>(m_device).createPipelineCache(
+      {.initialDataSize = data.size(), .pInitialData = data.data()});
+  m_device.setPipelineCache(m_pipelineCache);
+}
+
+void abcg::VulkanWindow::destroyPipelineCache() {
+  if (!m_pipelineCache) {
+    return;
+  }
+
+  auto const device{static_cast<vk::Device>(m_device)};
+  if (m_vulkanSettings.persistentPipelineCache) {
+    auto const data{device.getPipelineCacheData(m_pipelineCache)};
+    auto const bytes{std::as_bytes(std::span{data})};
+    // Skips the write if no pipeline was added to the cache
+    if (auto const hash{abcg::hashBytes(bytes)};
+        !bytes.empty() && hash != m_pipelineCacheHash) {
+      if (auto const path{getPipelineCachePath()}; !path.empty()) {
+        writePipelineCache(path, bytes, hash);
+      }
+    }
+  }
+
+  device.destroyPipelineCache(m_pipelineCache);
+  m_device.setPipelineCache({});
+  m_pipelineCache = vk::PipelineCache{};
+}
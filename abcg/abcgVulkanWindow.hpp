@@ -57,6 +57,21 @@ struct abcg::VulkanSettings {
    * comes first.
    */
   bool vSync{false};
+
+  /** @brief Path of the file of the pipeline cache.
+   *
+   * The pipeline cache is loaded from this file when the window is created,
+   * used by default by every abcg::VulkanPipeline, and written back when the
+   * window is destroyed. If empty, the file `pipeline_cache.bin` is stored in
+   * the preference directory of the application returned by `SDL_GetPrefPath`.
+   */
+  std::string pipelineCachePath{};
+
+  /** @brief Whether to load and save the pipeline cache.
+   *
+   * If `false`, the pipeline cache is kept only in memory.
+   */
+  bool persistentPipelineCache{true};
 };
 
 /**
@@ -100,6 +115,9 @@ private:
   void paint() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
+  [[nodiscard]] std::string getPipelineCachePath() const;
+  void createPipelineCache();
+  void destroyPipelineCache();
 
   VulkanSettings m_vulkanSettings;
   std::vector<char const *> m_deviceExtensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -115,6 +133,8 @@ private:
   VulkanSwapchain m_swapchain;
   vk::SurfaceKHR m_surface;
   vk::DescriptorPool m_UIdescriptorPool;
+  vk::PipelineCache m_pipelineCache;
+  std::uint64_t m_pipelineCacheHash{};
   bool m_hidden{};
   bool m_minimized{};
 };
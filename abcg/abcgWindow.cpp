@@ -14,6 +14,11 @@
 
 #include <imgui_impl_sdl2.h>
 
+#include <algorithm>
+#include <thread>
+
+#include "abcgProfiler.hpp"
+
 namespace {
 ImVec4 ColorAlpha(ImVec4 const &color, float const alpha) {
   return {color.x, color.y, color.z, alpha};
@@ -265,6 +270,17 @@ bool abcg::Window::createSDLWindow(SDL_WindowFlags extraFlags) {
   return true;
 }
 
+/**
+ * @brief Requests the window to be repainted in the next frame.
+ *
+ * This only has an effect if abcg::WindowSettings::renderOnDemand is `true`.
+ * Call it every frame while an animation is running, e.g., from
+ * abcg::OpenGLWindow::onUpdate.
+ */
+void abcg::Window::requestRepaint() noexcept {
+  m_pendingRepaints = std::max(m_pendingRepaints, 1);
+}
+
 /**
  * @brief Toggles the resizing event watcher on/off.
  *
@@ -315,8 +331,14 @@ void abcg::Window::toggleFullscreen() {
 }
 
 void abcg::Window::templateHandleEvent(SDL_Event const &event, bool &done) {
+  if (isHeadless())
+    return;
+
   ImGui_ImplSDL2_ProcessEvent(&event);
 
+  // Dear ImGui may need a couple of frames to settle after an input event
+  m_pendingRepaints = 3;
+
   if (event.window.windowID != m_windowID)
     return;
 
@@ -383,6 +405,8 @@ void abcg::Window::templateHandleEvent(SDL_Event const &event, bool &done) {
 void abcg::Window::templateCreate() {
   m_deltaTime.restart();
   m_elapsedTime.restart();
+  m_nextFrameTime = std::chrono::steady_clock::now();
+  m_pendingRepaints = 1;
 
   create();
 
@@ -391,22 +415,83 @@ void abcg::Window::templateCreate() {
 }
 
 void abcg::Window::templatePaint() {
-  // Cap to 480 Hz
-  if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
+  if (isIdle()) {
+    m_idle = true;
+    return;
+  }
+
+  // Do not count the time spent idle as frame time
+  if (m_idle) {
+    m_idle = false;
+    m_deltaTime.restart();
+    m_nextFrameTime = std::chrono::steady_clock::now();
+  }
+
+  // Headless windows advance by a fixed step so that runs are reproducible
+  if (isHeadless()) {
+    m_lastDeltaTime = 1.0 / (m_windowSettings.maxFrameRate > 0.0
+                                 ? m_windowSettings.maxFrameRate
+                                 : 60.0);
+  } else if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
+    // Cap to 480 Hz
     m_lastDeltaTime = m_deltaTime.restart();
   } else {
     m_lastDeltaTime = 0.0;
   }
 
+  // Decremented before painting so that repaints requested during this frame
+  // are honored in the next one
+  if (m_pendingRepaints > 0)
+    --m_pendingRepaints;
+
+  ProfilerZone zone{"Frame"};
   paint();
 }
 
+// Waits until the next frame is due according to
+// abcg::WindowSettings::maxFrameRate. Sleeps for most of the interval, as
+// sleeping is imprecise, and yields in a loop for the remaining time
+void abcg::Window::templateWaitFrame() {
+  // Headless windows render as fast as possible
+  if (m_windowSettings.maxFrameRate <= 0.0 || m_idle || isHeadless())
+    return;
+
+  using clock = std::chrono::steady_clock;
+  auto const period{std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(1.0 / m_windowSettings.maxFrameRate))};
+  auto const now{clock::now()};
+
+  m_nextFrameTime += period;
+  if (m_nextFrameTime <= now) {
+    // Running late: resynchronize instead of trying to catch up
+    m_nextFrameTime = now;
+    return;
+  }
+
+  ProfilerZone zone{"Wait"};
+  auto const spinTime{std::chrono::milliseconds(2)};
+  if (auto const remaining{m_nextFrameTime - now}; remaining > spinTime) {
+    std::this_thread::sleep_for(remaining - spinTime);
+  }
+  while (clock::now() < m_nextFrameTime) {
+    std::this_thread::yield();
+  }
+}
+
+bool abcg::Window::isIdle() const noexcept {
+  return m_windowSettings.renderOnDemand && m_pendingRepaints == 0 &&
+         !isHeadless();
+}
+
 void abcg::Window::templateDestroy() {
-  if (m_window == nullptr)
+  if (m_window == nullptr && !isHeadless())
     return;
 
   destroy();
 
+  if (m_window == nullptr)
+    return;
+
   SDL_DestroyWindow(m_window);
   m_window = nullptr;
   m_windowID = 0;
@@ -13,6 +13,7 @@
 #ifndef ABCG_WINDOW_HPP_
 #define ABCG_WINDOW_HPP_
 
+#include <chrono>
 #include <string>
 
 #include "abcgExternal.hpp"
@@ -62,6 +63,23 @@ struct abcg::WindowSettings {
   bool showFPS{true};
   /** @brief Whether to show a button to toggle fullscreen on/off. */
   bool showFullscreenButton{true};
+  /** @brief Maximum number of frames per second.
+   *
+   * If greater than zero, the main loop sleeps between frames so that the
+   * window is repainted at most at this rate. A value of zero disables the
+   * limiter.
+   *
+   * @remark This is ignored when the application is built for WebAssembly, as
+   * the browser already paces the main loop.
+   */
+  double maxFrameRate{0.0};
+  /** @brief Whether to repaint the window only when needed.
+   *
+   * If `true`, the window is repainted only for a few frames after each event,
+   * or in the next frame after a call to abcg::Window::requestRepaint. In the
+   * meantime, the main loop blocks waiting for events.
+   */
+  bool renderOnDemand{false};
   /** @brief HTML element ID used for registering the fullscreen callback when
    * the application is built for WebAssembly.
    */
@@ -152,11 +170,23 @@ protected:
    */
   [[nodiscard]] virtual glm::ivec2 getWindowSize() const = 0;
 
+  /**
+   * @brief Returns whether the window renders offscreen, without a SDL
+   * window.
+   *
+   * Headless windows do not receive events and use a fixed delta time.
+   *
+   * @returns `false` by default.
+   */
+  [[nodiscard]] virtual bool isHeadless() const noexcept { return false; }
+
   [[nodiscard]] double getDeltaTime() const noexcept;
   [[nodiscard]] double getElapsedTime() const;
   [[nodiscard]] SDL_Window *getSDLWindow() const noexcept;
   [[nodiscard]] Uint32 getSDLWindowID() const noexcept;
 
+  void requestRepaint() noexcept;
+
   bool createSDLWindow(SDL_WindowFlags extraFlags);
   void setEnableResizingEventWatcher(bool enabled) noexcept;
   void toggleFullscreen();
@@ -165,7 +195,9 @@ private:
   void templateHandleEvent(SDL_Event const &event, bool &done);
   void templateCreate();
   void templatePaint();
+  void templateWaitFrame();
   void templateDestroy();
+  [[nodiscard]] bool isIdle() const noexcept;
 
   SDL_Window *m_window{};
   Uint32 m_windowID{};
@@ -176,6 +208,12 @@ private:
   Timer m_elapsedTime;
   double m_lastDeltaTime{};
 
+  // Number of frames still to be painted in on-demand rendering mode
+  int m_pendingRepaints{};
+  // Whether the last frame was skipped in on-demand rendering mode
+  bool m_idle{};
+  std::chrono::steady_clock::time_point m_nextFrameTime{};
+
   bool m_enableResizingEventWatcher{true};
 
   friend Application;
@@ -178,3 +178,64 @@ function(enable_abcg project_target)
   endif()
 
 endfunction()
+
+# Compiles GLSL shaders to SPIR-V at build time when the Vulkan backend is
+# used. Each shader (e.g., assets/shader.vert) is compiled to a file with the
+# same name followed by .spv (assets/shader.vert.spv), which
+# abcg::VulkanShader loads instead of compiling the shader at run time. The
+# shaders can be passed after the target; by default, all shaders in the assets
+# directory of the target are compiled.
+function(compile_abcg_shaders project_target)
+
+  if(NOT ${GRAPHICS_API} MATCHES "Vulkan")
+    return()
+  endif()
+
+  if(TARGET glslangValidator)
+    set(glslang_validator $<TARGET_FILE:glslangValidator>)
+  else()
+    find_program(glslang_validator glslangValidator
+                 HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+    if(NOT glslang_validator)
+      message(WARNING "glslangValidator not found; the shaders of "
+                      "${project_target} will be compiled at run time")
+      return()
+    endif()
+  endif()
+
+  if(ARGC GREATER 1)
+    set(shaders ${ARGN})
+  else()
+    set(shaders "")
+    foreach(extension vert tesc tese geom frag comp rgen rint rahit rchit
+                      rmiss rcall)
+      file(GLOB extension_shaders CONFIGURE_DEPENDS
+           ${CMAKE_CURRENT_SOURCE_DIR}/assets/*.${extension})
+      list(APPEND shaders ${extension_shaders})
+    endforeach()
+  endif()
+
+  set(spirv_files "")
+  foreach(shader ${shaders})
+    get_filename_component(input ${shader} ABSOLUTE)
+    get_filename_component(name ${shader} NAME)
+    set(output ${input}.spv)
+    # The stage is deduced from the extension, and the SPIR-V is the same as
+    # the one produced at run time: Vulkan rules and default resource limits
+    add_custom_command(
+      OUTPUT ${output}
+      COMMAND ${glslang_validator} -V -o ${output} ${input}
+      DEPENDS ${input} $<$<TARGET_EXISTS:glslangValidator>:glslangValidator>
+      COMMENT "Compiling ${name} to SPIR-V"
+      VERBATIM)
+    list(APPEND spirv_files ${output})
+  endforeach()
+
+  if(spirv_files)
+    # The SPIR-V files are generated next to the shaders, so they are copied
+    # with the assets by enable_abcg
+    add_custom_target(${project_target}_shaders DEPENDS ${spirv_files})
+    add_dependencies(${project_target} ${project_target}_shaders)
+  endif()
+
+endfunction()
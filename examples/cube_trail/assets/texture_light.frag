@@ -1,28 +1,37 @@
-#version 300 es
-
-precision mediump float;
-
-in vec3 fragPosition;
-in vec3 fragNormal;
-in vec2 fragTexCoord;
-
-out vec4 outColor;
-
-uniform sampler2D tex;
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-uniform vec3 ambientColor;
-
-void main() {
-  // Normaliza a normal
-  vec3 N = normalize(fragNormal);
-  vec3 L = normalize(-lightDir); // Direção da luz (inversa do lightDir se o lightDir aponta de onde a luz vem)
-  
-  // Cálculo de Lambert
-  float diff = max(dot(N, L), 0.0);
-
-  vec3 color = texture(tex, fragTexCoord).rgb;
-  
-  vec3 finalColor = ambientColor * color + diff * lightColor * color;
-  outColor = vec4(finalColor, 1.0);
-}
+#version 300 es
+
+precision mediump float;
+
+in vec3 fragPosition;
+in vec3 fragNormal;
+in vec2 fragTexCoord;
+flat in float fragLayer; // Camada da textura (material)
+
+out vec4 outColor;
+
+// Todos os materiais ficam em camadas de uma mesma textura
+precision mediump sampler2DArray;
+uniform sampler2DArray tex;
+
+// Constantes por quadro compartilhadas por todos os programas (std140)
+layout(std140) uniform FrameData {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+  vec4 lightDir;     // xyz: direção da luz
+  vec4 lightColor;   // rgb: cor da luz
+  vec4 ambientColor; // rgb: iluminação ambiente
+};
+
+void main() {
+  // Normaliza a normal
+  vec3 N = normalize(fragNormal);
+  vec3 L = normalize(-lightDir.xyz); // Direção da luz (inversa do lightDir se o lightDir aponta de onde a luz vem)
+  
+  // Cálculo de Lambert
+  float diff = max(dot(N, L), 0.0);
+
+  vec3 color = texture(tex, vec3(fragTexCoord, fragLayer)).rgb;
+  
+  vec3 finalColor = ambientColor.rgb * color + diff * lightColor.rgb * color;
+  outColor = vec4(finalColor, 1.0);
+}
@@ -1,24 +1,54 @@
-#version 300 es
-
-precision mediump float;
-
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
-
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-
-out vec3 fragPosition;
-out vec3 fragNormal;
-out vec2 fragTexCoord;
-
-void main() {
-  vec4 worldPosition = modelMatrix * vec4(inPosition, 1.0);
-  fragPosition = vec3(worldPosition);
-  fragNormal = mat3(transpose(inverse(modelMatrix))) * inNormal;
-  fragTexCoord = inTexCoord;
-
-  gl_Position = projMatrix * viewMatrix * worldPosition;
-}
+#version 300 es
+
+precision mediump float;
+
+// Variantes (definidas pelo programa, não por branches no shader):
+//   INSTANCED: tiles do chão, com posição e camada por instância e escala
+//              uniforme (sem matriz de normal)
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+#if defined(INSTANCED)
+layout(location = 3) in vec2 inOffset; // Posição do tile no plano xz (por instância)
+layout(location = 4) in float inLayer; // Camada da textura do tile (por instância)
+#endif
+
+uniform mat4 modelMatrix;
+#if !defined(INSTANCED)
+uniform mat3 normalMatrix; // Inversa transposta de modelMatrix, calculada na CPU
+uniform float layer; // Camada da textura usada pelo objeto
+#endif
+
+// Constantes por quadro compartilhadas por todos os programas (std140)
+layout(std140) uniform FrameData {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+  vec4 lightDir;     // xyz: direção da luz
+  vec4 lightColor;   // rgb: cor da luz
+  vec4 ambientColor; // rgb: iluminação ambiente
+};
+
+out vec3 fragPosition;
+out vec3 fragNormal;
+out vec2 fragTexCoord;
+flat out float fragLayer;
+
+void main() {
+#if defined(INSTANCED)
+  vec4 worldPosition = modelMatrix * vec4(inPosition, 1.0) +
+                       vec4(inOffset.x, 0.0, inOffset.y, 0.0);
+  // Escala uniforme não altera a direção da normal (normalizada no fragment
+  // shader), então não há matriz de normal
+  fragNormal = inNormal;
+  fragLayer = inLayer;
+#else
+  vec4 worldPosition = modelMatrix * vec4(inPosition, 1.0);
+  fragNormal = normalMatrix * inNormal;
+  fragLayer = layer;
+#endif
+  fragPosition = vec3(worldPosition);
+  fragTexCoord = inTexCoord;
+
+  gl_Position = projMatrix * viewMatrix * worldPosition;
+}
@@ -5,21 +5,14 @@
 
 #include <GL/gl.h> // Para constantes como GL_LINE e GL_FILL
 
+#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
-#include <unordered_map>
 
-// Especialização explícita de std::hash para Vertex
+#include "mesh.hpp"
 
-template <> struct std::hash<Vertex> {
-  size_t operator()(const Vertex &vertex) const noexcept {
-    auto h1 = std::hash<glm::vec3>()(vertex.position);
-    auto h2 = std::hash<glm::vec3>()(vertex.normal);
-    auto h3 = std::hash<glm::vec2>()(vertex.texCoord);
-    return h1 ^ (h2 << 1) ^ (h3 << 2);
-  }
-};
-
-void Cube::createBuffers() {
+void Cube::createBuffers(MeshHeader const &header,
+                         std::span<std::byte const> vertexData,
+                         std::span<std::byte const> indexData) {
   // Deleta buffers anteriores
   abcg::glDeleteBuffers(1, &m_EBO);
   abcg::glDeleteBuffers(1, &m_VBO);
@@ -28,96 +21,73 @@ void Cube::createBuffers() {
   abcg::glGenBuffers(1, &m_VBO);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
   abcg::glBufferData(GL_ARRAY_BUFFER,
-                     sizeof(m_vertices.at(0)) * m_vertices.size(),
-                     m_vertices.data(), GL_STATIC_DRAW);
+                     gsl::narrow<GLsizeiptr>(vertexData.size()),
+                     vertexData.data(), GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  // EBO
+  // EBO, com os índices das arestas logo após os dos triângulos
   abcg::glGenBuffers(1, &m_EBO);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
   abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     sizeof(m_indices.at(0)) * m_indices.size(),
-                     m_indices.data(), GL_STATIC_DRAW);
+                     gsl::narrow<GLsizeiptr>(indexData.size()),
+                     indexData.data(), GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
 
-void Cube::loadObj(std::string_view path) {
-  tinyobj::ObjReader reader;
+  m_vertexFormat = header.vertexFormat;
+  m_indexType = header.indexSize == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT
+                                                          : GL_UNSIGNED_INT;
+  m_numIndices = gsl::narrow<GLsizei>(header.numIndices);
+  m_numEdgeIndices = gsl::narrow<GLsizei>(header.numEdgeIndices);
+  m_edgeIndicesOffset = std::size_t{header.numIndices} * header.indexSize;
+
+  // Posições quantizadas voltam às coordenadas do modelo pela matriz de
+  // modelo. A matriz de normal não muda, pois as normais não são quantizadas
+  // na caixa envolvente
+  m_dequantizeMatrix = glm::translate(glm::mat4{1.0f}, header.positionOffset) *
+                       glm::scale(glm::mat4{1.0f}, header.positionScale);
+}
 
-  if (!reader.ParseFromFile(path.data())) {
-    if (!reader.Error().empty()) {
-      throw abcg::RuntimeError(
-          fmt::format("Failed to load model {} ({})", path, reader.Error()));
+void Cube::loadObj(std::string_view path, VertexFormat format) {
+  abcg::ProfilerZone zone{"Cube::loadObj"};
+
+  // Usa a malha binária ao lado do .obj se ela estiver atualizada: o arquivo
+  // é mapeado em memória e enviado diretamente ao VBO/EBO, sem interpretação
+  auto const meshPath{getMeshPath(path)};
+  if (isMeshUpToDate(meshPath, path)) {
+    if (MeshFile file;
+        file.open(meshPath) && file.getHeader().vertexFormat == format) {
+      createBuffers(file.getHeader(), file.getVertexData(),
+                    file.getIndexData());
+      return;
     }
-    throw abcg::RuntimeError(fmt::format("Failed to load model {}", path));
-  }
-
-  if (!reader.Warning().empty()) {
-    fmt::print("Warning: {}\n", reader.Warning());
   }
 
-  auto const &attrib{reader.GetAttrib()};
-  auto const &shapes{reader.GetShapes()};
-
-  m_vertices.clear();
-  m_indices.clear();
-
-  // Um mapa key:value com key=Vertex e value=index
-  std::unordered_map<Vertex, GLuint> hash{};
-
-  // Loop sobre shapes
-  for (auto const &shape : shapes) {
-    for (auto const offset : iter::range(shape.mesh.indices.size())) {
-      auto const index{shape.mesh.indices.at(offset)};
-
-      // Posição
-      auto const startIndex{3 * index.vertex_index};
-      glm::vec3 position{attrib.vertices.at(startIndex + 0),
-                         attrib.vertices.at(startIndex + 1),
-                         attrib.vertices.at(startIndex + 2)};
-
-      // Normal
-      glm::vec3 normal{};
-      if (index.normal_index >= 0) {
-        auto const normalStartIndex{3 * index.normal_index};
-        normal = {attrib.normals.at(normalStartIndex + 0),
-                  attrib.normals.at(normalStartIndex + 1),
-                  attrib.normals.at(normalStartIndex + 2)};
-      }
-
-      // Coordenada de textura
-      glm::vec2 texCoord{};
-      if (index.texcoord_index >= 0) {
-        auto const texStartIndex{2 * index.texcoord_index};
-        texCoord = {attrib.texcoords.at(texStartIndex + 0),
-                    attrib.texcoords.at(texStartIndex + 1)};
-      }
-
-      Vertex const vertex{
-          .position = position, .normal = normal, .texCoord = texCoord};
-
-      // Se hash não contém este vértice
-      if (!hash.contains(vertex)) {
-        // Adiciona este índice (tamanho de m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Adiciona este vértice
-        m_vertices.push_back(vertex);
-      }
-
-      m_indices.push_back(hash[vertex]);
-    }
+  auto mesh{parseObj(path)};
+  optimizeMesh(mesh);
+  auto const encoded{encodeMesh(mesh, format)};
+  createBuffers(encoded.header, encoded.vertexData, encoded.indexData);
+
+#if !defined(__EMSCRIPTEN__)
+  // Grava a malha binária para as próximas execuções. Uma falha (por exemplo,
+  // diretório somente leitura) apenas mantém a leitura do .obj
+  try {
+    writeMesh(encoded, meshPath);
+  } catch (abcg::Exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
   }
-
-  createBuffers();
+#endif
 }
 
 void Cube::paintWireframe() {
   glBindVertexArray(m_VAO);
-  glDrawElements(GL_LINES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
+  glDrawElements(GL_LINES, m_numEdgeIndices, m_indexType,
+                 reinterpret_cast<void *>(m_edgeIndicesOffset));
   glBindVertexArray(0);
 }
 
 void Cube::paint() {
+  abcg::ProfilerZone zone{"Cube::paint"};
+
   // Configura as variáveis uniformes para o cubo
   m_positionMatrix = glm::translate(glm::mat4{1.0f}, m_position);
   m_modelMatrix = m_positionMatrix * m_animationMatrix;
@@ -135,13 +105,18 @@ void Cube::paint() {
 
   m_modelMatrix = glm::scale(m_modelMatrix, scaleVec);
 
-  abcg::glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, &m_modelMatrix[0][0]);
+  auto const modelMatrix{m_modelMatrix * m_dequantizeMatrix};
+  abcg::glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, &modelMatrix[0][0]);
+
+  // Matriz de normal calculada uma vez por objeto, e não por vértice
+  auto const normalMatrix{glm::inverseTranspose(glm::mat3{m_modelMatrix})};
+  abcg::glUniformMatrix3fv(m_normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
   abcg::glUniform4f(m_colorLoc, 0.36f, 0.26f, 0.56f, 0.8f); // Cor
+  // O array de texturas já está vinculado; só a camada muda por objeto
+  abcg::glUniform1f(m_layerLoc, static_cast<float>(m_layer));
 
   abcg::glBindVertexArray(m_VAO);
-  abcg::glBindTexture(GL_TEXTURE_2D, m_texture);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT,
-                       nullptr);
+  abcg::glDrawElements(GL_TRIANGLES, m_numIndices, m_indexType, nullptr);
 
   // Renderizar as bordas no modo wireframe
   abcg::glUniform4f(m_colorLoc, 0.0f, 0.0f, 0.0f,
@@ -164,22 +139,38 @@ void Cube::create(GLuint program, GLint modelMatrixLoc, GLint colorLoc,
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
 
-  // Vincula os atributos de vértice
+  // Vincula os atributos de vértice de acordo com o layout da malha
+  auto const packed{m_vertexFormat == VertexFormat::Packed};
+  auto const stride{
+      gsl::narrow<GLsizei>(packed ? sizeof(PackedVertex) : sizeof(Vertex))};
   auto const positionAttribute{
       abcg::glGetAttribLocation(program, "inPosition")};
   if (positionAttribute >= 0) {
     abcg::glEnableVertexAttribArray(positionAttribute);
-    abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
-                                sizeof(Vertex), nullptr);
+    if (packed) {
+      abcg::glVertexAttribPointer(
+          positionAttribute, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+          reinterpret_cast<void *>(offsetof(PackedVertex, position)));
+    } else {
+      abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
+                                  stride, nullptr);
+    }
   }
 
   // Normal
   auto const normalAttribute{abcg::glGetAttribLocation(program, "inNormal")};
   if (normalAttribute >= 0) {
     abcg::glEnableVertexAttribArray(normalAttribute);
-    abcg::glVertexAttribPointer(
-        normalAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, normal)));
+    if (packed) {
+      // Formatos empacotados exigem 4 componentes; w é ignorado pelo shader
+      abcg::glVertexAttribPointer(
+          normalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+          reinterpret_cast<void *>(offsetof(PackedVertex, normal)));
+    } else {
+      abcg::glVertexAttribPointer(
+          normalAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+          reinterpret_cast<void *>(offsetof(Vertex, normal)));
+    }
   }
 
   // Textura
@@ -187,24 +178,38 @@ void Cube::create(GLuint program, GLint modelMatrixLoc, GLint colorLoc,
       abcg::glGetAttribLocation(program, "inTexCoord")};
   if (texCoordAttribute >= 0) {
     abcg::glEnableVertexAttribArray(texCoordAttribute);
-    abcg::glVertexAttribPointer(
-        texCoordAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, texCoord)));
+    if (packed) {
+      abcg::glVertexAttribPointer(
+          texCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+          reinterpret_cast<void *>(offsetof(PackedVertex, texCoord)));
+    } else {
+      abcg::glVertexAttribPointer(
+          texCoordAttribute, 2, GL_FLOAT, GL_FALSE, stride,
+          reinterpret_cast<void *>(offsetof(Vertex, texCoord)));
+    }
   }
   // Fim da vinculação
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
   abcg::glBindVertexArray(0);
 
   m_modelMatrixLoc = modelMatrixLoc;
+  m_normalMatrixLoc = abcg::glGetUniformLocation(program, "normalMatrix");
+  m_layerLoc = abcg::glGetUniformLocation(program, "layer");
   m_viewMatrix = viewMatrix;
   m_colorLoc = colorLoc;
   m_scale = scale;
   m_maxPos = m_scale * N;
 }
 
-void Cube::update(float deltaTime) { move(deltaTime); }
+void Cube::update(float deltaTime) {
+  abcg::ProfilerZone zone{"Cube::update"};
+  move(deltaTime);
+}
 
-void Cube::setGround(Ground *ground) { m_ground = ground; }
+void Cube::setGround(Ground *ground) {
+  m_ground = ground;
+  ensureSolvable();
+}
 
 void Cube::destroy() const {
   abcg::glDeleteBuffers(1, &m_EBO);
@@ -334,76 +339,38 @@ void Cube::resetAnimation() {
 }
 
 void Cube::translate() {
-  float moveDistance = m_scale;
-
-  switch (m_state) {
-  case State::STANDING:
-    if (m_orientation == Orientation::UP) {
-      m_position.z -= moveDistance;
-      m_position.z -= moveDistance / 2.0f; // Shift para estado LAYING
-      m_state = State::LAYING_Z;
-    } else if (m_orientation == Orientation::DOWN) {
-      m_position.z += moveDistance;
-      m_position.z += moveDistance / 2.0f;
-      m_state = State::LAYING_Z;
-    } else if (m_orientation == Orientation::LEFT) {
-      m_position.x -= moveDistance;
-      m_position.x -= moveDistance / 2.0f;
-      m_state = State::LAYING_X;
-    } else if (m_orientation == Orientation::RIGHT) {
-      m_position.x += moveDistance;
-      m_position.x += moveDistance / 2.0f;
-      m_state = State::LAYING_X;
-    }
+  Solver::Move move{};
+  switch (m_orientation) {
+  case Orientation::UP:
+    move = Solver::Move::UP;
     break;
-
-  case State::LAYING_Z:
-    if (m_orientation == Orientation::UP ||
-        m_orientation == Orientation::DOWN) {
-      // Move duas casas
-      m_position.z += (m_orientation == Orientation::UP ? -2.0f * moveDistance
-                                                        : 2.0f * moveDistance);
-      // Ajusta a posição para o centro
-      m_position.z +=
-          (m_orientation == Orientation::UP ? moveDistance : -moveDistance) /
-          2.0f;
-      m_state = State::STANDING;
-    } else {
-      // Move uma casa na direção X
-      m_position.x +=
-          (m_orientation == Orientation::LEFT ? -moveDistance : moveDistance);
-    }
+  case Orientation::DOWN:
+    move = Solver::Move::DOWN;
     break;
-
-  case State::LAYING_X:
-    if (m_orientation == Orientation::LEFT ||
-        m_orientation == Orientation::RIGHT) {
-      // Move duas casas
-      m_position.x +=
-          (m_orientation == Orientation::LEFT ? -2.0f * moveDistance
-                                              : 2.0f * moveDistance);
-      // Ajusta a posição para o centro
-      m_position.x +=
-          (m_orientation == Orientation::LEFT ? moveDistance : -moveDistance) /
-          2.0f;
-      m_state = State::STANDING;
-    } else {
-      // Move uma casa na direção Z
-      m_position.z +=
-          (m_orientation == Orientation::UP ? -moveDistance : moveDistance);
-    }
+  case Orientation::LEFT:
+    move = Solver::Move::LEFT;
+    break;
+  case Orientation::RIGHT:
+    move = Solver::Move::RIGHT;
     break;
   }
 
+  // A regra de transição é a mesma usada pelo Solver e é aplicada em
+  // unidades de meio tile, então a posição não acumula erro de ponto
+  // flutuante a cada movimento
+  auto const pose{Solver::step(getPose(), move)};
+  m_state = pose.state;
+
   // Garantir que Y permaneça constante após translação
-  m_position.y = 0.0f; // Mantém o prisma na superfície da plataforma
+  m_position = glm::vec3{pose.x * m_scale / 2.0f, 0.0f,
+                         pose.z * m_scale / 2.0f};
 
   // Após atualizar a posição, verifique se o Cube está sobre o buraco **e está
   // em pé**
   if (m_ground != nullptr) {
     // Converte as coordenadas do mundo para coordenadas do grid
-    int gridX = static_cast<int>(round(m_position.x / m_scale));
-    int gridZ = static_cast<int>(round(m_position.z / m_scale));
+    int gridX, gridZ;
+    Solver::getCell(pose, gridX, gridZ);
 
     int holeX, holeZ;
     m_ground->getHolePosition(holeX, holeZ);
@@ -421,6 +388,12 @@ void Cube::translate() {
   }
 }
 
+Solver::Pose Cube::getPose() const {
+  return {.x = static_cast<int>(std::lround(2.0f * m_position.x / m_scale)),
+          .z = static_cast<int>(std::lround(2.0f * m_position.z / m_scale)),
+          .state = m_state};
+}
+
 void Cube::moveUp() {
   if (m_isMoving || m_isFalling)
     return;
@@ -458,6 +431,12 @@ void Cube::moveRight() {
 }
 
 void Cube::resetGame() {
+  // Reseta o Ground para gerar um novo buraco antes de sortear a posição, para
+  // que o prisma não comece sobre o buraco novo
+  if (m_ground != nullptr) {
+    m_ground->reset();
+  }
+
   bool positionValid = false;
   glm::vec3 newPosition;
 
@@ -488,8 +467,24 @@ void Cube::resetGame() {
   m_border = false;
   m_fallTime = 0.0f;
 
-  // Reseta o Ground para gerar um novo buraco
-  if (m_ground != nullptr) {
+  ensureSolvable();
+}
+
+// Sorteia novos buracos até que o tabuleiro tenha solução a partir da posição
+// atual, e guarda o número mínimo de movimentos
+void Cube::ensureSolvable() {
+  m_parMoves = -1;
+  if (m_ground == nullptr)
+    return;
+
+  auto const maxAttempts{100};
+  for ([[maybe_unused]] auto const attempt : iter::range(maxAttempts)) {
+    Solver solver{m_ground->getGrid(), m_ground->getHoleX(),
+                  m_ground->getHoleZ()};
+    if (auto const moves{solver.solve(getPose())}) {
+      m_parMoves = static_cast<int>(moves->size());
+      return;
+    }
     m_ground->reset();
   }
-}
\ No newline at end of file
+}
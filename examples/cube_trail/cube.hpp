@@ -3,12 +3,19 @@
 
 #include "abcgOpenGL.hpp"
 #include "ground.hpp"
+#include "mesh.hpp"
+#include "solver.hpp"
 #include "vertex.hpp"
+#include <cstddef>
 #include <random>
+#include <span>
 
 class Cube {
 public:
-  void loadObj(std::string_view path);
+  // A malha é otimizada e, por padrão, usa o layout compactado de vértices.
+  // Deve ser chamado antes de create
+  void loadObj(std::string_view path,
+               VertexFormat format = VertexFormat::Packed);
   void paint();
   void update(float deltaTime);
   void create(GLuint program, GLint modelMatrixLoc, GLint colorLoc,
@@ -22,30 +29,40 @@ public:
   void setGround(Ground *ground);
   void paintWireframe();
   bool isOnHole() const;
-  void setTexture(GLuint texture) { m_texture = texture; };
+  // Camada do array de texturas usada pelo prisma
+  void setLayer(int layer) { m_layer = layer; };
+  int getParMoves() const { return m_parMoves; }
+  // Se o prisma está rolando ou caindo (a cena precisa ser redesenhada)
+  bool isAnimating() const { return m_isMoving || m_isFalling; }
 
 private:
   GLuint m_VAO{};
   GLuint m_VBO{};
   GLuint m_EBO{};
-  GLuint m_EBOEdges{};
 
   glm::mat4 m_animationMatrix{1.0f};
   glm::mat4 m_viewMatrix;
   glm::mat4 m_positionMatrix{1.0f};
   glm::mat4 m_modelMatrix{1.0f};
   GLint m_modelMatrixLoc;
+  GLint m_normalMatrixLoc{};
 
   GLint m_colorLoc;
+  GLint m_layerLoc{};
 
-  std::vector<Vertex> m_vertices;
-  std::vector<GLuint> m_indices;
-  std::vector<GLuint> m_edgeIndices;
+  VertexFormat m_vertexFormat{VertexFormat::Float};
+  GLenum m_indexType{GL_UNSIGNED_INT};
+  GLsizei m_numIndices{};
+  GLsizei m_numEdgeIndices{};
+  std::size_t m_edgeIndicesOffset{}; // Em bytes, no EBO
+  glm::mat4 m_dequantizeMatrix{1.0f};
 
-  void createBuffers();
+  void createBuffers(MeshHeader const &header,
+                     std::span<std::byte const> vertexData,
+                     std::span<std::byte const> indexData);
 
   enum class Orientation { DOWN, RIGHT, UP, LEFT };
-  enum class State { STANDING, LAYING_X, LAYING_Z };
+  using State = Solver::State;
 
   glm::vec3 m_position{};
   float m_scale{1.0f};
@@ -71,6 +88,8 @@ private:
   void move(float deltaTime);
   void translate();
   void resetAnimation();
+  Solver::Pose getPose() const;
+  void ensureSolvable();
 
   // Novo método para gerar posição aleatória
   glm::vec3 generateRandomPosition();
@@ -78,7 +97,11 @@ private:
   int m_rotationDirection{1};
 
   Ground *m_ground{nullptr};
-  GLuint m_texture{0};
+  int m_layer{0};
+
+  // Menor número de movimentos para resolver o tabuleiro atual (-1 se não
+  // houver solução)
+  int m_parMoves{-1};
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,7 @@
 #include "ground.hpp"
 #include <random>
 
-void Ground::create(GLuint program, GLint modelMatrixLoc, GLint colorLoc, float scale, int N) {
+void Ground::create(GLuint program, float scale, int N) {
   // Define um quadrado unitário no plano xz
   m_vertices = {
     {.position = {+0.5f, 0.0f, -0.5f}, .normal={0.0f,1.0f,0.0f}, .texCoord={1.0f,0.0f}},
@@ -42,61 +42,115 @@ void Ground::create(GLuint program, GLint modelMatrixLoc, GLint colorLoc, float
     abcg::glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
   }
 
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-  abcg::glBindVertexArray(0);
-
   // Initialize the grid with all tiles present
   m_N = N;
   m_scale = scale;
-  m_grid.resize(2 * m_N + 1, std::vector<bool>(2 * m_N + 1, true));
+  m_grid.resize(2 * m_N + 1, 2 * m_N + 1, true);
+
+  // Instance buffer sized for a board without holes, so updates never
+  // reallocate it
+  auto const maxInstances{static_cast<std::size_t>(m_grid.getWidth()) *
+                          static_cast<std::size_t>(m_grid.getHeight())};
+  m_instances.reserve(maxInstances);
+  m_tileLayers.assign(maxInstances, 0.0f);
+  abcg::glGenBuffers(1, &m_instanceVBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(Instance) * maxInstances,
+                     nullptr, GL_DYNAMIC_DRAW);
+
+  auto const offsetAttribute{abcg::glGetAttribLocation(program, "inOffset")};
+  if (offsetAttribute >= 0) {
+    abcg::glEnableVertexAttribArray(offsetAttribute);
+    abcg::glVertexAttribPointer(offsetAttribute, 2, GL_FLOAT, GL_FALSE,
+                                sizeof(Instance), nullptr);
+    abcg::glVertexAttribDivisor(offsetAttribute, 1);
+  }
+
+  auto const layerAttribute{abcg::glGetAttribLocation(program, "inLayer")};
+  if (layerAttribute >= 0) {
+    abcg::glEnableVertexAttribArray(layerAttribute);
+    abcg::glVertexAttribPointer(layerAttribute, 1, GL_FLOAT, GL_FALSE,
+                                sizeof(Instance),
+                                (void*)offsetof(Instance, layer));
+    abcg::glVertexAttribDivisor(layerAttribute, 1);
+  }
+
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+  abcg::glBindVertexArray(0);
 
   // Randomize hole position on creation
   randomizeHole();
 
   // Carrega a localização das variáveis uniformes do shader
-  m_modelMatrixLoc = modelMatrixLoc;
-  m_colorLoc = colorLoc;
+  m_modelMatrixLoc = abcg::glGetUniformLocation(program, "modelMatrix");
 }
 
 void Ground::paint() {
-  abcg::glBindVertexArray(m_VAO);
-  abcg::glBindTexture(GL_TEXTURE_2D, m_texture);
+  abcg::ProfilerZone zone{"Ground::paint"};
 
-  for (auto const z : iter::range(-m_N, m_N + 1)) {
-    for (auto const x : iter::range(-m_N, m_N + 1)) {
-      // Skip drawing if the tile is a hole
-      if (!isTile(x, z)) continue;
+  if (m_instancesDirty) {
+    updateInstances();
+  }
 
-      glm::mat4 model{1.0f};
+  // All tiles share the same scale; the translation comes from the instance
+  glm::mat4 const model{glm::scale(glm::mat4{1.0f}, glm::vec3(m_scale))};
+  abcg::glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
 
-      model = glm::translate(model, glm::vec3(x * m_scale, 0.0f, z * m_scale));
-      model = glm::scale(model, glm::vec3(m_scale, m_scale, m_scale));
+  // The texture array is bound by the caller; each instance selects its layer
+  abcg::glBindVertexArray(m_VAO);
 
-      abcg::glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
+  abcg::glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                              static_cast<GLsizei>(m_instances.size()));
 
-      // Define color (checkerboard pattern)
-      auto const gray{(z + x) % 2 == 0 ? 0.5f : 1.0f};
-      abcg::glUniform4f(m_colorLoc, gray, gray, gray, 1.0f);
+  abcg::glBindVertexArray(0);
+}
 
-      abcg::glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+void Ground::updateInstances() {
+  abcg::ProfilerZone zone{"Ground::updateInstances"};
+
+  // Scan each row of the bitboard for present tiles (holes are skipped)
+  m_instances.clear();
+  for (auto const row : iter::range(m_grid.getHeight())) {
+    for (auto column{m_grid.findInRow(row)}; column >= 0;
+         column = m_grid.findInRow(row, column + 1)) {
+      auto const tile{static_cast<std::size_t>(row * m_grid.getWidth() + column)};
+      m_instances.push_back(
+          {.offset = {(column - m_N) * m_scale, (row - m_N) * m_scale},
+           .layer = m_tileLayers[tile]});
     }
   }
 
-  abcg::glBindVertexArray(0);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  abcg::glBufferSubData(GL_ARRAY_BUFFER, 0,
+                        sizeof(Instance) * m_instances.size(),
+                        m_instances.data());
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  m_instancesDirty = false;
 }
 
 void Ground::destroy() {
+  abcg::glDeleteBuffers(1, &m_instanceVBO);
   abcg::glDeleteBuffers(1, &m_VBO);
   abcg::glDeleteVertexArrays(1, &m_VAO);
 }
 
+void Ground::setLayers(int first, int count) {
+  std::uniform_int_distribution<> layerDist(first, first + count - 1);
+  for (auto &layer : m_tileLayers) {
+    layer = static_cast<float>(layerDist(m_gen));
+  }
+  m_instancesDirty = true;
+}
+
 void Ground::setHole(int x, int z) {
   // Convert grid coordinates to vector indices
   int gridX = x + m_N;
   int gridZ = z + m_N;
 
-  if (gridX >= 0 && gridX < 2 * m_N + 1 && gridZ >= 0 && gridZ < 2 * m_N + 1) {
-    m_grid[gridX][gridZ] = false; // Set tile as hole
+  if (m_grid.contains(gridX, gridZ)) {
+    m_grid.set(gridX, gridZ, false); // Set tile as hole
+    m_instancesDirty = true;
     m_holeX = x;
     m_holeZ = z;
   }
@@ -105,10 +159,7 @@ void Ground::setHole(int x, int z) {
 bool Ground::isTile(int x, int z) const {
   int gridX = x + m_N;
   int gridZ = z + m_N;
-  if (gridX >= 0 && gridX < 2 * m_N + 1 && gridZ >= 0 && gridZ < 2 * m_N + 1) {
-    return m_grid[gridX][gridZ];
-  }
-  return false; // Outside grid bounds
+  return m_grid.contains(gridX, gridZ) && m_grid.test(gridX, gridZ);
 }
 
 void Ground::getHolePosition(int& x, int& z) const {
@@ -127,8 +178,9 @@ void Ground::randomizeHole() {
     newHoleZ = zDist(m_gen);
   } while (newHoleX == 0 && newHoleZ == 0); // Avoid placing hole at the center
 
-  // Clear previous grid and set hole
-  m_grid = std::vector<std::vector<bool>>(2 * m_N + 1, std::vector<bool>(2 * m_N + 1, true));
+  // Clear previous grid (in place, without reallocating) and set hole
+  m_grid.fill(true);
+  m_instancesDirty = true;
   setHole(newHoleX, newHoleZ);
 }
 
@@ -2,13 +2,14 @@
 #define GROUND_HPP_
 
 #include "abcgOpenGL.hpp"
+#include "tilegrid.hpp"
 #include "vertex.hpp"
 #include <vector>
 #include <random>
 
 class Ground {
 public:
-  void create(GLuint program, GLint modelMatrixLoc, GLint colorLoc, float scale, int N);
+  void create(GLuint program, float scale, int N);
   void paint();
   void destroy();
 
@@ -25,8 +26,11 @@ public:
   int getHoleX() const { return m_holeX; }
   int getHoleZ() const { return m_holeZ; }
   int getN() const { return m_N; }
+  TileGrid const &getGrid() const { return m_grid; }
 
-  void setTexture(GLuint texture) { m_texture = texture; }
+  // Gives each tile a random skin among `count` layers of the texture array,
+  // starting at `first`
+  void setLayers(int first, int count);
 
 private:
   std::vector<Vertex> m_vertices;
@@ -35,11 +39,24 @@ private:
   GLuint m_VAO{};
   GLuint m_VBO{};
 
+  // Per-instance tile offset (xz plane) and texture layer. Holes are left
+  // out, so the whole board is drawn with a single instanced call
+  struct Instance {
+    glm::vec2 offset;
+    float layer;
+  };
+  std::vector<Instance> m_instances;
+  GLuint m_instanceVBO{};
+  bool m_instancesDirty{true};
+  void updateInstances();
+
   GLint m_modelMatrixLoc{};
-  GLint m_colorLoc{};
 
-  // 2D vector to represent the grid
-  std::vector<std::vector<bool>> m_grid;
+  // Bitboard of tiles, indexed by (x + N, z + N)
+  TileGrid m_grid;
+
+  // Texture layer of each tile, in the same order as the grid
+  std::vector<float> m_tileLayers;
 
   // Coordinates of the hole
   int m_holeX{-1};
@@ -48,8 +65,6 @@ private:
   // Random number generator for hole placement
   std::random_device m_rd;
   std::mt19937 m_gen{m_rd()};
-
-  GLuint m_texture{0};  
 };
 
 #endif
\ No newline at end of file
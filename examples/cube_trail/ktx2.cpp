@@ -0,0 +1,136 @@
+// Ferramenta de linha de comando que converte as texturas JPEG/PNG do jogo
+// para KTX2 com compressão por blocos e todos os níveis de mipmap, de modo que
+// nada precise ser decodificado nem gerado durante a inicialização.
+//
+// Uso: cube_trail_ktx2 entrada saída.ktx2 [bc1|etc2|rgba8] [srgb] [LxA]
+//
+// Com LxA (por exemplo, 1024x1024), a imagem é redimensionada antes da
+// compressão, já que blocos comprimidos não podem ser redimensionados ao
+// carregar. Assim as texturas podem ser camadas de um mesmo array.
+//
+// BC1 é suportado por praticamente todas as GPUs de desktop; ETC2 é o formato
+// obrigatório do OpenGL ES 3.0. Se o formato não for suportado em tempo de
+// execução, abcg::createOpenGLTexture descomprime a textura para RGBA.
+
+#define SDL_MAIN_HANDLED
+
+#include "abcgImage.hpp"
+#include "abcgKTX2.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+// Lê um tamanho no formato LxA, como 1024x1024
+std::optional<glm::ivec2> parseSize(std::string const &text) {
+  auto const separator{text.find('x')};
+  if (separator == std::string::npos) {
+    return std::nullopt;
+  }
+  auto const *const begin{text.data()};
+  auto const *const end{begin + text.size()};
+  glm::ivec2 size{};
+  auto const [widthEnd, widthError]{
+      std::from_chars(begin, begin + separator, size.x)};
+  auto const [heightEnd, heightError]{
+      std::from_chars(begin + separator + 1, end, size.y)};
+  if (widthError != std::errc{} || widthEnd != begin + separator ||
+      heightError != std::errc{} || heightEnd != end || size.x <= 0 ||
+      size.y <= 0) {
+    return std::nullopt;
+  }
+  return size;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    std::vector<std::string> const args(argv + 1, argv + argc);
+    if (args.size() < 2) {
+      std::cerr << "Uso: cube_trail_ktx2 entrada saída.ktx2 "
+                   "[bc1|etc2|rgba8] [srgb] [LxA]\n";
+      return -1;
+    }
+
+    // Opções em qualquer ordem após os dois caminhos
+    auto format{abcg::KTX2Format::BC1};
+    auto sRGB{false};
+    glm::ivec2 outputSize{};
+    for (auto const &option : std::span{args}.subspan(2)) {
+      if (option == "bc1") {
+        format = abcg::KTX2Format::BC1;
+      } else if (option == "etc2") {
+        format = abcg::KTX2Format::ETC2;
+      } else if (option == "rgba8") {
+        format = abcg::KTX2Format::RGBA8;
+      } else if (option == "srgb") {
+        sRGB = true;
+      } else if (auto const size{parseSize(option)}; size) {
+        outputSize = *size;
+      } else {
+        std::cerr << "Opção desconhecida: " << option << '\n';
+        return -1;
+      }
+    }
+
+    auto *const loaded{IMG_Load(args[0].c_str())};
+    if (loaded == nullptr) {
+      std::cerr << "Falha ao carregar " << args[0] << ": " << IMG_GetError()
+                << '\n';
+      return -1;
+    }
+    auto *surface{SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0)};
+    SDL_FreeSurface(loaded);
+    if (surface == nullptr) {
+      std::cerr << "Falha ao converter " << args[0] << '\n';
+      return -1;
+    }
+
+    if (outputSize != glm::ivec2{} &&
+        outputSize != glm::ivec2{surface->w, surface->h}) {
+      auto *const resized{abcg::resize(*surface, outputSize.x, outputSize.y)};
+      SDL_FreeSurface(surface);
+      surface = resized;
+      if (surface == nullptr) {
+        std::cerr << "Falha ao redimensionar " << args[0] << '\n';
+        return -1;
+      }
+    }
+
+    // Grava de baixo para cima, como o OpenGL espera, para que o carregador
+    // não precise inverter a imagem
+    abcg::flipVertically(*surface);
+    glm::ivec2 const size{surface->w, surface->h};
+    std::span const pixels{static_cast<unsigned char const *>(surface->pixels),
+                           static_cast<std::size_t>(size.x * size.y * 4)};
+
+    auto const start{std::chrono::steady_clock::now()};
+    auto image{abcg::compressKTX2(pixels, size, format, sRGB, true)};
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start};
+    SDL_FreeSurface(surface);
+
+    image.bottomUp = true;
+    abcg::writeKTX2(image, args[1]);
+
+    std::size_t bytes{};
+    for (auto const &level : image.levels) {
+      bytes += level.size();
+    }
+    std::cout << args[1] << ": " << size.x << "x" << size.y << ", "
+              << image.levels.size() << " níveis, " << bytes / 1024
+              << " KiB (RGBA8 sem mipmaps: "
+              << pixels.size() / 1024 << " KiB), " << elapsed.count()
+              << " s\n";
+  } catch (std::exception const &exception) {
+    std::cerr << exception.what() << '\n';
+    return -1;
+  }
+  return 0;
+}
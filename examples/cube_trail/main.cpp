@@ -1,18 +1,45 @@
 #include "window.hpp"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Uso: cube_trail [--headless quadros [imagem.png]]
+//
+// No modo headless, renderiza o número de quadros pedido sem abrir janela
+// (contexto EGL sem superfície) e, opcionalmente, salva o último quadro.
 int main(int argc, char **argv) {
   try {
     abcg::Application app(argc, argv);
 
+    std::vector<std::string> const args(argv + 1, argv + argc);
+    auto const headless{!args.empty() && args[0] == "--headless"};
+    auto const numFrames{headless && args.size() > 1 ? std::stoi(args[1])
+                                                     : 0};
+
+    // Grava as zonas de CPU de cada quadro; tecle T para salvar o trace
+    abcg::Profiler::setEnabled(true);
+    abcg::Profiler::setThreadName("Main");
+
     Window window;
-    window.setOpenGLSettings({.samples = 4});
+    // Os binários dos programas de shader são guardados em disco, então as
+    // execuções seguintes não recompilam os shaders
+    window.setOpenGLSettings({.samples = 4,
+                              .showGPUProfiler = true,
+                              .headless = headless,
+                              .programCacheDirectory = "cube_trail_shader_cache"});
+    if (headless && args.size() > 2) {
+      window.setFinalScreenshot(args[2]);
+    }
     window.setWindowSettings({
         .width = 600,
         .height = 600,
+        .maxFrameRate = 60.0,
+        .renderOnDemand = true,
         .title = "Bloxorz Clone",
     });
 
-    app.run(window);
+    app.run(window, headless ? std::max(numFrames, 1) : 0);
   } catch (std::exception const &exception) {
     fmt::print(stderr, "{}\n", exception.what());
     return -1;
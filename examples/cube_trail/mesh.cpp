@@ -0,0 +1,545 @@
+#include "mesh.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <glm/gtc/packing.hpp>
+#include <tiny_obj_loader.h>
+
+#include "abcgMesh.hpp"
+
+namespace {
+template <typename T>
+void appendBytes(std::vector<std::byte> &bytes, std::span<T> values) {
+  auto const source{std::as_bytes(values)};
+  bytes.insert(bytes.end(), source.begin(), source.end());
+}
+
+// Arestas desenhadas no modo wireframe: bordas e vincos, isto é, arestas cujas
+// faces adjacentes formam um ângulo maior que 30 graus. Vértices separados
+// apenas pela normal ou pela coordenada de textura são unificados pela posição
+void buildEdges(Mesh &mesh) {
+  std::vector<glm::vec3> positions;
+  positions.reserve(mesh.vertices.size());
+  for (auto const &vertex : mesh.vertices) {
+    // -0 + 0 = +0: coordenadas nulas com sinais diferentes são unificadas
+    positions.push_back(vertex.position + 0.0f);
+  }
+  auto const weld{abcg::weldVertices(std::span{positions})};
+  std::vector<GLuint> canonical;
+  canonical.reserve(mesh.vertices.size());
+  for (auto const index : weld.indices) {
+    canonical.push_back(weld.firstOccurrences[index]);
+  }
+
+  struct Edge {
+    GLuint first{};
+    GLuint second{};
+    glm::vec3 normal{}; // Normal da primeira face
+    int numFaces{};
+    bool crease{};
+  };
+  auto const minCosine{std::cos(glm::radians(30.0f))};
+  std::unordered_map<std::uint64_t, Edge> edges;
+  std::vector<std::uint64_t> order; // Mantém a saída determinística
+
+  auto const &indices{mesh.indices};
+  for (std::size_t offset{}; offset + 2 < indices.size(); offset += 3) {
+    std::array const triangle{indices[offset], indices[offset + 1],
+                              indices[offset + 2]};
+    auto const &a{mesh.vertices[triangle[0]].position};
+    auto const &b{mesh.vertices[triangle[1]].position};
+    auto const &c{mesh.vertices[triangle[2]].position};
+    auto const cross{glm::cross(b - a, c - a)};
+    if (glm::length(cross) <= 0.0f) {
+      continue; // Triângulo degenerado
+    }
+    auto const normal{glm::normalize(cross)};
+
+    for (auto const corner : iter::range(3)) {
+      auto const first{triangle.at(corner)};
+      auto const second{triangle.at((corner + 1) % 3)};
+      auto const u{canonical[first]};
+      auto const v{canonical[second]};
+      auto const key{(std::uint64_t{std::min(u, v)} << 32U) | std::max(u, v)};
+      auto const [it, inserted]{edges.try_emplace(
+          key, Edge{.first = first, .second = second, .normal = normal})};
+      auto &edge{it->second};
+      if (inserted) {
+        order.push_back(key);
+      } else if (glm::dot(edge.normal, normal) < minCosine) {
+        edge.crease = true;
+      }
+      ++edge.numFaces;
+    }
+  }
+
+  mesh.edgeIndices.clear();
+  for (auto const key : order) {
+    auto const &edge{edges.at(key)};
+    if (edge.numFaces != 2 || edge.crease) {
+      mesh.edgeIndices.push_back(edge.first);
+      mesh.edgeIndices.push_back(edge.second);
+    }
+  }
+}
+
+// Reordena os triângulos para a cache de vértices pós-transformação com o
+// algoritmo Tipsify (Sander, Nehab e Barczak, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw", 2007). Os triângulos são emitidos em
+// leques ao redor de um vértice, e o próximo vértice é escolhido entre os
+// recém-usados que ainda estarão na cache de cacheSize entradas
+std::vector<GLuint> reorderTriangles(std::span<GLuint const> indices,
+                                     std::size_t numVertices,
+                                     std::size_t cacheSize) {
+  auto const numTriangles{indices.size() / 3};
+  auto const none{numVertices};
+
+  // Triângulos adjacentes a cada vértice, em um único array
+  std::vector<std::size_t> live(numVertices); // Triângulos ainda não emitidos
+  for (auto const index : indices.first(numTriangles * 3)) {
+    ++live.at(index);
+  }
+  std::vector<std::size_t> offsets(numVertices + 1);
+  for (auto const vertex : iter::range(numVertices)) {
+    offsets[vertex + 1] = offsets[vertex] + live[vertex];
+  }
+  std::vector<std::size_t> adjacency(offsets.back());
+  {
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (auto const triangle : iter::range(numTriangles)) {
+      for (auto const corner : iter::range(3)) {
+        adjacency[next[indices[triangle * 3 + corner]]++] = triangle;
+      }
+    }
+  }
+
+  std::vector<std::size_t> cacheTime(numVertices);
+  std::vector<bool> emitted(numTriangles);
+  std::vector<std::size_t> deadEnd;
+  std::vector<std::size_t> candidates;
+  std::vector<GLuint> result;
+  result.reserve(numTriangles * 3);
+  auto time{cacheSize + 1};
+  std::size_t cursor{};
+
+  auto fanning{numTriangles > 0 ? std::size_t{} : none};
+  while (fanning != none) {
+    // Emite os triângulos restantes ao redor do vértice
+    candidates.clear();
+    for (auto const triangle : std::span{adjacency}.subspan(
+             offsets[fanning], offsets[fanning + 1] - offsets[fanning])) {
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (auto const corner : iter::range(3)) {
+        auto const vertex{indices[triangle * 3 + corner]};
+        result.push_back(vertex);
+        deadEnd.push_back(vertex);
+        candidates.push_back(vertex);
+        --live[vertex];
+        if (time - cacheTime[vertex] > cacheSize) {
+          cacheTime[vertex] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // Prefere o vértice mais antigo que ainda estará na cache depois de
+    // emitir todos os seus triângulos
+    fanning = none;
+    std::size_t bestPriority{};
+    for (auto const vertex : candidates) {
+      if (live[vertex] == 0) {
+        continue;
+      }
+      std::size_t priority{1};
+      if (time - cacheTime[vertex] + 2 * live[vertex] <= cacheSize) {
+        priority += time - cacheTime[vertex];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        fanning = vertex;
+      }
+    }
+
+    // Beco sem saída: volta a um vértice usado recentemente ou, se não
+    // houver, ao próximo vértice com triângulos restantes
+    while (fanning == none && !deadEnd.empty()) {
+      if (live[deadEnd.back()] > 0) {
+        fanning = deadEnd.back();
+      }
+      deadEnd.pop_back();
+    }
+    while (fanning == none && cursor < numVertices) {
+      if (live[cursor] > 0) {
+        fanning = cursor;
+      } else {
+        ++cursor;
+      }
+    }
+  }
+
+  return result;
+}
+
+// Reordena os vértices pela ordem do primeiro uso nos triângulos, para que
+// sejam lidos do VBO de forma quase sequencial. Vértices não usados são
+// descartados
+void reorderVertices(Mesh &mesh) {
+  constexpr auto unused{std::numeric_limits<GLuint>::max()};
+  std::vector<GLuint> remap(mesh.vertices.size(), unused);
+  std::vector<Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+
+  for (auto &index : mesh.indices) {
+    if (remap[index] == unused) {
+      remap[index] = gsl::narrow<GLuint>(vertices.size());
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  // As arestas vêm dos triângulos, então seus vértices já foram remapeados
+  for (auto &index : mesh.edgeIndices) {
+    index = remap[index];
+  }
+
+  mesh.vertices = std::move(vertices);
+}
+} // namespace
+
+Mesh parseObj(std::string_view path) {
+  tinyobj::ObjReader reader;
+
+  if (!reader.ParseFromFile(path.data())) {
+    if (!reader.Error().empty()) {
+      throw abcg::RuntimeError(
+          fmt::format("Failed to load model {} ({})", path, reader.Error()));
+    }
+    throw abcg::RuntimeError(fmt::format("Failed to load model {}", path));
+  }
+
+  if (!reader.Warning().empty()) {
+    fmt::print("Warning: {}\n", reader.Warning());
+  }
+
+  auto const &attrib{reader.GetAttrib()};
+  auto const &shapes{reader.GetShapes()};
+
+  // Um vértice por canto de triângulo; os repetidos são unificados depois
+  std::vector<Vertex> corners;
+  std::size_t numCorners{};
+  for (auto const &shape : shapes) {
+    numCorners += shape.mesh.indices.size();
+  }
+  corners.reserve(numCorners);
+
+  // Loop sobre shapes
+  for (auto const &shape : shapes) {
+    for (auto const &index : shape.mesh.indices) {
+
+      // Posição
+      auto const startIndex{3 * index.vertex_index};
+      glm::vec3 position{attrib.vertices.at(startIndex + 0),
+                         attrib.vertices.at(startIndex + 1),
+                         attrib.vertices.at(startIndex + 2)};
+
+      // Normal
+      glm::vec3 normal{};
+      if (index.normal_index >= 0) {
+        auto const normalStartIndex{3 * index.normal_index};
+        normal = {attrib.normals.at(normalStartIndex + 0),
+                  attrib.normals.at(normalStartIndex + 1),
+                  attrib.normals.at(normalStartIndex + 2)};
+      }
+
+      // Coordenada de textura
+      glm::vec2 texCoord{};
+      if (index.texcoord_index >= 0) {
+        auto const texStartIndex{2 * index.texcoord_index};
+        texCoord = {attrib.texcoords.at(texStartIndex + 0),
+                    attrib.texcoords.at(texStartIndex + 1)};
+      }
+
+      // Somar 0 troca -0 por +0, que seriam diferentes na comparação byte a
+      // byte
+      corners.push_back({.position = position + 0.0f,
+                         .normal = normal + 0.0f,
+                         .texCoord = texCoord + 0.0f});
+    }
+  }
+
+  // Cantos com os mesmos atributos passam a compartilhar um vértice. Vertex
+  // não tem bytes de preenchimento, então pode ser comparado byte a byte
+  static_assert(sizeof(Vertex) == 8 * sizeof(float));
+  auto const weld{abcg::weldVertices(std::span{corners})};
+
+  Mesh mesh;
+  mesh.vertices.reserve(weld.firstOccurrences.size());
+  for (auto const corner : weld.firstOccurrences) {
+    mesh.vertices.push_back(corners[corner]);
+  }
+  mesh.indices.assign(weld.indices.begin(), weld.indices.end());
+
+  buildEdges(mesh);
+
+  return mesh;
+}
+
+void optimizeMesh(Mesh &mesh) {
+  mesh.indices = reorderTriangles(mesh.indices, mesh.vertices.size(), 16);
+  reorderVertices(mesh);
+}
+
+EncodedMesh encodeMesh(Mesh const &mesh, VertexFormat format) {
+  EncodedMesh encoded;
+  auto &header{encoded.header};
+  header.vertexFormat = format;
+  header.numVertices = gsl::narrow<std::uint32_t>(mesh.vertices.size());
+  header.numIndices = gsl::narrow<std::uint32_t>(mesh.indices.size());
+  header.numEdgeIndices = gsl::narrow<std::uint32_t>(mesh.edgeIndices.size());
+
+  if (format == VertexFormat::Float) {
+    header.vertexSize = sizeof(Vertex);
+    appendBytes(encoded.vertexData, std::span{mesh.vertices});
+  } else {
+    header.vertexSize = sizeof(PackedVertex);
+
+    // As posições são quantizadas na caixa envolvente da malha
+    glm::vec3 min{};
+    glm::vec3 max{};
+    if (!mesh.vertices.empty()) {
+      min = max = mesh.vertices.front().position;
+    }
+    for (auto const &vertex : mesh.vertices) {
+      min = glm::min(min, vertex.position);
+      max = glm::max(max, vertex.position);
+    }
+    auto const extent{max - min};
+    header.positionOffset = min;
+    header.positionScale = glm::vec3{extent.x > 0.0f ? extent.x : 1.0f,
+                                     extent.y > 0.0f ? extent.y : 1.0f,
+                                     extent.z > 0.0f ? extent.z : 1.0f};
+
+    std::vector<PackedVertex> packed;
+    packed.reserve(mesh.vertices.size());
+    for (auto const &vertex : mesh.vertices) {
+      auto const position{(vertex.position - min) / header.positionScale};
+      auto const normal{glm::length(vertex.normal) > 0.0f
+                            ? glm::normalize(vertex.normal)
+                            : glm::vec3{}};
+      packed.push_back(
+          {.position = glm::packUnorm<std::uint16_t>(glm::vec4{position, 0.0f}),
+           .normal = glm::packSnorm3x10_1x2(glm::vec4{normal, 0.0f}),
+           .texCoord = glm::packHalf2x16(vertex.texCoord)});
+    }
+    appendBytes(encoded.vertexData, std::span{packed});
+  }
+
+  // Índices de 16 bits sempre que todos os vértices puderem ser endereçados
+  if (mesh.vertices.size() <= std::size_t{1} << 16U) {
+    header.indexSize = sizeof(std::uint16_t);
+    std::vector<std::uint16_t> indices;
+    indices.reserve(mesh.indices.size() + mesh.edgeIndices.size());
+    for (auto const index : mesh.indices) {
+      indices.push_back(gsl::narrow_cast<std::uint16_t>(index));
+    }
+    for (auto const index : mesh.edgeIndices) {
+      indices.push_back(gsl::narrow_cast<std::uint16_t>(index));
+    }
+    appendBytes(encoded.indexData, std::span{indices});
+  } else {
+    header.indexSize = sizeof(GLuint);
+    appendBytes(encoded.indexData, std::span{mesh.indices});
+    appendBytes(encoded.indexData, std::span{mesh.edgeIndices});
+  }
+
+  return encoded;
+}
+
+float computeACMR(std::span<GLuint const> indices, std::size_t numVertices,
+                  std::size_t cacheSize) {
+  if (indices.size() < 3) {
+    return 0.0f;
+  }
+
+  // Um vértice está na cache FIFO se entrou nela há menos de cacheSize falhas
+  std::vector<std::size_t> entered(numVertices);
+  std::size_t misses{};
+  for (auto const index : indices) {
+    if (entered.at(index) == 0 || misses - entered.at(index) >= cacheSize) {
+      entered.at(index) = ++misses;
+    }
+  }
+  return static_cast<float>(misses) /
+         static_cast<float>(indices.size() / 3);
+}
+
+void writeMesh(EncodedMesh const &mesh, std::string_view path) {
+
+  // Grava em um arquivo temporário e depois o renomeia, para que outra
+  // execução nunca mapeie um arquivo pela metade
+  std::filesystem::path const target{path};
+  auto temporary{target};
+  temporary += ".tmp";
+  {
+    std::ofstream stream{temporary, std::ios::binary | std::ios::trunc};
+    stream.write(reinterpret_cast<char const *>(&mesh.header),
+                 sizeof(mesh.header));
+    stream.write(reinterpret_cast<char const *>(mesh.vertexData.data()),
+                 gsl::narrow<std::streamsize>(mesh.vertexData.size()));
+    stream.write(reinterpret_cast<char const *>(mesh.indexData.data()),
+                 gsl::narrow<std::streamsize>(mesh.indexData.size()));
+    if (!stream.flush()) {
+      throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, target, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+
+std::string getMeshPath(std::string_view objPath) {
+  return std::filesystem::path{objPath}.replace_extension(".mesh").string();
+}
+
+bool isMeshUpToDate(std::string_view meshPath, std::string_view objPath) {
+  std::error_code error;
+  auto const meshTime{
+      std::filesystem::last_write_time(std::filesystem::path{meshPath}, error)};
+  if (error) {
+    return false;
+  }
+  auto const objTime{
+      std::filesystem::last_write_time(std::filesystem::path{objPath}, error)};
+  return error || meshTime >= objTime;
+}
+
+MeshFile::~MeshFile() { close(); }
+
+bool MeshFile::open(std::string_view path) {
+  close();
+
+  std::string const pathString{path};
+#if defined(_WIN32)
+  auto *const file{CreateFileA(pathString.c_str(), GENERIC_READ,
+                               FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize{};
+  if (GetFileSizeEx(file, &fileSize) == 0 || fileSize.QuadPart <= 0) {
+    CloseHandle(file);
+    return false;
+  }
+  auto *const mapping{
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return false;
+  }
+  // A vista continua válida depois que os handles são fechados
+  auto *const view{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+  CloseHandle(mapping);
+  if (view == nullptr) {
+    return false;
+  }
+  m_data = static_cast<std::byte const *>(view);
+  m_size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+  auto const fd{::open(pathString.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status {};
+  if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  auto const size{static_cast<std::size_t>(status.st_size)};
+  // O mapeamento continua válido depois que o descritor é fechado
+  auto *const view{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+  m_data = static_cast<std::byte const *>(view);
+  m_size = size;
+#endif
+
+  // Valida o cabeçalho e os tamanhos antes de expor os arrays
+  if (m_size >= sizeof(MeshHeader)) {
+    std::memcpy(&m_header, m_data, sizeof(MeshHeader));
+    auto const validVertexSize{
+        (m_header.vertexFormat == VertexFormat::Float &&
+         m_header.vertexSize == sizeof(Vertex)) ||
+        (m_header.vertexFormat == VertexFormat::Packed &&
+         m_header.vertexSize == sizeof(PackedVertex))};
+    auto const validIndexSize{m_header.indexSize == sizeof(std::uint16_t) ||
+                              m_header.indexSize == sizeof(GLuint)};
+    auto const expectedSize{
+        sizeof(MeshHeader) +
+        std::uint64_t{m_header.numVertices} * m_header.vertexSize +
+        (std::uint64_t{m_header.numIndices} + m_header.numEdgeIndices) *
+            m_header.indexSize};
+    if (m_header.magic == MeshHeader::expectedMagic &&
+        m_header.version == MeshHeader::currentVersion && validVertexSize &&
+        validIndexSize && m_size == expectedSize) {
+      return true;
+    }
+  }
+
+  close();
+  return false;
+}
+
+void MeshFile::close() {
+  if (m_data != nullptr) {
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+#else
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    munmap(const_cast<std::byte *>(m_data), m_size);
+#endif
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_header = {};
+}
+
+std::span<std::byte const> MeshFile::getVertexData() const {
+  if (m_data == nullptr) {
+    return {};
+  }
+  return {m_data + sizeof(MeshHeader),
+          std::size_t{m_header.numVertices} * m_header.vertexSize};
+}
+
+std::span<std::byte const> MeshFile::getIndexData() const {
+  if (m_data == nullptr) {
+    return {};
+  }
+  return {m_data + sizeof(MeshHeader) +
+              std::size_t{m_header.numVertices} * m_header.vertexSize,
+          (std::size_t{m_header.numIndices} + m_header.numEdgeIndices) *
+              m_header.indexSize};
+}
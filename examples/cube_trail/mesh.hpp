@@ -0,0 +1,105 @@
+#ifndef MESH_HPP_
+#define MESH_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+
+// Layout dos vértices enviados ao VBO
+enum class VertexFormat : std::uint32_t {
+  Float, // Vertex (32 bytes)
+  Packed // PackedVertex (16 bytes)
+};
+
+// Formato binário de malha (.mesh): um MeshHeader seguido do array
+// intercalado de vértices, dos índices dos triângulos e dos índices das
+// arestas, na ordem de bytes da máquina que gravou o arquivo. Os arrays podem
+// ser enviados diretamente ao VBO e ao EBO, sem nenhuma conversão
+struct MeshHeader {
+  static constexpr std::array<char, 4> expectedMagic{'C', 'T', 'M', 'S'};
+  static constexpr std::uint32_t currentVersion{2};
+
+  std::array<char, 4> magic{expectedMagic};
+  std::uint32_t version{currentVersion};
+  VertexFormat vertexFormat{VertexFormat::Float};
+  // Detecta arquivos gravados com outro layout de vértice
+  std::uint32_t vertexSize{sizeof(Vertex)};
+  std::uint32_t indexSize{sizeof(GLuint)}; // 2 ou 4
+  std::uint32_t numVertices{};
+  std::uint32_t numIndices{};
+  std::uint32_t numEdgeIndices{};
+  // Posição = positionOffset + positionScale * posição quantizada. Usado
+  // apenas por VertexFormat::Packed
+  glm::vec3 positionOffset{};
+  glm::vec3 positionScale{1.0f};
+};
+
+// Malha lida de um .obj, com os vértices repetidos unificados. As arestas são
+// pares de índices (GL_LINES)
+struct Mesh {
+  std::vector<Vertex> vertices;
+  std::vector<GLuint> indices;
+  std::vector<GLuint> edgeIndices;
+};
+
+// Malha no formato enviado à GPU, com os mesmos bytes gravados no .mesh. Os
+// índices das arestas vêm logo após os dos triângulos
+struct EncodedMesh {
+  MeshHeader header;
+  std::vector<std::byte> vertexData;
+  std::vector<std::byte> indexData;
+};
+
+[[nodiscard]] Mesh parseObj(std::string_view path);
+void optimizeMesh(Mesh &mesh);
+[[nodiscard]] EncodedMesh encodeMesh(Mesh const &mesh, VertexFormat format);
+void writeMesh(EncodedMesh const &mesh, std::string_view path);
+
+// Média de vértices transformados por triângulo com uma cache FIFO de
+// cacheSize entradas (ACMR). Varia de 0,5 (ideal) a 3
+[[nodiscard]] float computeACMR(std::span<GLuint const> indices,
+                                std::size_t numVertices,
+                                std::size_t cacheSize = 16);
+
+// Caminho do .mesh correspondente a um .obj (mesmo nome, outra extensão)
+[[nodiscard]] std::string getMeshPath(std::string_view objPath);
+// Se o .mesh existe e não é mais antigo que o .obj. Se o .obj não existir, o
+// .mesh é usado como está
+[[nodiscard]] bool isMeshUpToDate(std::string_view meshPath,
+                                  std::string_view objPath);
+
+// Arquivo .mesh mapeado em memória, somente para leitura. As páginas são
+// lidas sob demanda pelo sistema operacional quando os dados são copiados
+// para a GPU
+class MeshFile {
+public:
+  MeshFile() = default;
+  ~MeshFile();
+
+  MeshFile(MeshFile const &) = delete;
+  MeshFile(MeshFile &&) = delete;
+  MeshFile &operator=(MeshFile const &) = delete;
+  MeshFile &operator=(MeshFile &&) = delete;
+
+  // Retorna false se o arquivo não existir ou for inválido
+  bool open(std::string_view path);
+  void close();
+
+  [[nodiscard]] MeshHeader const &getHeader() const { return m_header; }
+  [[nodiscard]] std::span<std::byte const> getVertexData() const;
+  // Índices dos triângulos seguidos dos índices das arestas
+  [[nodiscard]] std::span<std::byte const> getIndexData() const;
+
+private:
+  std::byte const *m_data{};
+  std::size_t m_size{};
+  MeshHeader m_header{};
+};
+
+#endif
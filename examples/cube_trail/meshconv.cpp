@@ -0,0 +1,63 @@
+// Ferramenta de linha de comando que converte os modelos .obj do jogo para o
+// formato binário .mesh (veja mesh.hpp). O jogo mapeia o .mesh em memória e o
+// envia diretamente à GPU, sem interpretar o .obj durante a inicialização.
+//
+// Uso: cube_trail_meshconv entrada.obj saída.mesh [packed|float]
+//
+// Os triângulos são reordenados para a cache de vértices da GPU e os vértices
+// pela ordem de uso. Por padrão, os vértices usam o layout compactado de 16
+// bytes (PackedVertex); "float" mantém o layout de 32 bytes (Vertex).
+//
+// Se o .mesh não existir ou for mais antigo que o .obj, o jogo o grava por
+// conta própria na primeira execução.
+
+#define SDL_MAIN_HANDLED
+
+#include "mesh.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  try {
+    std::vector<std::string> const args(argv + 1, argv + argc);
+    if (args.size() < 2) {
+      std::cerr << "Uso: cube_trail_meshconv entrada.obj saída.mesh "
+                   "[packed|float]\n";
+      return -1;
+    }
+
+    auto format{VertexFormat::Packed};
+    if (args.size() > 2) {
+      if (args[2] == "float") {
+        format = VertexFormat::Float;
+      } else if (args[2] != "packed") {
+        std::cerr << "Formato desconhecido: " << args[2] << '\n';
+        return -1;
+      }
+    }
+
+    auto mesh{parseObj(args[0])};
+    auto const originalACMR{computeACMR(mesh.indices, mesh.vertices.size())};
+    auto const originalBytes{mesh.vertices.size() * sizeof(Vertex) +
+                             (mesh.indices.size() + mesh.edgeIndices.size()) *
+                                 sizeof(GLuint)};
+    optimizeMesh(mesh);
+    auto const encoded{encodeMesh(mesh, format)};
+    writeMesh(encoded, args[1]);
+
+    std::cout << args[1] << ": " << mesh.vertices.size() << " vértices, "
+              << mesh.indices.size() / 3 << " triângulos, "
+              << mesh.edgeIndices.size() / 2 << " arestas, ACMR "
+              << originalACMR << " -> "
+              << computeACMR(mesh.indices, mesh.vertices.size()) << ", "
+              << encoded.vertexData.size() + encoded.indexData.size()
+              << " bytes (sem otimização: " << originalBytes << " bytes)\n";
+  } catch (std::exception const &exception) {
+    std::cerr << exception.what() << '\n';
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Ferramenta de linha de comando para validar e pontuar tabuleiros em lote,
+// sem janela nem contexto OpenGL.
+//
+// Uso: cube_trail_solve [N] [tabuleiros] [semente]
+//
+// Gera tabuleiros (2N+1) x (2N+1) com um buraco aleatório fora do centro, como
+// Ground::randomizeHole, e resolve cada um a partir do prisma em pé no centro.
+
+#include "solver.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+char const *toText(Solver::Move move) {
+  switch (move) {
+  case Solver::Move::UP:
+    return "UP";
+  case Solver::Move::DOWN:
+    return "DOWN";
+  case Solver::Move::LEFT:
+    return "LEFT";
+  case Solver::Move::RIGHT:
+    break;
+  }
+  return "RIGHT";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    std::vector<std::string> const args(argv + 1, argv + argc);
+    auto const N{args.size() > 0 ? std::stoi(args[0]) : 3};
+    auto const numBoards{args.size() > 1 ? std::stoi(args[1]) : 1};
+    auto const seed{args.size() > 2
+                        ? static_cast<std::uint32_t>(std::stoul(args[2]))
+                        : std::random_device{}()};
+
+    if (N < 1 || numBoards < 1) {
+      std::cerr << "Uso: cube_trail_solve [N >= 1] [tabuleiros >= 1] "
+                   "[semente]\n";
+      return -1;
+    }
+
+    std::mt19937 gen{seed};
+    std::uniform_int_distribution<> dist(-N, N);
+
+    TileGrid grid{2 * N + 1, 2 * N + 1};
+
+    auto solvable{0};
+    auto totalMoves{0L};
+    auto maxMoves{0};
+    std::size_t totalExpanded{};
+    std::chrono::duration<double> elapsed{};
+
+    for (auto board{0}; board < numBoards; ++board) {
+      int holeX{};
+      int holeZ{};
+      do {
+        holeX = dist(gen);
+        holeZ = dist(gen);
+      } while (holeX == 0 && holeZ == 0);
+
+      grid.fill(true);
+      grid.set(holeX + N, holeZ + N, false);
+
+      auto const start{std::chrono::steady_clock::now()};
+      Solver solver{grid, holeX, holeZ};
+      auto const moves{solver.solve({})};
+      elapsed += std::chrono::steady_clock::now() - start;
+      totalExpanded += solver.getExpandedStates();
+
+      if (moves) {
+        ++solvable;
+        auto const count{static_cast<int>(moves->size())};
+        totalMoves += count;
+        maxMoves = std::max(maxMoves, count);
+      }
+
+      if (numBoards == 1) {
+        std::cout << "Buraco em (" << holeX << ", " << holeZ << "): ";
+        if (moves) {
+          std::cout << moves->size() << " movimentos\n";
+          for (auto const move : *moves) {
+            std::cout << toText(move) << ' ';
+          }
+          std::cout << '\n';
+        } else {
+          std::cout << "sem solução\n";
+        }
+      }
+    }
+
+    auto const seconds{elapsed.count()};
+    std::cout << "Tabuleiros: " << numBoards << " (N = " << N
+              << ", semente = " << seed << ")\n"
+              << "Com solução: " << solvable << '\n';
+    if (solvable > 0) {
+      std::cout << "Movimentos: média "
+                << static_cast<double>(totalMoves) / solvable << ", máximo "
+                << maxMoves << '\n';
+    }
+    std::cout << "Estados expandidos: " << totalExpanded << " em " << seconds
+              << " s";
+    if (seconds > 0.0) {
+      std::cout << " (" << static_cast<double>(totalExpanded) / seconds / 1e6
+                << " M estados/s)";
+    }
+    std::cout << '\n';
+  } catch (std::exception const &exception) {
+    std::cerr << exception.what() << '\n';
+    return -1;
+  }
+  return 0;
+}
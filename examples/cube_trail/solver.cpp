@@ -0,0 +1,212 @@
+#include "solver.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+
+namespace {
+bool testBit(std::vector<std::uint64_t> const &bits, std::uint32_t index) {
+  return ((bits[index >> 6U] >> (index & 63U)) & 1U) != 0U;
+}
+
+void setBit(std::vector<std::uint64_t> &bits, std::uint32_t index) {
+  bits[index >> 6U] |= std::uint64_t{1} << (index & 63U);
+}
+
+Solver::State stateOf(int x, int z) {
+  if ((x & 1) != 0)
+    return Solver::State::LAYING_X;
+  if ((z & 1) != 0)
+    return Solver::State::LAYING_Z;
+  return Solver::State::STANDING;
+}
+
+Solver::Move opposite(Solver::Move move) {
+  switch (move) {
+  case Solver::Move::UP:
+    return Solver::Move::DOWN;
+  case Solver::Move::DOWN:
+    return Solver::Move::UP;
+  case Solver::Move::LEFT:
+    return Solver::Move::RIGHT;
+  case Solver::Move::RIGHT:
+    break;
+  }
+  return Solver::Move::LEFT;
+}
+} // namespace
+
+Solver::Solver(TileGrid const &grid, int holeX, int holeZ)
+    : m_N{grid.getWidth() / 2}, m_offset{2 * m_N + 4}, m_width{4 * m_N + 9} {
+  auto const numStates{static_cast<std::size_t>(m_width) *
+                       static_cast<std::size_t>(m_width)};
+  auto const numWords{(numStates + 63) / 64};
+
+  m_open.assign(numWords, 0);
+  m_visited.assign(numWords, 0);
+  m_parent.assign((numStates + 31) / 32, 0);
+
+  // Marca os estados em que o prisma permanece sobre um tile. Só é preciso
+  // percorrer os centros cujo tile arredondado pode estar dentro do grid
+  for (auto z{-2 * m_N - 1}; z <= 2 * m_N + 1; ++z) {
+    for (auto x{-2 * m_N - 1}; x <= 2 * m_N + 1; ++x) {
+      Pose const pose{.x = x, .z = z, .state = stateOf(x, z)};
+      if (!isValid(pose))
+        continue;
+      int cellX{};
+      int cellZ{};
+      getCell(pose, cellX, cellZ);
+      if (grid.contains(cellX + m_N, cellZ + m_N) &&
+          grid.test(cellX + m_N, cellZ + m_N)) {
+        setBit(m_open, index(x, z));
+      }
+    }
+  }
+
+  m_goal = index(2 * holeX, 2 * holeZ);
+
+  std::size_t numOpen{};
+  for (auto const word : m_open) {
+    numOpen += static_cast<std::size_t>(std::popcount(word));
+  }
+  m_queue.reserve(numOpen);
+}
+
+std::optional<std::vector<Solver::Move>> Solver::solve(Pose const &start) {
+  m_expanded = 0;
+
+  if (!isValid(start) || std::abs(start.x) > 2 * m_N + 1 ||
+      std::abs(start.z) > 2 * m_N + 1)
+    return std::nullopt;
+
+  auto const startIndex{index(start.x, start.z)};
+  if (!testBit(m_open, startIndex))
+    return std::nullopt;
+
+  // Deslocamento no espaço indexado de cada movimento, por estado, derivado
+  // da mesma regra de transição usada pelo Cube
+  constexpr std::array moves{Move::UP, Move::DOWN, Move::LEFT, Move::RIGHT};
+  constexpr std::array representatives{
+      Pose{.x = 0, .z = 0, .state = State::STANDING},
+      Pose{.x = 1, .z = 0, .state = State::LAYING_X},
+      Pose{.x = 0, .z = 1, .state = State::LAYING_Z}};
+  std::array<std::array<std::int64_t, moves.size()>, representatives.size()>
+      delta{};
+  for (auto const &representative : representatives) {
+    auto const stateIndex{static_cast<std::size_t>(representative.state)};
+    for (auto const move : moves) {
+      auto const next{step(representative, move)};
+      delta.at(stateIndex).at(static_cast<std::size_t>(move)) =
+          (next.x - representative.x) +
+          static_cast<std::int64_t>(next.z - representative.z) * m_width;
+    }
+  }
+
+  std::fill(m_visited.begin(), m_visited.end(), 0);
+  std::fill(m_parent.begin(), m_parent.end(), 0);
+  m_queue.clear();
+  m_queue.push_back(startIndex);
+  setBit(m_visited, startIndex);
+
+  auto const width{static_cast<std::uint32_t>(m_width)};
+  auto found{false};
+
+  for (std::size_t head{}; head < m_queue.size() && !found; ++head) {
+    auto const current{m_queue[head]};
+    ++m_expanded;
+
+    // O deslocamento m_offset é par, então a paridade da linha/coluna
+    // indexada é a mesma da posição em meios tiles
+    auto const state{stateOf(static_cast<int>(current % width),
+                             static_cast<int>(current / width))};
+    auto const &stateDelta{delta.at(static_cast<std::size_t>(state))};
+
+    for (auto const move : moves) {
+      auto const next{static_cast<std::uint32_t>(
+          current + stateDelta.at(static_cast<std::size_t>(move)))};
+      if (testBit(m_visited, next))
+        continue;
+
+      if (next != m_goal && !testBit(m_open, next))
+        continue;
+
+      setBit(m_visited, next);
+      m_parent[next >> 5U] |= static_cast<std::uint64_t>(move)
+                              << ((next & 31U) * 2U);
+
+      if (next == m_goal) {
+        found = true;
+        break;
+      }
+      m_queue.push_back(next);
+    }
+  }
+
+  if (!found)
+    return std::nullopt;
+
+  // Reconstrói o caminho a partir do buraco desfazendo cada movimento
+  std::vector<Move> path;
+  for (auto current{m_goal}; current != startIndex;) {
+    auto const move{static_cast<Move>(
+        (m_parent[current >> 5U] >> ((current & 31U) * 2U)) & 3U)};
+    path.push_back(move);
+    auto const previous{step(poseAt(current), opposite(move))};
+    current = index(previous.x, previous.z);
+  }
+  std::reverse(path.begin(), path.end());
+
+  return path;
+}
+
+// Mesma regra de Cube::translate: em pé <-> deitado o centro desloca 1.5 tile
+// (3 meios tiles); rolando sobre a lateral do prisma deitado, 1 tile
+Solver::Pose Solver::step(Pose const &pose, Move move) {
+  auto const alongX{move == Move::LEFT || move == Move::RIGHT};
+  auto const sign{(move == Move::UP || move == Move::LEFT) ? -1 : 1};
+
+  auto distance{3};
+  if ((pose.state == State::LAYING_X && !alongX) ||
+      (pose.state == State::LAYING_Z && alongX)) {
+    distance = 2;
+  }
+
+  Pose next{pose};
+  if (alongX) {
+    next.x += sign * distance;
+  } else {
+    next.z += sign * distance;
+  }
+  next.state = stateOf(next.x, next.z);
+
+  return next;
+}
+
+// Tile sob o centro do prisma, arredondando meios tiles para longe do zero
+// (como std::round)
+void Solver::getCell(Pose const &pose, int &x, int &z) {
+  auto const toCell{[](int half) {
+    if ((half & 1) == 0)
+      return half / 2;
+    return (half + (half > 0 ? 1 : -1)) / 2;
+  }};
+  x = toCell(pose.x);
+  z = toCell(pose.z);
+}
+
+bool Solver::isValid(Pose const &pose) {
+  return ((pose.x & 1) == 0 || (pose.z & 1) == 0) &&
+         stateOf(pose.x, pose.z) == pose.state;
+}
+
+std::uint32_t Solver::index(int x, int z) const {
+  return static_cast<std::uint32_t>((z + m_offset) * m_width + x + m_offset);
+}
+
+Solver::Pose Solver::poseAt(std::uint32_t index) const {
+  auto const width{static_cast<std::uint32_t>(m_width)};
+  auto const x{static_cast<int>(index % width) - m_offset};
+  auto const z{static_cast<int>(index / width) - m_offset};
+  return {.x = x, .z = z, .state = stateOf(x, z)};
+}
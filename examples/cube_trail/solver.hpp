@@ -0,0 +1,61 @@
+#ifndef SOLVER_HPP_
+#define SOLVER_HPP_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "tilegrid.hpp"
+
+// Resolvedor ótimo (BFS) de tabuleiros do Bloxorz, sem dependência de OpenGL.
+//
+// As posições são representadas em unidades de meio tile (2 * coordenada do
+// grid), de modo que o centro do prisma deitado também seja inteiro. Em pé,
+// x e z são pares; deitado em X, x é ímpar; deitado em Z, z é ímpar.
+class Solver {
+public:
+  enum class State { STANDING, LAYING_X, LAYING_Z };
+  enum class Move { UP, DOWN, LEFT, RIGHT };
+
+  struct Pose {
+    int x{};
+    int z{};
+    State state{State::STANDING};
+
+    friend bool operator==(Pose const &, Pose const &) = default;
+  };
+
+  // O grid tem (2N+1) x (2N+1) tiles centrados na origem, indexado por
+  // (x + N, z + N) como em Ground
+  Solver(TileGrid const &grid, int holeX, int holeZ);
+
+  // Menor sequência de movimentos até ficar em pé sobre o buraco, ou
+  // std::nullopt se não houver solução (ou se a pose inicial for inválida)
+  [[nodiscard]] std::optional<std::vector<Move>> solve(Pose const &start);
+  [[nodiscard]] std::size_t getExpandedStates() const { return m_expanded; }
+
+  // Regras de transição compartilhadas com Cube::translate
+  [[nodiscard]] static Pose step(Pose const &pose, Move move);
+  static void getCell(Pose const &pose, int &x, int &z);
+  [[nodiscard]] static bool isValid(Pose const &pose);
+
+private:
+  int m_N{};
+  int m_offset{}; // Margem para que nenhum movimento saia do espaço indexado
+  int m_width{};  // Largura (e altura) do espaço de estados indexado
+  std::uint32_t m_goal{};
+
+  // Conjuntos de bits indexados por index(x, z)
+  std::vector<std::uint64_t> m_open;    // Estados em que o prisma não cai
+  std::vector<std::uint64_t> m_visited; // Estados já alcançados pela BFS
+  // Movimento que alcançou cada estado, 2 bits por estado
+  std::vector<std::uint64_t> m_parent;
+  std::vector<std::uint32_t> m_queue;
+
+  std::size_t m_expanded{};
+
+  [[nodiscard]] std::uint32_t index(int x, int z) const;
+  [[nodiscard]] Pose poseAt(std::uint32_t index) const;
+};
+
+#endif
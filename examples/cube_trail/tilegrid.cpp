@@ -0,0 +1,161 @@
+#include "tilegrid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdlib>
+
+TileGrid::TileGrid(int width, int height, bool value) {
+  resize(width, height, value);
+}
+
+void TileGrid::resize(int width, int height, bool value) {
+  m_width = std::max(width, 0);
+  m_height = std::max(height, 0);
+  m_wordsPerRow = (static_cast<std::size_t>(m_width) + 63) / 64;
+
+  auto const bitsInLastWord{static_cast<unsigned>(m_width) & 63U};
+  m_lastWordMask = bitsInLastWord == 0
+                       ? ~std::uint64_t{0}
+                       : (std::uint64_t{1} << bitsInLastWord) - 1;
+
+  m_words.assign(m_wordsPerRow * static_cast<std::size_t>(m_height),
+                 value ? ~std::uint64_t{0} : 0);
+  clearPadding();
+}
+
+// Não realoca: apenas sobrescreve as palavras existentes
+void TileGrid::fill(bool value) {
+  std::fill(m_words.begin(), m_words.end(), value ? ~std::uint64_t{0} : 0);
+  clearPadding();
+}
+
+int TileGrid::count() const {
+  auto total{0};
+  for (auto const word : m_words) {
+    total += std::popcount(word);
+  }
+  return total;
+}
+
+int TileGrid::countRow(int y) const {
+  auto total{0};
+  for (auto const word : row(y)) {
+    total += std::popcount(word);
+  }
+  return total;
+}
+
+int TileGrid::findInRow(int y, int x) const {
+  if (x < 0)
+    x = 0;
+  if (x >= m_width || y < 0 || y >= m_height)
+    return -1;
+
+  auto const words{row(y)};
+  auto index{static_cast<std::size_t>(x) >> 6U};
+  // Ignora os bits antes de x na primeira palavra
+  auto word{words[index] &
+            (~std::uint64_t{0} << (static_cast<unsigned>(x) & 63U))};
+  while (true) {
+    if (word != 0) {
+      return static_cast<int>(index * 64) + std::countr_zero(word);
+    }
+    if (++index == words.size())
+      return -1;
+    word = words[index];
+  }
+}
+
+int TileGrid::findInColumn(int x, int y) const {
+  if (x < 0 || x >= m_width)
+    return -1;
+
+  for (auto row{std::max(y, 0)}; row < m_height; ++row) {
+    if (test(x, row))
+      return row;
+  }
+  return -1;
+}
+
+void TileGrid::shift(int dx, int dy) {
+  if (m_words.empty())
+    return;
+
+  // Linhas são contíguas, então deslocar linhas é deslocar palavras inteiras
+  if (dy != 0) {
+    auto const rows{std::min(std::abs(dy), m_height)};
+    auto const offset{static_cast<std::ptrdiff_t>(
+        static_cast<std::size_t>(rows) * m_wordsPerRow)};
+    if (dy > 0) {
+      std::copy_backward(m_words.begin(), m_words.end() - offset,
+                         m_words.end());
+      std::fill(m_words.begin(), m_words.begin() + offset, 0);
+    } else {
+      std::copy(m_words.begin() + offset, m_words.end(), m_words.begin());
+      std::fill(m_words.end() - offset, m_words.end(), 0);
+    }
+  }
+
+  if (dx != 0) {
+    for (auto y{0}; y < m_height; ++y) {
+      shiftRow({m_words.data() + static_cast<std::size_t>(y) * m_wordsPerRow,
+                m_wordsPerRow},
+               dx);
+    }
+    clearPadding();
+  }
+}
+
+TileGrid &TileGrid::operator&=(TileGrid const &other) {
+  assert(other.m_width == m_width && other.m_height == m_height);
+  std::transform(m_words.begin(), m_words.end(), other.m_words.begin(),
+                 m_words.begin(), [](auto lhs, auto rhs) { return lhs & rhs; });
+  return *this;
+}
+
+TileGrid &TileGrid::operator|=(TileGrid const &other) {
+  assert(other.m_width == m_width && other.m_height == m_height);
+  std::transform(m_words.begin(), m_words.end(), other.m_words.begin(),
+                 m_words.begin(), [](auto lhs, auto rhs) { return lhs | rhs; });
+  return *this;
+}
+
+// Desloca os bits de uma linha: dx > 0 move para colunas maiores
+void TileGrid::shiftRow(std::span<std::uint64_t> words, int dx) {
+  auto const size{static_cast<std::ptrdiff_t>(words.size())};
+  auto const wordShift{static_cast<std::ptrdiff_t>(std::abs(dx) / 64)};
+  auto const bitShift{static_cast<unsigned>(std::abs(dx) % 64)};
+
+  auto const at{[&](std::ptrdiff_t index) {
+    return index >= 0 && index < size ? words[static_cast<std::size_t>(index)]
+                                      : std::uint64_t{0};
+  }};
+
+  if (dx > 0) {
+    for (auto index{size - 1}; index >= 0; --index) {
+      auto const source{index - wordShift};
+      auto value{at(source) << bitShift};
+      if (bitShift != 0)
+        value |= at(source - 1) >> (64 - bitShift);
+      words[static_cast<std::size_t>(index)] = value;
+    }
+  } else {
+    for (std::ptrdiff_t index{}; index < size; ++index) {
+      auto const source{index + wordShift};
+      auto value{at(source) >> bitShift};
+      if (bitShift != 0)
+        value |= at(source + 1) << (64 - bitShift);
+      words[static_cast<std::size_t>(index)] = value;
+    }
+  }
+}
+
+void TileGrid::clearPadding() {
+  if (m_wordsPerRow == 0)
+    return;
+  for (auto index{m_wordsPerRow - 1}; index < m_words.size();
+       index += m_wordsPerRow) {
+    m_words[index] &= m_lastWordMask;
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef TILEGRID_HPP_
+#define TILEGRID_HPP_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Grid de tiles compactado em bits (bitboard). Cada linha ocupa um número
+// inteiro de palavras de 64 bits, de modo que operações por linha trabalhem
+// sobre palavras inteiras. Os bits de preenchimento após a última coluna são
+// sempre mantidos em zero.
+class TileGrid {
+public:
+  TileGrid() = default;
+  TileGrid(int width, int height, bool value = false);
+
+  void resize(int width, int height, bool value = false);
+  void fill(bool value);
+
+  [[nodiscard]] int getWidth() const { return m_width; }
+  [[nodiscard]] int getHeight() const { return m_height; }
+  [[nodiscard]] bool contains(int x, int y) const {
+    return x >= 0 && x < m_width && y >= 0 && y < m_height;
+  }
+
+  [[nodiscard]] bool test(int x, int y) const {
+    auto const word{m_words[wordIndex(x, y)]};
+    return ((word >> (static_cast<unsigned>(x) & 63U)) & 1U) != 0U;
+  }
+  void set(int x, int y, bool value = true) {
+    auto &word{m_words[wordIndex(x, y)]};
+    auto const mask{std::uint64_t{1} << (static_cast<unsigned>(x) & 63U)};
+    word = value ? (word | mask) : (word & ~mask);
+  }
+
+  // Contagem de tiles presentes
+  [[nodiscard]] int count() const;
+  [[nodiscard]] int countRow(int y) const;
+
+  // Próximo tile presente a partir de (x, y) na linha ou na coluna, ou -1
+  [[nodiscard]] int findInRow(int y, int x = 0) const;
+  [[nodiscard]] int findInColumn(int x, int y = 0) const;
+
+  // Desloca o conteúdo por dx colunas e dy linhas; o que sai do grid é
+  // descartado e o que entra é vazio
+  void shift(int dx, int dy);
+
+  TileGrid &operator&=(TileGrid const &other);
+  TileGrid &operator|=(TileGrid const &other);
+
+  [[nodiscard]] std::span<std::uint64_t const> row(int y) const {
+    return {m_words.data() + static_cast<std::size_t>(y) * m_wordsPerRow,
+            m_wordsPerRow};
+  }
+
+private:
+  int m_width{};
+  int m_height{};
+  std::size_t m_wordsPerRow{};
+  std::uint64_t m_lastWordMask{};
+  std::vector<std::uint64_t> m_words;
+
+  [[nodiscard]] std::size_t wordIndex(int x, int y) const {
+    return static_cast<std::size_t>(y) * m_wordsPerRow +
+           (static_cast<std::size_t>(x) >> 6U);
+  }
+  static void shiftRow(std::span<std::uint64_t> words, int dx);
+  void clearPadding();
+};
+
+#endif
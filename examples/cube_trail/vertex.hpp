@@ -1,6 +1,8 @@
 #ifndef VERTEX_HPP_
 #define VERTEX_HPP_
 
+#include <cstdint>
+
 #include "abcgOpenGL.hpp"
 
 struct Vertex {
@@ -11,4 +13,13 @@ struct Vertex {
   friend bool operator==(Vertex const&, Vertex const&) = default;
 };
 
+// Vértice compactado (16 bytes), lido com glVertexAttribPointer normalizado
+struct PackedVertex {
+  // Inteiros sem sinal normalizados na caixa envolvente da malha (w não é
+  // usado)
+  glm::u16vec4 position{};
+  std::uint32_t normal{};   // GL_INT_2_10_10_10_REV normalizado
+  std::uint32_t texCoord{}; // Dois GL_HALF_FLOAT
+};
+
 #endif
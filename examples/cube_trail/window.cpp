@@ -4,14 +4,22 @@
 #include <tiny_obj_loader.h>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <array>
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #include "abcg.hpp"
-#include "abcgOpenGLImage.hpp" // Necessário para abcg::loadOpenGLTexture
+#include "abcgOpenGLImage.hpp" // Necessário para abcg::OpenGLTextureArrayCreateInfo
 #include "cube.hpp"
 #include "ground.hpp"
 
 void Window::onEvent(SDL_Event const &event) {
+  // O cubo só existe depois que os shaders ficam prontos
+  if (!m_programsReady)
+    return;
+
   if (event.type == SDL_KEYDOWN) {
     if (event.key.keysym.sym == SDLK_w || event.key.keysym.sym == SDLK_UP)
       m_cube.moveUp();
@@ -21,24 +29,43 @@ void Window::onEvent(SDL_Event const &event) {
       m_cube.moveLeft();
     if (event.key.keysym.sym == SDLK_d || event.key.keysym.sym == SDLK_RIGHT)
       m_cube.moveRight();
+    // Salva as zonas de CPU gravadas até agora (chrome://tracing ou Perfetto)
+    if (event.key.keysym.sym == SDLK_t) {
+      auto const filename{"cube_trail_trace.json"};
+      try {
+        abcg::Profiler::writeChromeTrace(filename);
+        fmt::print("Trace salvo em {}\n", filename);
+      } catch (abcg::Exception const &exception) {
+        fmt::print(stderr, "{}\n", exception.what());
+      }
+    }
+    // Captura de tela; o PNG é gravado em segundo plano
+    if (event.key.keysym.sym == SDLK_p)
+      saveScreenshotPNG("cube_trail.png");
+    // Liga/desliga a captura de todos os quadros (capture_00000.png, ...)
+    if (event.key.keysym.sym == SDLK_c) {
+      if (isCapturingFrames()) {
+        stopFrameCapture();
+      } else {
+        startFrameCapture("capture_");
+      }
+    }
+    // Liga/desliga a gravação de vídeo em meia resolução (para QA)
+    if (event.key.keysym.sym == SDLK_r) {
+      try {
+        if (isRecording()) {
+          stopRecording();
+          fmt::print("Gravação salva em cube_trail.y4m\n");
+        } else {
+          startRecording({.filename = "cube_trail.y4m", .scale = 0.5f});
+        }
+      } catch (abcg::Exception const &exception) {
+        fmt::print(stderr, "{}\n", exception.what());
+      }
+    }
   }
 }
 
-GLuint Window::loadTexture(std::string_view path) {
-  // Cria a estrutura de criação da textura
-  abcg::OpenGLTextureCreateInfo createInfo{};
-  createInfo.path = path;
-
-  // Ajuste de parâmetros da textura (opcional)
-  // createInfo.magFilter = GL_LINEAR;
-  // createInfo.minFilter = GL_LINEAR_MIPMAP_LINEAR;
-  // createInfo.wrapS = GL_REPEAT;
-  // createInfo.wrapT = GL_REPEAT;
-
-  // Carrega a textura e retorna o ID
-  return abcg::loadOpenGLTexture(createInfo);
-}
-
 void Window::onCreate() {
   auto const assetsPath{abcg::Application::getAssetsPath()};
 
@@ -50,81 +77,228 @@ void Window::onCreate() {
       glm::vec3(0.0f, 0.0f, 0.0f), 
       glm::vec3(0.0f, 1.0f, 0.0f));
 
-  // Cria o programa de shader
-  m_program = abcg::createOpenGLProgram({
+  // Envia os shaders dos dois programas de uma vez; o driver pode compilá-los
+  // em paralelo enquanto a tela de carregamento é exibida
+  m_programIndex = m_programBuilder.add({
     {.source = assetsPath + "texture_light.vert", .stage = abcg::ShaderStage::Vertex},
     {.source = assetsPath + "texture_light.frag", .stage = abcg::ShaderStage::Fragment}
   });
 
-  m_viewMatrixLoc = abcg::glGetUniformLocation(m_program, "viewMatrix");
-  m_projMatrixLoc = abcg::glGetUniformLocation(m_program, "projMatrix");
-  m_modelMatrixLoc = abcg::glGetUniformLocation(m_program, "modelMatrix");
-  m_colorLoc       = abcg::glGetUniformLocation(m_program, "color");
+  // O chão usa a variante instanciada do mesmo vertex shader
+  m_groundProgramIndex = m_programBuilder.add({
+    {.source = assetsPath + "texture_light.vert", .stage = abcg::ShaderStage::Vertex, .defines = {"INSTANCED"}},
+    {.source = assetsPath + "texture_light.frag", .stage = abcg::ShaderStage::Fragment}
+  });
 
-  // Carrega as texturas para o chão e para o cubo
-  auto groundTexture = loadTexture(assetsPath + "tileTexture03.jpg");
-  auto cubeTexture   = loadTexture(assetsPath + "cubeTexture03.jpg");
+  // Iluminação fixa: luz vindo de cima, inclinada
+  m_frameData.lightDir = glm::vec4(glm::normalize(glm::vec3(1.0f)), 0.0f);
+  m_frameData.lightColor = glm::vec4(1.0f); // Cor da luz
+  m_frameData.ambientColor = glm::vec4(0.6f, 0.6f, 0.6f, 1.0f); // Ambiente
 
-  // Cria o chão e o cubo
-  m_ground.create(m_program, m_modelMatrixLoc, m_colorLoc, m_scale, m_N);
-  m_ground.setTexture(groundTexture);
+  // UBO com as constantes por quadro, ligado uma única vez ao ponto
+  // m_frameDataBinding e compartilhado pelos dois programas
+  abcg::glGenBuffers(1, &m_frameUBO);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+  abcg::glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr,
+                     GL_DYNAMIC_DRAW);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  abcg::glBindBufferBase(GL_UNIFORM_BUFFER, m_frameDataBinding, m_frameUBO);
+  m_frameDataDirty = true;
+
+  // Carrega as texturas do chão e do cubo como camadas de um único array, em
+  // segundo plano; elas são decodificadas enquanto a malha do cubo é lida.
+  // Camadas 0 a 2: tiles; camadas 3 a 5: prisma
+  std::array const names{"tileTexture01", "tileTexture02", "tileTexture03",
+                         "cubeTexture01", "cubeTexture02", "cubeTexture03"};
+
+  // Usa as versões KTX2 pré-comprimidas, geradas pelo alvo cube_trail_textures
+  // já no tamanho das camadas, quando todas existem. As camadas de um array
+  // não podem misturar KTX2 com JPEG
+  auto const useKTX2{std::ranges::all_of(names, [&](auto const *name) {
+    return std::filesystem::exists(assetsPath + name + ".ktx2");
+  })};
+  std::vector<std::string> paths;
+  for (auto const *name : names) {
+    paths.push_back(assetsPath + name + (useKTX2 ? ".ktx2" : ".jpg"));
+  }
+  abcg::OpenGLTextureArrayCreateInfo createInfo{};
+  createInfo.paths.assign(paths.begin(), paths.end());
+  // Os JPEGs têm tamanhos diferentes, então são redimensionados
+  createInfo.size = {1024, 1024};
+  m_textures = getTextureLoader().load(createInfo);
 
+  // O chão é visto em ângulo rasante, então a filtragem anisotrópica evita
+  // que os ladrilhos distantes fiquem borrados
+  m_sampler = abcg::getOpenGLSampler({.maxAnisotropy = 8.0f});
+
+  // A malha do cubo é lida enquanto os shaders são compilados
   m_cube.loadObj(assetsPath + "box.obj");
+
+  // No modo headless, o número de quadros é fixo, então espera os shaders
+  if (getOpenGLSettings().headless) {
+    m_programBuilder.wait();
+    onProgramsReady();
+  }
+}
+
+// Conclui a criação da cena com os programas já ligados
+void Window::onProgramsReady() {
+  m_program = m_programBuilder.getProgram(m_programIndex);
+  m_groundProgram = m_programBuilder.getProgram(m_groundProgramIndex);
+  m_programsReady = true;
+
+  bindFrameData(m_program);
+  bindFrameData(m_groundProgram);
+
+  m_modelMatrixLoc = abcg::glGetUniformLocation(m_program, "modelMatrix");
+  m_colorLoc       = abcg::glGetUniformLocation(m_program, "color");
+
+  // Cria o chão e o cubo
+  m_ground.create(m_groundProgram, m_scale, m_N);
   m_cube.create(m_program, m_modelMatrixLoc, m_colorLoc, m_viewMatrix, m_scale, m_N);
-  m_cube.setTexture(cubeTexture);
+
+  // Tiles com as três aparências misturadas, e o prisma com a última
+  m_ground.setLayers(0, 3);
+  m_cube.setLayer(5);
 
   // Vincula o chão ao cubo
   m_cube.setGround(&m_ground);
 }
 
 void Window::onUpdate() {
+  // Acompanha a compilação dos shaders sem bloquear a tela de carregamento
+  if (!m_programsReady) {
+    if (m_programBuilder.update()) {
+      onProgramsReady();
+    } else {
+      requestRepaint();
+      return;
+    }
+  }
+
   m_cube.update(gsl::narrow_cast<float>(getDeltaTime()));
+
+  // Fora das animações, a janela só é redesenhada quando chegam eventos
+  if (m_cube.isAnimating()) {
+    requestRepaint();
+  }
 }
 
 void Window::onPaint() {
+  updateFrameData();
+
   abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   abcg::glViewport(0, 0, m_viewportSize.x, m_viewportSize.y);
-  abcg::glUseProgram(m_program);
 
-  auto const aspect{gsl::narrow<float>(m_viewportSize.x) /
-                    gsl::narrow<float>(m_viewportSize.y)};
+  // Tela de carregamento: só o fundo e o progresso em onPaintUI
+  if (!m_programsReady)
+    return;
 
-  m_projMatrix = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 5.0f);
+  // O array de texturas é vinculado uma única vez para os dois passes. Usa a
+  // textura provisória enquanto a definitiva não é enviada à GPU
+  abcg::glActiveTexture(GL_TEXTURE0);
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY,
+                      getTextureLoader().getTexture(m_textures));
+  abcg::glBindSampler(0, m_sampler);
+
+  // Cada passe é medido separadamente no painel de GPU
+  {
+    abcg::OpenGLProfilerScope scope{getGPUProfiler(), "Cube"};
+    abcg::glUseProgram(m_program);
+    m_cube.paint();
+  }
+
+  {
+    abcg::OpenGLProfilerScope scope{getGPUProfiler(), "Ground"};
+    abcg::glUseProgram(m_groundProgram);
+    m_ground.paint();
+  }
+
+  abcg::glBindSampler(0, 0);
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  abcg::glUseProgram(0);
+}
 
-  abcg::glUniformMatrix4fv(m_viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  abcg::glUniformMatrix4fv(m_projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
+// Associa o bloco FrameData do programa ao ponto de ligação do UBO. O sampler
+// não pode ficar no bloco, mas também só precisa ser definido uma vez
+void Window::bindFrameData(GLuint program) const {
+  auto const blockIndex{abcg::glGetUniformBlockIndex(program, "FrameData")};
+  if (blockIndex != GL_INVALID_INDEX) {
+    abcg::glUniformBlockBinding(program, blockIndex, m_frameDataBinding);
+  }
 
-  // Define iluminação
-  GLint lightDirLoc     = abcg::glGetUniformLocation(m_program, "lightDir");
-  GLint lightColorLoc   = abcg::glGetUniformLocation(m_program, "lightColor");
-  GLint ambientColorLoc = abcg::glGetUniformLocation(m_program, "ambientColor");
+  // Uniform da textura (sampler2DArray) é geralmente a unidade 0
+  abcg::glUseProgram(program);
+  abcg::glUniform1i(abcg::glGetUniformLocation(program, "tex"), 0);
+  abcg::glUseProgram(0);
+}
 
-  // Luz vindo de cima, inclinado
-  glm::vec3 lightDir = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
-  abcg::glUniform3fv(lightDirLoc, 1, &lightDir.x);
+// Envia as constantes de câmera e iluminação somente se alguma delas mudou
+void Window::updateFrameData() {
+  if (!m_frameDataDirty)
+    return;
 
-  glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f); // Cor da Luz ambiente
-  abcg::glUniform3fv(lightColorLoc, 1, &lightColor.x);
+  m_frameData.viewMatrix = m_viewMatrix;
+  m_frameData.projMatrix = m_projMatrix;
 
-  glm::vec3 ambientColor = glm::vec3(0.6f, 0.6f, 0.6f); // Iluminação ambiente
-  abcg::glUniform3fv(ambientColorLoc, 1, &ambientColor.x);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+  abcg::glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_frameData);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-  // Uniform da textura (sampler2D) é geralmente a unidade 0
-  GLint texLoc = abcg::glGetUniformLocation(m_program, "tex");
-  abcg::glUniform1i(texLoc, 0);
+  m_frameDataDirty = false;
+}
 
-  m_cube.paint();
-  m_ground.paint();
+void Window::onPaintUI() {
+  abcg::OpenGLWindow::onPaintUI();
 
-  abcg::glUseProgram(0);
+  if (!m_programsReady) {
+    ImGui::SetNextWindowPos(ImVec2(5, 75));
+    ImGui::Begin("Carregando", nullptr,
+                 ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                     ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Compilando shaders... %zu/%zu",
+                m_programBuilder.getNumReadyPrograms(),
+                m_programBuilder.getNumPrograms());
+    ImGui::End();
+    return;
+  }
+
+  // Mostra o número mínimo de movimentos calculado pelo Solver
+  ImGui::SetNextWindowPos(ImVec2(5, 75));
+  ImGui::Begin("Par", nullptr,
+               ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                   ImGuiWindowFlags_NoBringToFrontOnFocus |
+                   ImGuiWindowFlags_NoFocusOnAppearing |
+                   ImGuiWindowFlags_AlwaysAutoResize);
+  if (auto const par{m_cube.getParMoves()}; par >= 0) {
+    ImGui::Text("Mínimo: %d movimentos", par);
+  } else {
+    ImGui::Text("Sem solução");
+  }
+  ImGui::End();
 }
 
 void Window::onResize(glm::ivec2 const &size) {
   m_viewportSize = size;
+
+  // A projeção só muda quando a janela é redimensionada
+  auto const aspect{gsl::narrow<float>(m_viewportSize.x) /
+                    gsl::narrow<float>(std::max(m_viewportSize.y, 1))};
+  m_projMatrix = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 5.0f);
+  m_frameDataDirty = true;
 }
 
 void Window::onDestroy() {
+  // O contexto ainda existe aqui, então o último quadro pode ser lido
+  if (!m_finalScreenshot.empty()) {
+    saveScreenshotPNG(m_finalScreenshot);
+  }
+
+  // Descarta os shaders ainda em compilação, se a janela for fechada antes
+  m_programBuilder.destroy();
   m_ground.destroy();
   m_cube.destroy();
+  abcg::glDeleteBuffers(1, &m_frameUBO);
+  abcg::glDeleteProgram(m_groundProgram);
   abcg::glDeleteProgram(m_program);
 }
@@ -6,32 +6,67 @@
 #include "ground.hpp"
 
 class Window : public abcg::OpenGLWindow {
+public:
+  // Imagem salva ao final da execução (usado no modo headless)
+  void setFinalScreenshot(std::string_view path) { m_finalScreenshot = path; }
+
 protected:
   void onEvent(SDL_Event const &event) override;
   void onCreate() override;
   void onUpdate() override;
   void onPaint() override;
+  void onPaintUI() override;
   void onResize(glm::ivec2 const &size) override;
   void onDestroy() override;
 
 private:
   glm::ivec2 m_viewportSize{600, 600};
+  std::string m_finalScreenshot;
   float m_scale{0.2f};
   int m_N{3}; // Número de tiles do chão, 2N+1 x 2N+1
 
   GLint m_modelMatrixLoc{};
   glm::mat4 m_viewMatrix{1.0f};
-  GLint m_viewMatrixLoc{};
   glm::mat4 m_projMatrix{1.0f};
-  GLint m_projMatrixLoc{};
+
+  // Espelho do bloco uniforme FrameData dos shaders (layout std140)
+  struct FrameData {
+    glm::mat4 viewMatrix{1.0f};
+    glm::mat4 projMatrix{1.0f};
+    glm::vec4 lightDir{};
+    glm::vec4 lightColor{};
+    glm::vec4 ambientColor{};
+  };
+  static_assert(sizeof(FrameData) == 176, "FrameData must match std140");
+  static constexpr GLuint m_frameDataBinding{0};
+
+  FrameData m_frameData;
+  GLuint m_frameUBO{};
+  bool m_frameDataDirty{true}; // Reenvia o UBO apenas quando algo mudar
 
   GLint m_colorLoc{};
 
   Ground m_ground;
   Cube m_cube;
   GLuint m_program{};
+  GLuint m_groundProgram{}; // Variante instanciada para o chão
+
+  // Compila os dois programas em segundo plano; até ficarem prontos, só a
+  // tela de carregamento é desenhada
+  abcg::OpenGLProgramBuilder m_programBuilder;
+  std::size_t m_programIndex{};
+  std::size_t m_groundProgramIndex{};
+  bool m_programsReady{};
+
+  // Array com as texturas dos tiles e do prisma, carregado em segundo plano;
+  // até ficar pronto, o carregador devolve uma textura cinza provisória
+  abcg::OpenGLTextureLoader::Handle m_textures;
+  // Sampler do array de texturas, com filtragem anisotrópica
+  GLuint m_sampler{};
 
-  GLuint loadTexture(std::string_view path);
+  void onProgramsReady();
+  void bindFrameData(GLuint program) const;
+  void updateFrameData();
 };
 
 #endif